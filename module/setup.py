@@ -6,7 +6,10 @@
 from distutils.core import setup, Extension
 
 module1 = Extension('firewall_verifier',
-                    sources=['src/python.c', 'src/algorithm.c'])
+                    sources=['src/python.c', 'src/algorithm.c', 'src/index.c', 'src/bitset.c', 'src/pool.c',
+                             'src/layout.c', 'src/refine.c', 'src/parse.c', 'src/snapshot.c', 'src/reduce.c',
+                             'src/fdd.c', 'src/cache.c', 'src/regions.c', 'src/flatten.c'],
+                    libraries=['pthread'])
 
 setup(name='FirewallVerifier',
       version='1.0',
@@ -4,332 +4,1035 @@
  *   Nate Mathews, njm3308@rit.edu
  * description:
  *   implementation of least witness + slicing algorithm
- *   some additional optimization could be done (use hashset rather than naive set),
- *   however the current state of the algorithm is probably adequate
+ *   end-point sets are collected by appending every end-point and then
+ *   radix sorting each field and dropping duplicates, a multi-valued rule
+ *   adds the end-point of each of its ranges
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <string.h>
 #include <malloc.h>
 #include <stdlib.h>
+#include <time.h>
 #include "algorithm.h"
+#include "layout.h"
+#include "index.h"
+#include "bitset.h"
+#include "refine.h"
+#include "pool.h"
+
+/** fields with fewer end-points than this are insertion sorted */
+#define SORT_SMALL ((uint32_t) 32)
+
+/** sorted bounds are built once slicing has scanned this many rules per rule of the layout */
+#define SLICE_SCAN_MAX ((uint64_t) 16)
+
+/** candidate products smaller than this are tested on the calling thread only */
+#define PARALLEL_MIN ((uint64_t) 4096)
+
+/** work units created per worker when candidates are tested in parallel */
+#define UNITS_PER_WORKER ((uint32_t) 64)
+
+/** candidate products smaller than this scan the layout itself, packing its bounds would cost more than it saves */
+#define PACKED_MIN ((uint64_t) 64)
+
+static int search_candidates(const struct layout *layout, const uint32_t *set, const uint32_t *indices,
+                             const struct options *opt, bool (*cancel)(void *arg), void *cancel_arg,
+                             struct packed *packed, uint32_t *witness);
+
+// sort the end-points of a field in place and drop duplicates, returns the new size
+static uint32_t sort_unique(uint32_t *values, uint32_t *tmp, uint32_t n)
+{
+    if (n < SORT_SMALL)
+    {   /* insertion sort */
+        for (uint32_t i=1; i<n; i++)
+        {
+            uint32_t v = values[i], j = i;
+            for (; j>0 && values[j-1] > v; j--) values[j] = values[j-1];
+            values[j] = v;
+        }
+    }
+    else
+    {   /* least significant digit radix sort, one byte per pass */
+        uint32_t *src = values, *dst = tmp;
+        for (uint32_t shift=0; shift<32; shift+=8)
+        {
+            uint32_t counts[256] = {0};
+            for (uint32_t i=0; i<n; i++) counts[(src[i] >> shift) & 0xff]++;
+            if (counts[(src[0] >> shift) & 0xff] == n) // every value shares this digit
+                continue;
+            for (uint32_t d=0, sum=0; d<256; d++)
+            {
+                uint32_t c = counts[d];
+                counts[d] = sum;
+                sum += c;
+            }
+            for (uint32_t i=0; i<n; i++) dst[counts[(src[i] >> shift) & 0xff]++] = src[i];
+            uint32_t *swap = src;
+            src = dst;
+            dst = swap;
+        }
+        if (src != values)
+            memcpy(values, src, sizeof(*values)*n);
+    }
+
+    /* drop duplicates */
+    uint32_t unique = (n) ? 1 : 0;
+    for (uint32_t i=1; i<n; i++)
+    {
+        if (values[i] != values[unique-1])
+            values[unique++] = values[i];
+    }
+    return unique;
+}
+
+// sort and merge the ranges of a field
+uint32_t ranges_sort(uint32_t *pairs, uint32_t n)
+{
+    /* insertion sort on the lower bounds, fields hold few ranges */
+    for (uint32_t i=1; i<n; i++)
+    {
+        uint32_t l = pairs[2*i], h = pairs[2*i+1], j = i;
+        for (; j>0 && pairs[2*(j-1)] > l; j--)
+        {
+            pairs[2*j] = pairs[2*(j-1)];
+            pairs[2*j+1] = pairs[2*(j-1)+1];
+        }
+        pairs[2*j] = l;
+        pairs[2*j+1] = h;
+    }
+
+    /* merge ranges which overlap or touch the previous one */
+    uint32_t m = (n) ? 1 : 0;
+    for (uint32_t i=1; i<n; i++)
+    {
+        uint32_t *last = &pairs[2*(m-1)];
+        if (last[1] == UINT32_MAX || pairs[2*i] <= last[1]+1)
+        {
+            if (pairs[2*i+1] > last[1]) last[1] = pairs[2*i+1];
+            continue;
+        }
+        pairs[2*m] = pairs[2*i];
+        pairs[2*m+1] = pairs[2*i+1];
+        m++;
+    }
+    return m;
+}
+
+/* append the end-points field k of rule r adds to a set, the upper bound + 1 of each
+ * range of an agreeing rule or the lower bound of each range of a disagreeing rule,
+ * only the end-points within the property are kept, returns the new size of the set */
+static uint32_t add_endpoints(const struct layout *layout, uint32_t r, uint32_t k, bool agree,
+                              uint32_t *set, uint32_t n)
+{
+    uint32_t ranges = 1, endp;
+    const uint32_t *pairs = NULL;
+    if (layout->record[r] != 0)
+        pairs = layout_ranges(layout, r, k, &ranges);
+    for (uint32_t i=0; i<ranges; i++)
+    {
+        /* calculate end-point */
+        if (agree)
+            endp = ((pairs) ? pairs[2*i+1] : layout->hi[k][r]) + 1;
+        else
+            endp = (pairs) ? pairs[2*i] : layout->lo[k][r];
+
+        // only add to set if end-point is within the property range
+        if (endp <= layout->prop_hi[k] && endp >= layout->prop_lo[k])
+            set[n++] = endp;
+    }
+    return n;
+}
+
+// zero the counters and timings of searches
+void stats_clear(struct stats *stats)
+{
+    atomic_store(&stats->properties, 0);
+    atomic_store(&stats->projected, 0);
+    atomic_store(&stats->slices, 0);
+    atomic_store(&stats->sliced, 0);
+    atomic_store(&stats->sets, 0);
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        atomic_store(&stats->endpoints[f], 0);
+        atomic_store(&stats->endpoints_max[f], 0);
+    }
+    atomic_store(&stats->candidates, 0);
+    atomic_store(&stats->comparisons, 0);
+    for (uint32_t p=0; p<PHASES; p++)
+        atomic_store(&stats->ns[p], 0);
+}
+
+// nanoseconds on the monotonic clock, 0 when nothing is counted
+static uint64_t stats_clock(const struct stats *stats)
+{
+    if (stats == NULL)
+        return 0;
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000u + (uint64_t)t.tv_nsec;
+}
+
+// add the time since start to a phase, returns the time now
+static uint64_t stats_phase(struct stats *stats, enum phase phase, uint64_t start)
+{
+    if (stats == NULL)
+        return 0;
+    uint64_t now = stats_clock(stats);
+    atomic_fetch_add_explicit(&stats->ns[phase], now - start, memory_order_relaxed);
+    return now;
+}
+
+// count a projection and the rules surviving it
+static void stats_projected(struct stats *stats, const struct layout *layout)
+{
+    if (stats == NULL)
+        return;
+    atomic_fetch_add_explicit(&stats->properties, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats->projected, layout->count, memory_order_relaxed);
+}
+
+// count an end-point set and the end-points of each of its fields
+static void stats_set(struct stats *stats, const uint32_t *indices)
+{
+    if (stats == NULL)
+        return;
+    atomic_fetch_add_explicit(&stats->sets, 1, memory_order_relaxed);
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        atomic_fetch_add_explicit(&stats->endpoints[f], indices[f], memory_order_relaxed);
+        uint64_t max = atomic_load_explicit(&stats->endpoints_max[f], memory_order_relaxed);
+        while (indices[f] > max && !atomic_compare_exchange_weak(&stats->endpoints_max[f], &max, indices[f]));
+    }
+}
 
 // wrapper to easily switch between running the algorithm with|without slicing
-uint32_t* find_witness(const uint32_t *lo, const uint32_t *hi, const uint32_t *va, uint32_t count, bool slicing)
+int find_witness(const uint32_t *lo, const uint32_t *hi, const uint32_t *va, uint32_t count,
+                 const struct ranges *ranges, uint32_t *witness, const struct options *opt)
 {
-    if (slicing)
-        return with_slicing(lo, hi, va, count);
+    /* project the rules over the property once, both algorithms work from the projection */
+    uint64_t start = stats_clock(opt->stats);
+    struct layout *layout = layout_build(lo, hi, va, count, ranges);
+    if (layout == NULL)
+        return -1;
+    stats_phase(opt->stats, PHASE_PROJECT, start);
+    stats_projected(opt->stats, layout);
+
+    int found;
+    if (opt->slicing)
+        found = with_slicing(layout, witness, opt);
     else
-        return without_slicing(lo, hi, va, count);
+        found = without_slicing(layout, witness, opt);
+    layout_free(layout);
+    return found;
 }
 
-// test with slicing
-uint32_t* with_slicing(const uint32_t *lo, const uint32_t *hi, const uint32_t *va, uint32_t count)
+/** buffers used while searching the rules of one property, reused between properties */
+struct scratch
 {
-    /* copy original values into temporary buffer */
-    uint32_t *lo_n = malloc(sizeof(*lo_n)*SIZE*count), // lower-bounds of firewall rules
-            *hi_n = malloc(sizeof(*hi_n)*SIZE*count);  // upper-bounds of firewall rules
+    struct layout *slice; // rules of the current slice, NULL when slicing is not used
+    uint32_t *near;       // positions of the rules which may intersect a disagreeing rule, NULL when slicing is not used
+    uint32_t *set;        // set of possible end-points (fields indexed by n*count)
+    uint32_t *tmp;        // scratch space used when sorting a field
+    struct packed *packed; // bounds of the rules searched, packed for the range check
+    size_t near_max, set_max, tmp_max; // number of values near, set and tmp hold
+};
 
-    /* over-sized buffers to hold slice information */
-    uint32_t *lo_s = malloc(sizeof(*lo_s)*SIZE*count), // lower-bounds of slice rules
-             *hi_s = malloc(sizeof(*hi_s)*SIZE*count), // upper-bounds of slice rules
-             *va_s = malloc(sizeof(*va_s)*SIZE*count); // action values (ALLOW,DENY,etc)
+/** buffers kept by a workspace, sized for its largest search so far */
+struct workspace
+{
+    uint32_t workers;          // number of workers buffers are held for
+    struct layout **layouts;   // per worker: rules projected over its property, NULL until needed
+    struct scratch *scratch;   // per worker: search buffers
+    uint64_t *marks;           // rules visited while projecting, shared out between the workers
+    _Atomic uint64_t *ranges;  // per worker: work still owned
+    size_t marks_max, ranges_max;
+};
+
+// a buffer of at least n elements of size bytes, buffer itself if it is large enough, NULL if memory could not be allocated
+static void* reserve(void *buffer, size_t *max, size_t n, size_t size)
+{
+    if (buffer != NULL && n <= *max)
+        return buffer;
+    free(buffer);
+    buffer = malloc(size*n + 1);
+    *max = (buffer != NULL) ? n : 0;
+    return buffer;
+}
+
+// a layout able to hold count rules and values of records, layout itself if it is large enough
+static struct layout* reserve_layout(struct layout *layout, uint32_t count, uint32_t values)
+{
+    if (layout != NULL && count <= layout->capacity && values <= layout->values_max)
+        return layout;
+    layout_free(layout);
+    return layout_alloc(count, values);
+}
+
+// grow buffers to hold the rules of a layout or any projection of them, false if memory could not be allocated
+static bool scratch_reserve(struct scratch *scratch, const struct layout *layout, bool slicing)
+{
+    uint32_t count = layout->count, points = layout_points(layout);
+    if (slicing)
+    {
+        scratch->slice = reserve_layout(scratch->slice, count, layout->values_n);
+        scratch->near = reserve(scratch->near, &scratch->near_max, count, sizeof(*scratch->near));
+        if (scratch->slice == NULL || scratch->near == NULL)
+            return false;
+    }
+    scratch->set = reserve(scratch->set, &scratch->set_max, (size_t)SIZE*points, sizeof(*scratch->set));
+    scratch->tmp = reserve(scratch->tmp, &scratch->tmp_max, points, sizeof(*scratch->tmp));
+    if (scratch->packed == NULL || scratch->packed->capacity < count)
+    {
+        packed_free(scratch->packed);
+        scratch->packed = packed_alloc(count);
+    }
+    return scratch->set != NULL && scratch->tmp != NULL && scratch->packed != NULL;
+}
+
+// release scratch buffers
+static void scratch_free(struct scratch *scratch)
+{
+    layout_free(scratch->slice);
+    free(scratch->near);
+    free(scratch->set);
+    free(scratch->tmp);
+    packed_free(scratch->packed);
+    memset(scratch, 0, sizeof(*scratch));
+}
+
+// grow the buffers of a workspace for workers searching the rules of a layout (or projections of them),
+// project to also hold the rules each worker projects over its property, -1 if memory could not be allocated
+static int workspace_grow(struct workspace *ws, const struct layout *rules, uint32_t workers, bool slicing, bool project)
+{
+    if (workers > ws->workers)
+    {
+        /* new workers start without buffers, those of the others are kept */
+        struct layout **layouts = realloc(ws->layouts, sizeof(*layouts)*workers);
+        if (layouts == NULL)
+            return -1;
+        ws->layouts = layouts;
+        struct scratch *scratch = realloc(ws->scratch, sizeof(*scratch)*workers);
+        if (scratch == NULL)
+            return -1;
+        ws->scratch = scratch;
+        memset(&layouts[ws->workers], 0, sizeof(*layouts)*(workers - ws->workers));
+        memset(&scratch[ws->workers], 0, sizeof(*scratch)*(workers - ws->workers));
+        ws->workers = workers;
+    }
+    ws->ranges = reserve(ws->ranges, &ws->ranges_max, workers, sizeof(*ws->ranges));
+    if (ws->ranges == NULL)
+        return -1;
+    if (project)
+    {
+        ws->marks = reserve(ws->marks, &ws->marks_max, (size_t)(rules->count+63)/64*workers, sizeof(*ws->marks));
+        if (ws->marks == NULL)
+            return -1;
+    }
+    for (uint32_t w=0; w<workers; w++)
+    {
+        if (project)
+        {
+            ws->layouts[w] = reserve_layout(ws->layouts[w], rules->count, rules->values_n);
+            if (ws->layouts[w] == NULL)
+                return -1;
+        }
+        if (!scratch_reserve(&ws->scratch[w], rules, slicing))
+            return -1;
+    }
+    return 0;
+}
+
+// create an empty workspace
+struct workspace* workspace_alloc(void)
+{
+    return calloc(1, sizeof(struct workspace));
+}
+
+// size a workspace for find_witnesses_in
+int workspace_reserve(struct workspace *workspace, const struct layout *rules, const struct options *opt)
+{
+    return workspace_grow(workspace, rules, pool_size(opt->pool), opt->slicing, true);
+}
+
+// memory held by a workspace
+size_t workspace_bytes(const struct workspace *workspace)
+{
+    if (workspace == NULL)
+        return 0;
+    size_t bytes = sizeof(*workspace) + sizeof(*workspace->marks)*workspace->marks_max
+                   + sizeof(*workspace->ranges)*workspace->ranges_max;
+    for (uint32_t w=0; w<workspace->workers; w++)
+    {
+        const struct scratch *scratch = &workspace->scratch[w];
+        bytes += sizeof(*workspace->layouts) + sizeof(*scratch) + layout_bytes(workspace->layouts[w])
+                 + layout_bytes(scratch->slice) + sizeof(*scratch->near)*scratch->near_max
+                 + sizeof(*scratch->set)*scratch->set_max + sizeof(*scratch->tmp)*scratch->tmp_max;
+    }
+    return bytes;
+}
+
+// release the buffers of a workspace
+void workspace_release(struct workspace *workspace)
+{
+    if (workspace == NULL)
+        return;
+    for (uint32_t w=0; w<workspace->workers; w++)
+    {
+        layout_free(workspace->layouts[w]);
+        scratch_free(&workspace->scratch[w]);
+    }
+    free(workspace->layouts);
+    free(workspace->scratch);
+    free(workspace->marks);
+    free(workspace->ranges);
+    memset(workspace, 0, sizeof(*workspace));
+}
+
+// release a workspace
+void workspace_free(struct workspace *workspace)
+{
+    workspace_release(workspace);
+    free(workspace);
+}
+
+// the workspace of a search, local (emptied here) when the options hold none
+static struct workspace* workspace_of(const struct options *opt, struct workspace *local)
+{
+    memset(local, 0, sizeof(*local));
+    return (opt->workspace != NULL) ? opt->workspace : local;
+}
+
+/* form the slice of the disagreeing rule at position d and test its candidates,
+ * 1 if a witness was found (filled in), 0 if not, -1 if memory could not be allocated */
+static int test_slice(const struct layout *layout, uint32_t d, const struct bounds *bounds,
+                      struct scratch *scratch, const struct options *opt,
+                      bool (*cancel)(void *arg), void *cancel_arg, uint64_t *scanned, uint32_t *witness)
+{
+    /* over-sized layout to hold slice information */
+    struct layout *slice = scratch->slice;
+    uint64_t start = stats_clock(opt->stats);
 
     /* buffers to hold end point set information */
-    uint32_t *set = malloc(sizeof(*set)*SIZE*count); // set of possible end-points (fields indexed by n*count)
-    uint32_t *indices = malloc(sizeof(*set)*SIZE);   // size of set for each field
+    uint32_t *set = scratch->set; // set of possible end-points (fields indexed by n*points)
+    uint32_t indices[SIZE];       // size of set for each field
+    uint32_t *tmp = scratch->tmp; // scratch space used when sorting a field
 
-    /* witness array to be return */
-    uint32_t* witness = NULL;
+    /* positions of the rules which may intersect the disagreeing rule */
+    uint32_t *near = scratch->near;
 
-    /* copy property to first 'rule' slot */
-    va_s[0] = va[0];
-    for (int k=0; k<SIZE; k++)
+    /* copy property into the slice */
+    memcpy(slice->prop_lo, layout->prop_lo, sizeof(slice->prop_lo));
+    memcpy(slice->prop_hi, layout->prop_hi, sizeof(slice->prop_hi));
+    slice->action = layout->action;
+    slice->values_n = 0;
+    slice->extra = 0;
+
+    uint32_t dlo[SIZE], dhi[SIZE]; // bounds of the disagreeing rule
+    for (uint32_t j=0; j<SIZE; j++)
     {
-        lo_s[k] = lo[k];
-        hi_s[k] = hi[k];
+        dlo[j] = layout->lo[j][d];
+        dhi[j] = layout->hi[j][d];
     }
 
-    // arrays to 'hide' rules which do not intersect the property being evaluated
-    uint32_t *mask = malloc(sizeof(*mask)*SIZE*count),
-             *mask_s = malloc(sizeof(*mask_s)*SIZE*count);
+    /* find the rules before the disagreeing rule which may intersect it */
+    uint32_t near_n = (bounds != NULL) ? bounds_query(bounds, dlo, dhi, d, near) : NO_RULE;
+    bool all = (near_n == NO_RULE); // true to visit every rule before the disagreeing rule
+    if (all)
+    {
+        near_n = d;
+        *scanned += d;
+    }
+    else
+    {   // restore rule order
+        near_n = sort_unique(near, tmp, near_n);
+    }
 
-    /* project over rule */
-    for (int i=1; i<count; i++) // for each rule
+    /* gather the agreeing rules which come before the disagreeing rule,
+     * projected over the hull of it, rules which miss the hull are hidden */
+    uint32_t count_s = 0; // count of rules in slice
+    for (uint32_t n=0; n<near_n; n++)
     {
-        uint32_t p = i * SIZE; // offset of rule start
-        for (int k = 0; k < SIZE; k++)  // for each field in rule
-        {   /* do projection */
-            uint32_t z = p + k;   // current position
-            if (hi[z] < lo[k] || lo[z] > hi[k])
-            {
-                mask[i] = 0; // ignore this rule in future processing
-                break;
-            }
-            else
-            {
-                hi_n[z] = (hi[z] < hi[k]) ? hi[z] : hi[k]; // set hi to min
-                lo_n[z] = (lo[z] < lo[k]) ? lo[k] : lo[z]; // set lo to max
-                mask[i] = 1; // do not ignore this rule
-            }
+        uint32_t i = (all) ? n : near[n];
+        if (layout->va[i] != layout->action)
+            continue;
+        count_s += layout_clip(layout, i, dlo, dhi, slice, count_s);
+    }
+
+    // add slice's disagree rule
+    layout_clip(layout, d, dlo, dhi, slice, count_s);
+    slice->count = ++count_s;
+    start = stats_phase(opt->stats, PHASE_SLICE, start);
+    if (opt->stats != NULL)
+    {
+        atomic_fetch_add_explicit(&opt->stats->slices, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&opt->stats->sliced, count_s, memory_order_relaxed);
+    }
+
+    /* end point generation */
+    uint32_t points = layout_points(slice);
+    for (uint32_t j=0; j<SIZE; j++) indices[j] = 0; // zero-out indices counters
+    for (uint32_t l=0; l<count_s; l++) // for each rule in slice
+    {
+        for (uint32_t j=0; j<SIZE; j++) // for each field
+            indices[j] = add_endpoints(slice, l, j, l != count_s - 1, &set[j*points], indices[j]);
+    }
+
+    /* sort the end-points of each field and drop duplicates */
+    for (uint32_t j=0; j<SIZE; j++)
+        indices[j] = sort_unique(&set[j*points], tmp, indices[j]);
+    start = stats_phase(opt->stats, PHASE_ENDPOINTS, start);
+    stats_set(opt->stats, indices);
+
+    /* apply least witness algorithm on slice */
+    int found = search_candidates(slice, set, indices, opt, cancel, cancel_arg, scratch->packed, witness);
+    stats_phase(opt->stats, PHASE_SEARCH, start);
+    return found;
+}
+
+// test with slicing, using preallocated buffers, 1 if a witness was found, 0 if not, -1 if memory could not be allocated
+static int run_with_slicing(const struct layout *layout, struct scratch *scratch, const struct options *opt,
+                            uint32_t *witness)
+{
+    uint32_t count = layout->count;
+
+    /* the rules which may intersect a disagreeing rule are found through sorted
+     * bounds once scanning every rule before each disagreeing rule has cost
+     * more than sorting would */
+    struct bounds *bounds = NULL;
+    uint64_t scanned = 0;
+
+    /* form and test one slice for each disagreeing rule, until one holds a witness */
+    int found = 0;
+    for (uint32_t d=0; d<count && found == 0; d++)
+    {
+        if (layout->va[d] == layout->action)
+            continue;
+        if (bounds == NULL && scanned >= SLICE_SCAN_MAX*count)
+        {
+            bounds = bounds_build(layout);
+            scanned = 0;
         }
+        found = test_slice(layout, d, bounds, scratch, opt, NULL, NULL, &scanned, witness);
     }
 
-    /* form and test slices */
-    uint32_t pos = 0, count_s;
-    while (pos+1 < count)
+    bounds_free(bounds);
+    return found;
+}
+
+/** state shared by the workers testing the slices of one layout */
+struct slicing
+{
+    const struct layout *layout;
+    const struct bounds *bounds; // sorted bounds of the layout, NULL to scan the rules
+    const uint32_t *disagree;    // position of the disagreeing rule of each slice
+    struct options opt;          // options used for each slice
+    uint32_t workers;            // number of workers testing slices
+    _Atomic uint64_t *ranges;    // slices still owned by each worker
+    _Atomic uint32_t best;       // lowest slice in which a witness has been found
+    _Atomic bool failed;         // set if memory could not be allocated, which abandons every slice
+    struct scratch *scratch;     // per worker: slice and end-point buffers
+    uint32_t *found;             // per worker: lowest slice with a witness, followed by that witness
+};
+
+/** a slice being tested, used to poll for cancellation */
+struct slice_unit
+{
+    struct slicing *slicing;
+    uint32_t id;
+};
+
+// true once a witness has been found in a slice lower than the one being tested, or a slice failed
+static bool slice_stop(void *arg)
+{
+    struct slice_unit *unit = arg;
+    return atomic_load_explicit(&unit->slicing->best, memory_order_relaxed) < unit->id
+           || atomic_load_explicit(&unit->slicing->failed, memory_order_relaxed);
+}
+
+// work through slices until none are left
+static void slicing_task(void *arg, uint32_t worker)
+{
+    struct slicing *s = arg;
+    uint32_t *found = &s->found[worker*(SIZE+1)], witness[SIZE], id;
+    uint64_t scanned = 0;
+    while (ranges_next(s->ranges, s->workers, worker, &id))
     {
-        count_s = 1; // count of rules in slice
-        /* loop through rules and build slice */
-        for (uint32_t i=1; i<count; i++)
+        struct slice_unit unit = {s, id};
+        if (slice_stop(&unit)) // a lower slice already holds a witness
+            continue;
+        int status = test_slice(s->layout, s->disagree[id], s->bounds, &s->scratch[worker], &s->opt,
+                                slice_stop, &unit, &scanned, witness);
+        if (status < 0)
+            atomic_store(&s->failed, true);
+        if (status <= 0)
+            continue;
+
+        // a slice cancelled part way may report a witness which is not its least, it is never used
+        if (id < found[0] && !slice_stop(&unit))
         {
-            if (mask[i]) // if the rule intersects with the property
-            {
-                /* if agreeing rule, add to slice  */
-                if (va[i] == va[0])
-                {
-                    va_s[count_s] = va[i];
-                    for (int k=0; k<SIZE; k++)
-                    {
-                        lo_s[SIZE*count_s+k] = lo_n[SIZE*i+k];
-                        hi_s[SIZE*count_s+k] = hi_n[SIZE*i+k];
-                    }
-                    count_s++;
-                }
-
-                /* if next disagree rule has been reached -> do
-                 * add to slice, project slice, do cartesian product testing*/
-                if (va[i] != va[0] && i > pos)
-                {
-                    /* initialize and zero arrays to represent the set of end-points */
-                    for (int p=0; p<SIZE; p++) indices[p] = 0; // zero-out indices counters
-
-                    // add slice's disagree rule
-                    va_s[count_s] = va[i];
-                    for (int k=0; k<SIZE; k++)
-                    {
-                        lo_s[SIZE*count_s+k] = lo_n[SIZE*i+k];
-                        hi_s[SIZE*count_s+k] = hi_n[SIZE*i+k];
-                    }
-                    count_s++;
-
-                    /* do projection and end point generation*/
-                    for (uint32_t l=1; l<count_s; l++) // for each rule in slice
-                    {
-                        for (uint32_t j=0; j<SIZE; j++) // for each field
-                        {
-                            uint32_t k = ((count_s - 1) * SIZE) + j;
-                            uint32_t z = (l * SIZE) + j;
-                            // if not last rule, project over disagreeing rule
-                            if (l != count_s - 1)
-                            {
-                                if (hi_s[z] < lo_s[k] || lo_s[z] > hi_s[k]) // out-of-bounds
-                                {
-                                    mask_s[l] = 0;
-                                    break;
-                                }
-                                else // otherwise do projection as usual
-                                {
-                                    hi_s[z] = (hi_s[z] < hi_s[k]) ? hi_s[z] : hi_s[k];
-                                    lo_s[z] = (lo_s[z] < lo_s[k]) ? lo_s[k] : lo_s[z];
-                                    mask_s[l] = 1;
-                                }
-                            }
-                            else // last rule in slice == disagree rule
-                            {
-                                mask_s[l] = 1;
-                            }
-                        }
-                        // if the rule was not hidden in the previous projection,
-                        // calculate the possible end points
-                        if (mask_s[i])
-                        {
-                            for (uint32_t j=0; j<SIZE; j++) // for each field
-                            {   /* calculate end-point */
-                                uint32_t endp, unique = 1;
-                                uint32_t k = ((count_s - 1) * SIZE) + j;
-                                uint32_t z = (l * SIZE) + j;
-                                if (l != count_s - 1)
-                                    endp = hi_s[z] + 1;
-                                else
-                                    endp = lo_s[k];
-
-                                // only add to set if end-point is within the property range
-                                if (endp <= hi[j] && endp >= lo[j])
-                                {   // check if value already exists in set
-                                    for (int o=0; o<indices[j]; o++)
-                                    {
-                                        if (set[j*count_s+o] == endp)
-                                        {
-                                            unique = 0;
-                                            break;
-                                        }
-                                    }
-                                    if (unique) // add to set if unique
-                                    {
-                                        set[j*count_s+indices[j]] = endp;
-                                        indices[j] += 1;
-                                    }
-                                }
-                            }
-                        }
-                    }
-
-                    /* apply least witness algorithm on slice */
-                    witness = test_candidates(lo_s, hi_s, va_s, count_s, set, indices, mask_s);
-                    if (witness != NULL) goto end;
-
-                    // set new max pos and
-                    // restart slice-building loop
-                    pos = i;
-                    break;
-                }
-            }
-            // set max position reached
-            if (i>pos) pos = i;
+            found[0] = id;
+            memcpy(&found[1], witness, sizeof(witness));
+            uint32_t best = atomic_load(&s->best);
+            while (id < best && !atomic_compare_exchange_weak(&s->best, &best, id));
+        }
+    }
+}
+
+// test the slices on the workers of a pool, 1 if a witness was found, 0 if not, -1 if memory could not be allocated
+static int parallel_slicing(const struct layout *layout, const uint32_t *disagree, uint32_t slices,
+                            const struct options *opt, uint32_t *witness)
+{
+    struct slicing s = {layout, NULL, disagree, *opt, pool_size(opt->pool)};
+    struct workspace local, *ws = workspace_of(opt, &local);
+    int found = -1;
+    s.opt.pool = NULL;
+
+    /* the slices are not tested in turn, so sorted bounds are built up front
+     * if scanning the rules before each disagreeing rule would cost more */
+    uint64_t scan = 0;
+    for (uint32_t i=0; i<slices; i++) scan += disagree[i];
+    struct bounds *bounds = NULL;
+    if (scan >= SLICE_SCAN_MAX*layout->count)
+        s.bounds = bounds = bounds_build(layout);
+
+    s.found = malloc(sizeof(*s.found)*(SIZE+1)*s.workers);
+    if (s.found == NULL || workspace_grow(ws, layout, s.workers, true, false))
+        goto end;
+    s.ranges = ws->ranges;
+    s.scratch = ws->scratch;
+    for (uint32_t w=0; w<s.workers; w++) s.found[w*(SIZE+1)] = UINT32_MAX;
+    ranges_init(s.ranges, s.workers, slices);
+    atomic_init(&s.best, UINT32_MAX);
+    atomic_init(&s.failed, false);
+
+    pool_run(opt->pool, slicing_task, &s);
+    if (atomic_load(&s.failed))
+        goto end;
+
+    /* the witness of the lowest slice is the one found when slices are tested in turn */
+    found = 0;
+    uint32_t best = atomic_load(&s.best);
+    for (uint32_t w=0; w<s.workers && best != UINT32_MAX && !found; w++)
+    {
+        if (s.found[w*(SIZE+1)] == best)
+        {
+            memcpy(witness, &s.found[w*(SIZE+1)+1], sizeof(*witness)*SIZE);
+            found = 1;
         }
     }
 
 end:
-    free(set);
-    free(indices);
-    free(mask);
-    free(mask_s);
-    free(lo_n);
-    free(hi_n);
-    free(lo_s);
-    free(hi_s);
-    free(va_s);
-    return witness;
+    if (ws == &local)
+        workspace_release(&local);
+    free(s.found);
+    bounds_free(bounds);
+    return found;
+}
+
+// test with slicing
+int with_slicing(const struct layout *layout, uint32_t *witness, const struct options *opt)
+{
+    /* slices are divided between the workers when there are enough of them,
+     * otherwise they are tested in turn and each one uses the whole pool */
+    if (pool_size(opt->pool) > 1)
+    {
+        uint32_t *disagree = malloc(sizeof(*disagree)*layout->count + 1), slices = 0;
+        if (disagree == NULL)
+            return -1;
+        for (uint32_t d=0; d<layout->count; d++)
+        {
+            if (layout->va[d] != layout->action)
+                disagree[slices++] = d;
+        }
+        bool parallel = slices >= pool_size(opt->pool);
+        int found = (parallel) ? parallel_slicing(layout, disagree, slices, opt, witness) : 0;
+        free(disagree);
+        if (parallel)
+            return found;
+    }
+
+    struct workspace local, *ws = workspace_of(opt, &local);
+    int found = -1;
+    if (!workspace_grow(ws, layout, 1, true, false))
+        found = run_with_slicing(layout, &ws->scratch[0], opt, witness);
+    if (ws == &local)
+        workspace_release(&local);
+    return found;
+}
+
+// test without slicing, using preallocated buffers, 1 if a witness was found, 0 if not, -1 if memory could not be allocated
+static int run_without_slicing(const struct layout *layout, struct scratch *scratch, const struct options *opt,
+                               uint32_t *witness)
+{
+    uint32_t count = layout->count, points = layout_points(layout);
+
+    /* arrays to represent the set of end-points */
+    uint32_t *set = scratch->set; // set of possible end-points (fields indexed by n*points)
+    uint32_t indices[SIZE];       // size of set for each field
+    uint32_t *tmp = scratch->tmp; // scratch space used when sorting a field
+    for (uint32_t i=0; i<SIZE; i++) indices[i] = 0; // zero-out indices counters
+    uint64_t start = stats_clock(opt->stats);
+
+    /* determine the end-points each projected rule adds to the end point set */
+    for (uint32_t i=0; i<count; i++) // for each rule
+    {
+        for (uint32_t k=0; k<SIZE; k++)  // for each field in rule
+            indices[k] = add_endpoints(layout, i, k, layout->va[i] == layout->action, &set[k*points], indices[k]);
+    }
+
+    /* sort the end-points of each field and drop duplicates */
+    for (uint32_t k=0; k<SIZE; k++)
+        indices[k] = sort_unique(&set[k*points], tmp, indices[k]);
+    start = stats_phase(opt->stats, PHASE_ENDPOINTS, start);
+    stats_set(opt->stats, indices);
+
+    /* test candidate witnesses */
+    int found = search_candidates(layout, set, indices, opt, NULL, NULL, scratch->packed, witness);
+    stats_phase(opt->stats, PHASE_SEARCH, start);
+    return found;
 }
 
 // test without slicing
-uint32_t* without_slicing(const uint32_t *lo, const uint32_t *hi, const uint32_t *va, uint32_t count)
+int without_slicing(const struct layout *layout, uint32_t *witness, const struct options *opt)
+{
+    struct workspace local, *ws = workspace_of(opt, &local);
+    int found = -1;
+    if (!workspace_grow(ws, layout, 1, false, false))
+        found = run_without_slicing(layout, &ws->scratch[0], opt, witness);
+    if (ws == &local)
+        workspace_release(&local);
+    return found;
+}
+
+/** state shared by the workers verifying a batch of properties */
+struct batch
+{
+    const struct layout *rules;                  // firewall rules, column-wise and not yet projected
+    const struct bounds *bounds;                 // bounds of the rules sorted per field, NULL to visit every rule
+    const uint32_t *prop_lo, *prop_hi, *prop_va; // SIZE bounds and one action per property
+    uint32_t props;                              // number of properties
+    struct options opt;                          // options used for each property
+    uint32_t workers;                            // number of workers verifying properties
+    _Atomic uint64_t *ranges;                    // properties still owned by each worker
+    struct layout **layouts;                     // per worker: rules projected over its property
+    struct scratch *scratch;                     // per worker: search buffers
+    uint64_t *marks;                             // per worker: rules visited while projecting
+    uint32_t *witnesses;                         // SIZE values per property
+    bool *found;                                 // per property: true if a witness was found
+    _Atomic bool failed;                         // set if memory could not be allocated, which ends the batch
+};
+
+// verify properties until none are left
+static void batch_task(void *arg, uint32_t worker)
+{
+    struct batch *b = arg;
+    struct layout *layout = b->layouts[worker];
+    uint64_t *marks = &b->marks[(uint64_t)worker*((b->rules->count+63)/64)];
+    uint32_t p;
+    while (!atomic_load_explicit(&b->failed, memory_order_relaxed) && ranges_next(b->ranges, b->workers, worker, &p))
+    {
+        uint64_t start = stats_clock(b->opt.stats);
+        layout_project(b->rules, b->bounds, marks, &b->prop_lo[p*SIZE], &b->prop_hi[p*SIZE], b->prop_va[p], layout);
+        stats_phase(b->opt.stats, PHASE_PROJECT, start);
+        stats_projected(b->opt.stats, layout);
+        int found;
+        if (b->opt.slicing)
+            found = run_with_slicing(layout, &b->scratch[worker], &b->opt, &b->witnesses[p*SIZE]);
+        else
+            found = run_without_slicing(layout, &b->scratch[worker], &b->opt, &b->witnesses[p*SIZE]);
+        b->found[p] = (found > 0);
+        if (found < 0)
+            atomic_store(&b->failed, true);
+    }
+}
+
+// verify a batch of properties against rules already laid out
+int find_witnesses_in(const struct layout *rules, const struct bounds *bounds,
+                      const uint32_t *prop_lo, const uint32_t *prop_hi, const uint32_t *prop_va, uint32_t props,
+                      uint32_t *witnesses, bool *found, const struct options *opt)
 {
-    /* copy original values into temporary buffer */
-    uint32_t *lo_n = malloc(sizeof(*lo_n)*SIZE*count), // lower-bounds of firewall rules
-            *hi_n = malloc(sizeof(*hi_n)*SIZE*count);  // upper-bounds of firewall rules
+    struct batch b = {rules, bounds, prop_lo, prop_hi, prop_va, props, *opt};
+    struct workspace local, *ws = workspace_of(opt, &local);
+    int err = -1;
 
-    // arrays to 'hide' rules which do not intersect the property being evaluated
-    uint32_t *mask = malloc(sizeof(*mask)*SIZE*count);
+    /* properties are divided between the workers when there are enough of them,
+     * otherwise they are verified in turn and each one uses the whole pool */
+    b.workers = 1;
+    if (pool_size(opt->pool) > 1 && props >= pool_size(opt->pool))
+    {
+        b.workers = pool_size(opt->pool);
+        b.opt.pool = NULL;
+    }
+
+    /* each property only projects the rules, into buffers sized for every projection */
+    if (!workspace_grow(ws, rules, b.workers, opt->slicing, true))
+    {
+        b.marks = ws->marks;
+        b.ranges = ws->ranges;
+        b.layouts = ws->layouts;
+        b.scratch = ws->scratch;
+        b.witnesses = witnesses;
+        b.found = found;
+        ranges_init(b.ranges, b.workers, props);
+        atomic_init(&b.failed, false);
+        if (b.workers > 1)
+            pool_run(opt->pool, batch_task, &b);
+        else
+            batch_task(&b, 0);
+        err = (atomic_load(&b.failed)) ? -1 : 0;
+    }
+    if (ws == &local)
+        workspace_release(&local);
+    return err;
+}
+
+// verify a batch of properties
+int find_witnesses(const uint32_t *lo, const uint32_t *hi, const uint32_t *va, uint32_t count,
+                   const struct ranges *ranges, const uint32_t *prop_lo, const uint32_t *prop_hi, const uint32_t *prop_va, uint32_t props,
+                   uint32_t *witnesses, bool *found, const struct options *opt)
+{
+    /* the firewall is laid out column-wise and its bounds sorted once */
+    struct layout *rules = layout_build_rules(lo, hi, va, count, ranges);
+    if (rules == NULL)
+        return -1;
+    struct bounds *bounds = bounds_build(rules);
+    int err = -1;
+    if (bounds != NULL)
+        err = find_witnesses_in(rules, bounds, prop_lo, prop_hi, prop_va, props, witnesses, found, opt);
+    bounds_free(bounds);
+    layout_free(rules);
+    return err;
+}
+
+/** state shared by the workers testing the candidates of one rule set */
+struct search
+{
+    const struct layout *layout;
+    const uint32_t *set, *indices;
+    struct index *index;      // decision tree, NULL unless the index engine is used
+    const struct packed *packed; // bounds of the rules packed for the range check, NULL to read the layout
+    struct bitset *bitset;    // bit-vectors, NULL unless the bitset engine is used
+    bool refine;              // true to search by branch-and-bound
+    uint32_t depth;           // number of leading fields enumerated by the work units
+    uint32_t workers;         // number of workers searching
+    _Atomic uint64_t *ranges; // units still owned by each worker
+    _Atomic uint32_t best;    // lowest unit in which a witness has been found
+    _Atomic bool failed;      // set if memory could not be allocated, which abandons every unit
+    uint32_t *found;          // per worker: lowest unit with a witness, followed by that witness
+    bool (*cancel)(void *);   // polled while searching, the search is abandoned once it returns true (may be NULL)
+    void *cancel_arg;         // argument passed to cancel
+    struct stats *stats;      // counters added to once per worker, NULL to leave them alone
+};
+
+/** a unit being searched, used to poll for cancellation */
+struct unit
+{
+    struct search *search;
+    uint32_t id;
+};
+
+/* true once a witness has been found in a unit lower than the one being searched,
+ * a unit failed or the search is cancelled */
+static bool unit_stop(void *arg)
+{
+    struct unit *unit = arg;
+    struct search *s = unit->search;
+    return atomic_load_explicit(&s->best, memory_order_relaxed) < unit->id
+           || atomic_load_explicit(&s->failed, memory_order_relaxed)
+           || (s->cancel != NULL && s->cancel(s->cancel_arg));
+}
 
-    /* initialize and zero arrays to represent the set of end-points */
-    uint32_t *set = malloc(sizeof(*set)*SIZE*count); // set of possible end-points (fields indexed by n*count)
-    uint32_t *indices = malloc(sizeof(*set)*SIZE);   // size of set for each field
-    for (int i=0; i<SIZE; i++) indices[i] = 0; // zero-out indices counters
+// find the first rule hit by a candidate, NO_RULE if no rule is hit
+static uint32_t first_hit(const struct search *s, const uint32_t *candidate)
+{
+    // the tree returns the first rule hit
+    if (s->index != NULL)
+        return index_lookup(s->index, s->layout, candidate);
+    if (s->packed != NULL)
+        return packed_first(s->packed, s->layout, candidate);
+    return layout_first(s->layout, candidate);
+}
+
+/* test the candidates of one work unit in lexicographic order, 1 if a witness was found (left in candidate),
+ * 0 if not, -1 if memory could not be allocated, the candidates tested and the rules scanned for them are
+ * added to tested and compared */
+static int search_unit(struct search *s, uint32_t id, uint32_t *candidate, uint64_t *tested, uint64_t *compared)
+{
+    const uint32_t *set = s->set, *indices = s->indices;
+    uint32_t points = layout_points(s->layout);
+    struct unit unit = {s, id};
+    uint32_t k[SIZE];
+
+    /* decode the unit into the end-points of the leading fields */
+    for (uint32_t f=s->depth, rest=id; f-- > 0;)
+    {
+        k[f] = rest % indices[f];
+        rest /= indices[f];
+    }
+
+    if (s->refine)
+        return refine_search(s->layout, set, indices, k, s->depth, unit_stop, &unit, candidate);
+    if (s->bitset != NULL)
+        return bitset_search(s->bitset, points, set, indices, k, s->depth, unit_stop, &unit, candidate);
 
-    /* nested for loop first projects the current field onto the property
-     * then determines the end-point to add to the end point set */
-    for (int i=1; i<count; i++) // for each rule
+    // form the first candidate of the unit
+    for (uint32_t f=s->depth; f<SIZE; f++) k[f] = 0;
+    for (uint32_t f=0; f<SIZE; f++) candidate[f] = set[f*points + k[f]];
+    for (;;)
     {
-        uint32_t p = i*SIZE; // offset of rule start
-        for (int k=0; k<SIZE; k++)  // for each field in rule
+        // if the matched rule conflicts, witness has been found
+        uint32_t i = first_hit(s, candidate);
+        *tested += 1;
+        *compared += (i == NO_RULE) ? s->layout->count : i + 1;
+        if (i != NO_RULE && s->layout->va[i] != s->layout->action)
+            return 1;
+        if (s->depth == SIZE)
+            return 0;
+
+        /* advance to the next candidate like an odometer, the last field turns fastest */
+        uint32_t f = SIZE-1;
+        while (++k[f] == indices[f])
         {
-            uint32_t z = p + k;   // current position
-            if (hi[z] < lo[k] || lo[z] > hi[k])
-            {
-                mask[i] = 0;
-                break;
-            }
-            else
-            {
-                hi_n[z] = (hi[z] < hi[k]) ? hi[z] : hi[k]; // set hi to min
-                lo_n[z] = (lo[z] < lo[k]) ? lo[k] : lo[z]; // set lo to max
-                mask[i] = 1;
-            }
+            k[f] = 0;
+            candidate[f] = set[f*points];
+            if (f == s->depth) // every candidate of the unit has been tested
+                return 0;
+            f--;
         }
+        candidate[f] = set[f*points + k[f]];
+        if (f < SIZE-1 && unit_stop(&unit))
+            return 0;
+    }
+}
 
-        if (mask[i]) // if projection did not hide the rule
+// work through units until none are left
+static void search_task(void *arg, uint32_t worker)
+{
+    struct search *s = arg;
+    uint32_t *found = &s->found[worker*(SIZE+1)], candidate[SIZE], id;
+    uint64_t tested = 0, compared = 0;
+    while (ranges_next(s->ranges, s->workers, worker, &id))
+    {
+        struct unit unit = {s, id};
+        if (unit_stop(&unit)) // a lower unit already holds a witness
+            continue;
+        int status = search_unit(s, id, candidate, &tested, &compared);
+        if (status < 0)
+            atomic_store(&s->failed, true);
+        if (status > 0 && id < found[0])
         {
-            for (int k=0; k<SIZE; k++)  // for each field in rule
-            {
-                uint32_t z = p + k;   // current position
-
-                /* calculate end-point */
-                uint32_t endp, unique=1;
-                if (va[i] == va[0])
-                    endp = hi_n[z]+1;
-                else
-                    endp = lo_n[z];
-
-                // only add to set if end-point is within the property range
-                if (endp <= hi[k] && endp >= lo[k])
-                {
-                    // check if value already exists in set
-                    for (int j=0; j<indices[k]; j++)
-                    {
-                        if (set[k*count+j] == endp)
-                        {
-                            unique = 0;
-                            break;
-                        }
-                    }
-                    if (unique) // add to set if unique
-                    {
-                        set[k*count+indices[k]] = endp;
-                        indices[k] += 1;
-                    }
-                }
-            }
+            found[0] = id;
+            memcpy(&found[1], candidate, sizeof(candidate));
+            uint32_t best = atomic_load(&s->best);
+            while (id < best && !atomic_compare_exchange_weak(&s->best, &best, id));
         }
     }
-    /* test candidate witnesses */
-    uint32_t* witness = test_candidates(lo, hi, va, count, set, indices, mask);
-    free(set);
-    free(indices);
-    free(mask);
-    return witness;
+
+    /* the tree finds the first rule hit without scanning, so only candidates are counted for it */
+    if (s->stats != NULL)
+    {
+        atomic_fetch_add_explicit(&s->stats->candidates, tested, memory_order_relaxed);
+        if (s->index == NULL)
+            atomic_fetch_add_explicit(&s->stats->comparisons, compared, memory_order_relaxed);
+    }
 }
 
-// cartesian product and testing
-uint32_t* test_candidates(const uint32_t *lo, const uint32_t *hi, const uint32_t *va,
-                          uint32_t count, const uint32_t *set, const uint32_t *indices,
-                          const uint32_t *mask)
+/* cartesian product and testing, abandoned once cancel returns true, the rules are packed into packed (may be NULL)
+ * for the scan, 1 if a witness was found (filled in), 0 if not, -1 if memory could not be allocated */
+static int search_candidates(const struct layout *layout, const uint32_t *set, const uint32_t *indices,
+                             const struct options *opt, bool (*cancel)(void *arg), void *cancel_arg,
+                             struct packed *packed, uint32_t *witness)
 {
-    uint32_t* candidate = malloc(SIZE * sizeof(*candidate));
-    for (int k1=0; k1<indices[0]; k1++)
+    /* size of the cartesian product, nothing to test if a field has no end-points */
+    uint64_t product = 1;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        if (indices[f] == 0)
+            return 0;
+        if (product < PARALLEL_MIN)
+            product *= indices[f];
+    }
+
+    struct search s = {layout, set, indices};
+    s.cancel = cancel;
+    s.cancel_arg = cancel_arg;
+    s.stats = opt->stats;
+
+    // bit-vectors replace the rule scan, which is kept if they are too large
+    if (opt->engine == ENGINE_BITSET)
+        s.bitset = bitset_build(layout, set, indices);
+
+    // decision tree used to find the first rule hit, scan the rule list if unavailable
+    if (opt->engine == ENGINE_INDEX)
+        s.index = index_build(layout);
+
+    // boxes of candidates are split and pruned rather than enumerated
+    s.refine = (opt->engine == ENGINE_REFINE);
+
+    // the scan reads the packed bounds, or the layout itself if a bound is too wide for its field
+    if (s.index == NULL && s.bitset == NULL && !s.refine && packed != NULL && product >= PACKED_MIN
+        && packed_fill(packed, layout))
+        s.packed = packed;
+
+    /* split the leading fields into work units when several workers are available */
+    uint32_t units = 1;
+    s.workers = 1;
+    if (pool_size(opt->pool) > 1 && product >= PARALLEL_MIN)
     {
-        for (int k2=0; k2<indices[1]; k2++)
+        s.workers = pool_size(opt->pool);
+        while (s.depth < SIZE && units < s.workers*UNITS_PER_WORKER
+               && (uint64_t)units*indices[s.depth] <= UINT32_MAX)
+            units *= indices[s.depth++];
+    }
+
+    /* a single worker, as when verifying a batch in parallel, keeps its state on the stack */
+    _Atomic uint64_t range;
+    uint32_t found[SIZE+1];
+    s.ranges = (s.workers > 1) ? malloc(sizeof(*s.ranges)*s.workers) : &range;
+    s.found = (s.workers > 1) ? malloc(sizeof(*s.found)*(SIZE+1)*s.workers) : found;
+    int status = -1;
+    if (s.ranges == NULL || s.found == NULL)
+        goto end;
+    ranges_init(s.ranges, s.workers, units);
+    for (uint32_t w=0; w<s.workers; w++) s.found[w*(SIZE+1)] = UINT32_MAX;
+    atomic_init(&s.best, UINT32_MAX);
+    atomic_init(&s.failed, false);
+
+    if (s.workers > 1)
+        pool_run(opt->pool, search_task, &s);
+    else
+        search_task(&s, 0);
+    if (atomic_load(&s.failed))
+        goto end;
+
+    /* the witness of the lowest unit is the first witness in lexicographic order */
+    status = 0;
+    uint32_t best = atomic_load(&s.best);
+    for (uint32_t w=0; w<s.workers && best != UINT32_MAX && !status; w++)
+    {
+        if (s.found[w*(SIZE+1)] == best)
         {
-            for (int k3=0; k3<indices[2]; k3++)
-            {
-                for (int k4=0; k4<indices[3]; k4++)
-                {
-                    for (int k5=0; k5<indices[4]; k5++)
-                    {   // form a unique witness
-                        candidate[0] = set[k1];
-                        candidate[1] = set[count+k2];
-                        candidate[2] = set[2*count+k3];
-                        candidate[3] = set[3*count+k4];
-                        candidate[4] = set[4*count+k5];
-                        for (int i=1; i<count; i++) // compare witness to each firewall
-                        {
-                            if (mask[i]) // ignore hidden rules
-                            {
-                                // determine if candidate will hit the rule
-                                int hit = 1; // assume candidate will hit
-                                for (int j=0; j<SIZE; j++)
-                                {   // search for fields which miss
-                                    if (candidate[j] > hi[i*SIZE+j]     // if candidate greater than max bound
-                                        || candidate[j] < lo[i*SIZE+j]) // or less than lower bound
-                                    {   // candidate witness did not hit the rule
-                                        hit = 0;
-                                        break;
-                                    }
-                                }
-                                if (hit)
-                                {   // if the matched rule conflicts, witness has been found
-                                    if (va[0] != va[i])
-                                        return candidate;
-                                    break; // otherwise, move to next candidate
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+            memcpy(witness, &s.found[w*(SIZE+1)+1], sizeof(*witness)*SIZE);
+            status = 1;
         }
     }
-    // no witness found
-    free(candidate);
-    return NULL;
+
+end:
+    if (s.workers > 1)
+    {
+        free(s.ranges);
+        free(s.found);
+    }
+    index_free(s.index);
+    bitset_free(s.bitset);
+    return status;
+}
+
+// cartesian product and testing
+int test_candidates(const struct layout *layout, const uint32_t *set, const uint32_t *indices,
+                    uint32_t *witness, const struct options *opt)
+{
+    return search_candidates(layout, set, indices, opt, NULL, NULL, NULL, witness);
 }
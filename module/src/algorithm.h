@@ -11,12 +11,156 @@
 #ifndef IPTABLES_VERIFICATION_RULES_H
 #define IPTABLES_VERIFICATION_RULES_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 
-/** SIZE is the number of fields of a rule, the number here must
-   match the number of for loops used when testing candidates */
-#define SIZE ((uint32_t) 5)
+struct pool;
+struct layout;
+struct bounds;
+struct workspace;
+
+/**
+ * the fields of a rule in order, each with the bits its values need and
+ * the lowest and highest value of a rule matching any packet, SIZE, the
+ * field positions, the unbounded rule and the packed columns of the
+ * range check kernels (see struct packed) all follow from this list,
+ * values are held in a uint32_t so a field may need 8, 16 or 32 bits
+ */
+#define FIELDS(X)                   \
+    X(SADDR, 32, 0, UINT32_MAX)     \
+    X(SPORT, 16, 1, 65535)          \
+    X(DADDR, 32, 0, UINT32_MAX)     \
+    X(DPORT, 16, 1, 65535)          \
+    X(PROTO, 8, 0, 255)
+
+#define FIELD_NAME(name, bits, min, max) name,
+#define FIELD_ONE(name, bits, min, max) +1
+#define FIELD_MIN(name, bits, min, max) min,
+#define FIELD_MAX(name, bits, min, max) max,
+
+/** positions of the fields of a rule */
+enum field { FIELDS(FIELD_NAME) };
+
+/** SIZE is the number of fields of a rule */
+#define SIZE ((uint32_t) (0 FIELDS(FIELD_ONE)))
+
+/** bounds of the rule matching any packet, initialisers of arrays of SIZE */
+#define ANY_LO {FIELDS(FIELD_MIN)}
+#define ANY_HI {FIELDS(FIELD_MAX)}
+
+/** matchers which test_candidates may use to find the first rule a candidate hits */
+enum engine
+{
+    ENGINE_SCAN = 0,   // scan the rule list in order
+    ENGINE_INDEX = 1,  // look up the rule in a decision tree built over the projected rules
+    ENGINE_BITSET = 2, // AND per-field bit-vectors of the rules covering each end-point
+    ENGINE_REFINE = 3  // split the box of candidates, dropping boxes which can not hold a witness
+};
+
+/** most disjoint ranges a single field of a rule may hold */
+#define FIELD_RANGES ((uint32_t) 15)
+
+/**
+ * ranges of the multi-valued rules of a firewall, so that a rule such as
+ * "--dports 22,80,443" stays a single rule rather than one rule per port
+ *
+ * a rule whose record is 0 is the box given by its lo & hi bounds, otherwise
+ * its lo & hi bounds are ignored and values[record-1] starts the record of the
+ * rule: the number of ranges of each of the SIZE fields (1 to FIELD_RANGES)
+ * followed by the lo,hi pairs of every range, field by field, each field's
+ * ranges in ascending order and disjoint (see ranges_sort)
+ */
+struct ranges
+{
+    const uint32_t *record; // one per rule, the first ONE element (the property slot) is ignored
+    const uint32_t *values; // records of the multi-valued rules
+};
+
+/** phases of a search timed by struct stats */
+enum phase
+{
+    PHASE_PROJECT = 0,   // projecting the rules over the property
+    PHASE_SLICE = 1,     // gathering the rules of each slice
+    PHASE_ENDPOINTS = 2, // collecting and sorting the end-points of each field
+    PHASE_SEARCH = 3,    // testing candidates
+    PHASES = 4
+};
+
+/**
+ * counters and timings of the searches made with a set of options, every
+ * worker adds to them as it finishes a unit of work so that they cost next
+ * to nothing while candidates are tested, times are summed over workers
+ */
+struct stats
+{
+    _Atomic uint64_t properties;          // properties whose rules were projected
+    _Atomic uint64_t projected;           // rules surviving projection, over every property
+    _Atomic uint64_t slices;              // slices formed
+    _Atomic uint64_t sliced;              // rules of the slices, over every slice
+    _Atomic uint64_t sets;                // end-point sets formed, one per slice or per property without slicing
+    _Atomic uint64_t endpoints[SIZE];     // end-points of each field, over every set
+    _Atomic uint64_t endpoints_max[SIZE]; // most end-points of each field in a single set
+    _Atomic uint64_t candidates;          // candidates tested one at a time (the scan & index engines)
+    _Atomic uint64_t comparisons;         // rules range checked against those candidates (the scan engine)
+    _Atomic uint64_t ns[PHASES];          // nanoseconds spent in each phase
+};
+
+/** options which select how a witness is searched for */
+struct options
+{
+    bool slicing;       // true to use with_slicing, otherwise use without_slicing
+    enum engine engine; // matcher used when testing candidates
+    struct pool *pool;  // workers which test candidates in parallel, NULL to use the calling thread only
+    struct workspace *workspace; // search buffers kept from one call to the next, NULL to allocate them on each call
+    struct stats *stats;         // counters added to by each search, NULL to leave them alone
+};
+
+/**
+ * zeroes the counters and timings of searches
+ * @param stats counters to clear
+ */
+void stats_clear(struct stats *stats);
+
+/**
+ * allocates an empty workspace, the buffers a search needs (projected rules,
+ * slices, end-point sets and the state of each worker) are then taken from it
+ * rather than allocated and released on every call, they only grow when the
+ * rules or the workers outgrow them, a workspace is used by one call at a time
+ * @return the workspace, or NULL if memory could not be allocated
+ */
+struct workspace* workspace_alloc(void);
+
+/**
+ * grows the buffers of a workspace up front to those find_witnesses_in needs
+ * to verify properties against a set of rules, so that searching them later
+ * allocates nothing
+ * @param workspace workspace created by workspace_alloc
+ * @param rules     layout created by layout_build_rules
+ * @param opt       slicing and worker pool the properties will be verified with
+ * @return 0 on success, -1 if memory could not be allocated (the buffers held are kept)
+ */
+int workspace_reserve(struct workspace *workspace, const struct layout *rules, const struct options *opt);
+
+/**
+ * memory held by the buffers of a workspace
+ * @param workspace workspace created by workspace_alloc (may be NULL)
+ * @return the number of bytes held
+ */
+size_t workspace_bytes(const struct workspace *workspace);
+
+/**
+ * releases the buffers held by a workspace, which stays usable
+ * @param workspace workspace created by workspace_alloc (may be NULL)
+ */
+void workspace_release(struct workspace *workspace);
+
+/**
+ * releases a workspace and its buffers
+ * @param workspace workspace created by workspace_alloc (may be NULL)
+ */
+void workspace_free(struct workspace *workspace);
 
 /**
  * wrapper to allow for easier toggling of usage of slices
@@ -27,12 +171,68 @@
  * @param va     action value for each rule
  *               the first ONE element specifies the property action
  * @param count  number of property & firewall rules supplied
- * @return a witness vector or NULL, if not NULL caller is responsible for freeing witness
- * @param slicing true to indicate that the with_slicing function should
- *               be used, otherwise use least_witness
- * @return
+ * @param ranges  ranges of the multi-valued rules, NULL if every rule is a box
+ * @param witness array of FIVE elements, filled with the witness if the property fails
+ * @param opt     selects slicing and the candidate matching engine
+ * @return 1 if a witness was found, 0 if the property passes, -1 if memory could not be allocated
+ */
+int find_witness(const uint32_t* lo, const uint32_t* hi, const uint32_t* va, uint32_t count,
+                 const struct ranges *ranges, uint32_t *witness, const struct options *opt);
+
+/**
+ * verifies several properties of the same firewall, the firewall is laid out
+ * column-wise once and search buffers are reused from one property to the next,
+ * properties are divided between the workers of the pool when there are enough
+ *
+ * @param lo        lower bounds for firewall rules
+ *                  the first FIVE elements (the property slot) are ignored
+ * @param hi        upper bounds of firewall rules
+ *                  the first FIVE elements (the property slot) are ignored
+ * @param va        action value for each rule
+ *                  the first ONE element (the property slot) is ignored
+ * @param count     number of property & firewall rules supplied
+ * @param ranges    ranges of the multi-valued rules, NULL if every rule is a box
+ * @param prop_lo   lower bounds of the properties, FIVE elements per property
+ * @param prop_hi   upper bounds of the properties, FIVE elements per property
+ * @param prop_va   action value of each property
+ * @param props     number of properties
+ * @param witnesses array of FIVE elements per property, filled with the witness of each failing property
+ * @param found     array of one element per property, set true when a witness was found
+ * @param opt       selects slicing, the candidate matching engine and the worker pool
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int find_witnesses(const uint32_t *lo, const uint32_t *hi, const uint32_t *va, uint32_t count,
+                   const struct ranges *ranges,
+                   const uint32_t *prop_lo, const uint32_t *prop_hi, const uint32_t *prop_va, uint32_t props,
+                   uint32_t *witnesses, bool *found, const struct options *opt);
+
+/**
+ * verifies several properties of a firewall already laid out column-wise,
+ * such as one mapped from a snapshot (see find_witnesses)
+ *
+ * @param rules     layout created by layout_build_rules
+ * @param bounds    bounds created by bounds_build from rules, NULL to visit every rule of each property
+ * @param prop_lo   lower bounds of the properties, FIVE elements per property
+ * @param prop_hi   upper bounds of the properties, FIVE elements per property
+ * @param prop_va   action value of each property
+ * @param props     number of properties
+ * @param witnesses array of FIVE elements per property, filled with the witness of each failing property
+ * @param found     array of one element per property, set true when a witness was found
+ * @param opt       selects slicing, the candidate matching engine and the worker pool
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int find_witnesses_in(const struct layout *rules, const struct bounds *bounds,
+                      const uint32_t *prop_lo, const uint32_t *prop_hi, const uint32_t *prop_va, uint32_t props,
+                      uint32_t *witnesses, bool *found, const struct options *opt);
+
+/**
+ * sorts the ranges of a field and merges those which overlap or touch,
+ * turning any list of ranges into the form expected by struct ranges
+ * @param pairs n lo,hi pairs, each with lo <= hi, rewritten in place
+ * @param n     number of ranges
+ * @return the number of ranges left
  */
-uint32_t* find_witness(const uint32_t* lo, const uint32_t* hi, const uint32_t* va, uint32_t count, bool slicing);
+uint32_t ranges_sort(uint32_t *pairs, uint32_t n);
 
 /**
  * divides the firewall into firewall 'slices' and projects
@@ -40,48 +240,36 @@ uint32_t* find_witness(const uint32_t* lo, const uint32_t* hi, const uint32_t* v
  *
  * this function wraps around the least_witness algorithm
  *
- * @param lo     lower bounds for firewall rules
- *               the first FIVE elements specify the property fields
- * @param hi     upper bounds of firewall rules
- *               the first FIVE elements specify the property fields
- * @param va     action value for each rule
- *               the first ONE element specifies the property action
- * @param count  number of property & firewall rules supplied
- * @return a witness vector or NULL, if not NULL caller is responsible for freeing witness
+ * @param layout  rules projected over the property (see layout.h)
+ * @param witness array of SIZE elements, filled with the witness if one is found
+ * @param opt     selects the candidate matching engine
+ * @return 1 if a witness was found, 0 if not, -1 if memory could not be allocated
  */
-uint32_t* with_slicing(const uint32_t* lo, const uint32_t* hi, const uint32_t* va, uint32_t count);
+int with_slicing(const struct layout *layout, uint32_t *witness, const struct options *opt);
 
 /**
- * projects firewall rules over the property, generates test points,
+ * generates test points from the projected rules,
  * and evaluates candidate witness packets
  *
- * @param lo     lower bounds for firewall rules
- *               the first FIVE elements specify the property fields
- * @param hi     upper bounds of firewall rules
- *               the first FIVE elements specify the property fields
- * @param va     action value for each rule
- *               the first ONE element specifies the property action
- * @param count  number of property & firewall rules supplied
- * @return a witness vector or NULL, if not NULL caller is responsible for freeing witness
+ * @param layout  rules projected over the property (see layout.h)
+ * @param witness array of SIZE elements, filled with the witness if one is found
+ * @param opt     selects the candidate matching engine
+ * @return 1 if a witness was found, 0 if not, -1 if memory could not be allocated
  */
-uint32_t* without_slicing(const uint32_t *lo, const uint32_t *hi, const uint32_t *va, uint32_t count);
+int without_slicing(const struct layout *layout, uint32_t *witness, const struct options *opt);
 
 
 /**
  * forms cartesian product candidate packets and compare to firewall rule list
- * @param lo      lower bounds for firewall rules
- *                the first FIVE elements specify the property fields
- * @param hi      upper bounds of firewall rules
- *                the first FIVE elements specify the property fields
- * @param va      action value for each rule
- *                the first ONE element specifies the property action
- * @param count   number of property & firewall rules supplied
- * @param set     set (as an array SIZE*count) of unique possible endpoints
+ * @param layout  rules the candidates are compared to, in priority order
+ * @param set     set (as an array SIZE*layout_points(layout)) of unique possible endpoints
  * @param indices the number of endpoints for each field (an array of SIZE)
- * @return a witness vector or NULL, if not NULL caller is responsible for freeing witness
+ * @param witness array of SIZE elements, filled with the witness if one is found
+ * @param opt     selects the matcher used to find the first rule a candidate hits,
+ *                and the pool of workers the candidates are divided between
+ * @return 1 if a witness was found, 0 if not, -1 if memory could not be allocated
  */
-uint32_t* test_candidates(const uint32_t *lo, const uint32_t *hi, const uint32_t *va,
-                          uint32_t count, const uint32_t *set, const uint32_t *indices,
-                          const uint32_t *mask);
+int test_candidates(const struct layout *layout, const uint32_t *set, const uint32_t *indices,
+                    uint32_t *witness, const struct options *opt);
 
 #endif //IPTABLES_VERIFICATION_RULES_H
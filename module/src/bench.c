@@ -0,0 +1,418 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   benchmarks the least witness search against generated chains shaped
+ *   like real policies: addresses are CIDR blocks clustered in a few
+ *   sites, destination ports are mostly well-known services (some as
+ *   multiport lists), source ports are mostly left open and protocols
+ *   lean towards tcp, a share of the rules is widened so that they
+ *   overlap many others and a share disagrees with the chain's policy
+ *   each configuration (with or without slicing and each engine, the
+ *   batch search and the decision diagram) verifies the same properties,
+ *   timings are written one JSON object per line so that runs can be
+ *   compared by scripts to catch regressions
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "algorithm.h"
+#include "fdd.h"
+#include "layout.h"
+#include "pool.h"
+#include "reduce.h"
+
+/** action values, numbered as parse.c numbers them */
+#define DROP 0
+#define ACCEPT 1
+
+/** parameters of a benchmark run */
+struct params
+{
+    uint32_t rules;    // rules of the chain, its policy aside
+    uint32_t props;    // properties verified by each configuration
+    double overlap;    // share of the rules widened to overlap many others
+    double disagree;   // share of the rules whose action differs from the policy
+    uint64_t seed;     // seed of the generator, the same seed generates the same chain
+    uint32_t threads;  // workers of the pool, 1 to search on the calling thread only
+};
+
+/** a generated chain, slot 0 is left for the property (see find_witness) */
+struct chain
+{
+    uint32_t *lo, *hi, *va, count;
+    uint32_t *record, *values, values_n;
+};
+
+/** state of the xorshift generator, kept here so that chains do not depend on the C library */
+static uint64_t state;
+
+// next pseudo-random value
+static uint64_t next(void)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// true with probability p
+static bool chance(double p)
+{
+    return (double)(next() >> 11) / (double)(1ull << 53) < p;
+}
+
+// pick one of n values
+#define PICK(values) ((values)[next() % (sizeof(values)/sizeof(*(values)))])
+
+/** networks the addresses of a chain are drawn from */
+static const uint32_t sites[] = {0x0a000000, 0xac100000, 0xc0a80000, 0xc6336400, 0xcb007100};
+
+/** prefix lengths of specific and of widened rules, 0 leaves the address open */
+static const uint32_t prefixes[] = {32, 32, 32, 32, 28, 24, 24, 24, 16, 0};
+static const uint32_t wide_prefixes[] = {8, 12, 16, 16};
+
+/** well-known services destination ports are drawn from */
+static const uint32_t services[] = {22, 25, 53, 80, 110, 123, 143, 443, 465, 587, 993, 995,
+                                    3306, 5432, 6379, 8080, 8443};
+
+// an address block clustered in one of the sites
+static void cidr(uint32_t *lo, uint32_t *hi, bool wide)
+{
+    uint32_t length = (wide) ? PICK(wide_prefixes) : PICK(prefixes);
+    uint32_t address = PICK(sites) | (uint32_t)(next() % 64) << 8 | (uint32_t)(next() % 256);
+    uint32_t mask = (length) ? UINT32_MAX << (32 - length) : 0;
+    *lo = address & mask;
+    *hi = *lo | ~mask;
+}
+
+// the fields of a rule or property, returns the number of services of a port list (0 for a single range)
+static uint32_t generate_fields(uint32_t *lo, uint32_t *hi, uint32_t *list, bool wide)
+{
+    cidr(&lo[SADDR], &hi[SADDR], wide || chance(0.3));
+    cidr(&lo[DADDR], &hi[DADDR], wide);
+
+    /* source ports are mostly open, otherwise ephemeral */
+    lo[SPORT] = 1;
+    hi[SPORT] = 65535;
+    if (!wide && chance(0.1))
+        lo[SPORT] = 1024;
+
+    /* destination ports name services, a few rules open a range or every port */
+    uint32_t listed = 0;
+    lo[DPORT] = hi[DPORT] = PICK(services);
+    if (wide || chance(0.05))
+    {
+        lo[DPORT] = 1;
+        hi[DPORT] = 65535;
+    }
+    else if (chance(0.05))
+    {
+        lo[DPORT] = 1024;
+        hi[DPORT] = 65535;
+    }
+    else if (list != NULL && chance(0.15))
+    {   // a multiport list of services
+        listed = 2 + (uint32_t)(next() % 3);
+        for (uint32_t i=0; i<listed; i++)
+            list[2*i] = list[2*i+1] = PICK(services);
+        listed = ranges_sort(list, listed);
+        lo[DPORT] = list[0];
+        hi[DPORT] = list[2*listed-1];
+        if (listed == 1)
+            listed = 0;
+    }
+
+    /* protocols lean towards tcp */
+    uint32_t roll = (uint32_t)(next() % 100);
+    lo[PROTO] = hi[PROTO] = (roll < 70) ? 6 : (roll < 90) ? 17 : (roll < 95) ? 1 : 0;
+    if (roll >= 95 || wide)
+    {
+        lo[PROTO] = 0;
+        hi[PROTO] = 255;
+    }
+    return listed;
+}
+
+// generate a chain ending with its policy, false if memory could not be allocated
+static bool generate_chain(const struct params *p, struct chain *chain)
+{
+    uint32_t count = p->rules + 1;
+    chain->lo = malloc(sizeof(*chain->lo)*SIZE*count + 1);
+    chain->hi = malloc(sizeof(*chain->hi)*SIZE*count + 1);
+    chain->va = malloc(sizeof(*chain->va)*count + 1);
+    chain->record = calloc(count, sizeof(*chain->record));
+    chain->values = malloc(sizeof(*chain->values)*(SIZE + 2*SIZE + 2*FIELD_RANGES)*count + 1);
+    chain->values_n = 0;
+    chain->count = count;
+    if (chain->lo == NULL || chain->hi == NULL || chain->va == NULL || chain->record == NULL || chain->values == NULL)
+        return false;
+
+    /* every rule but the policy */
+    for (uint32_t r=1; r+1<count; r++)
+    {
+        uint32_t *lo = &chain->lo[r*SIZE], *hi = &chain->hi[r*SIZE], list[2*FIELD_RANGES];
+        uint32_t listed = generate_fields(lo, hi, list, chance(p->overlap));
+        chain->va[r] = (chance(p->disagree)) ? DROP : ACCEPT;
+        if (listed == 0)
+            continue;
+
+        // a record holds the count of ranges of each field then their pairs (see struct ranges)
+        uint32_t *record = &chain->values[chain->values_n];
+        uint32_t *pairs = record + SIZE;
+        for (uint32_t f=0; f<SIZE; f++)
+        {
+            record[f] = (f == DPORT) ? listed : 1;
+            if (f == DPORT)
+                memcpy(pairs, list, sizeof(*list)*2*listed);
+            else
+            {
+                pairs[0] = lo[f];
+                pairs[1] = hi[f];
+            }
+            pairs += 2*record[f];
+        }
+        chain->record[r] = chain->values_n + 1;
+        chain->values_n += (uint32_t)(pairs - record);
+    }
+
+    /* the policy drops every packet no rule accepted */
+    uint32_t any_lo[SIZE] = ANY_LO, any_hi[SIZE] = ANY_HI;
+    memcpy(&chain->lo[(count-1)*SIZE], any_lo, sizeof(any_lo));
+    memcpy(&chain->hi[(count-1)*SIZE], any_hi, sizeof(any_hi));
+    chain->va[count-1] = DROP;
+    return true;
+}
+
+// release a chain
+static void chain_free(struct chain *chain)
+{
+    free(chain->lo);
+    free(chain->hi);
+    free(chain->va);
+    free(chain->record);
+    free(chain->values);
+}
+
+// monotonic time in microseconds
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec*1e6 + (double)ts.tv_nsec/1e3;
+}
+
+static int compare(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile q of n sorted timings
+static double rank(const double *times, uint32_t n, double q)
+{
+    return times[(uint32_t)(q*(n-1) + 0.5)];
+}
+
+// write the percentiles of n timings as a JSON object, the timings are sorted
+static void percentiles(const char *name, double *times, uint32_t n)
+{
+    double sum = 0;
+    for (uint32_t i=0; i<n; i++) sum += times[i];
+    qsort(times, n, sizeof(*times), compare);
+    printf(", \"%s_us\": {\"min\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f, \"mean\": %.1f}",
+           name, times[0], rank(times, n, 0.5), rank(times, n, 0.9), rank(times, n, 0.99), times[n-1], sum/n);
+}
+
+// write the timing of a phase run once
+static void phase(const char *name, double us)
+{
+    printf("{\"bench\": \"phase\", \"name\": \"%s\", \"us\": %.1f}\n", name, us);
+}
+
+static const char *engines[] = {"scan", "index", "bitset", "refine"};
+
+// verify every property one at a time, timing the projection and the search apart
+static void bench_search(const struct chain *chain, const struct ranges *ranges, const uint32_t *prop_lo,
+                         const uint32_t *prop_hi, const uint32_t *prop_va, uint32_t props, const struct options *opt,
+                         double *project, double *search, double *total)
+{
+    uint32_t failed = 0;
+    for (uint32_t p=0; p<props; p++)
+    {
+        memcpy(chain->lo, &prop_lo[p*SIZE], sizeof(*prop_lo)*SIZE);
+        memcpy(chain->hi, &prop_hi[p*SIZE], sizeof(*prop_hi)*SIZE);
+        chain->va[0] = prop_va[p];
+        double start = now();
+        struct layout *layout = layout_build(chain->lo, chain->hi, chain->va, chain->count, ranges);
+        double projected = now();
+        uint32_t witness[SIZE];
+        int found = -1;
+        if (layout != NULL)
+            found = (opt->slicing) ? with_slicing(layout, witness, opt) : without_slicing(layout, witness, opt);
+        double end = now();
+        layout_free(layout);
+        if (found < 0) // a search which ran out of memory is not timed
+        {
+            fprintf(stderr, "bench: out of memory\n");
+            return;
+        }
+        failed += found;
+        project[p] = projected - start;
+        search[p] = end - projected;
+        total[p] = end - start;
+    }
+
+    double sum = 0;
+    for (uint32_t p=0; p<props; p++) sum += total[p];
+    printf("{\"bench\": \"search\", \"mode\": \"%s\", \"engine\": \"%s\", \"props\": %u, \"failed\": %u",
+           (opt->slicing) ? "slicing" : "plain", engines[opt->engine], props, failed);
+    percentiles("project", project, props);
+    percentiles("search", search, props);
+    percentiles("total", total, props);
+    printf(", \"props_per_s\": %.1f}\n", (sum > 0) ? props*1e6/sum : 0.0);
+    fflush(stdout);
+}
+
+// write the result of verifying every property at once
+static void batch(const char *name, uint32_t props, const bool *found, double us, const char *extra)
+{
+    uint32_t failed = 0;
+    for (uint32_t p=0; p<props; p++) failed += found[p];
+    printf("{\"bench\": \"%s\", \"props\": %u, \"failed\": %u, \"us\": %.1f, \"props_per_s\": %.1f%s}\n",
+           name, props, failed, us, (us > 0) ? props*1e6/us : 0.0, extra);
+    fflush(stdout);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: bench [-rules n] [-props n] [-overlap f] [-disagree f] [-seed n] [-threads n]\n"
+                    "\t-rules n\trules of the generated chain (default 1000)\n"
+                    "\t-props n\tproperties verified by each configuration (default 100)\n"
+                    "\t-overlap f\tshare of rules widened to overlap many others (default 0.05)\n"
+                    "\t-disagree f\tshare of rules dropping rather than accepting (default 0.3)\n"
+                    "\t-seed n\t\tseed of the generator (default 1)\n"
+                    "\t-threads n\tworkers searching each property (default 1)\n");
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    struct params p = {1000, 100, 0.05, 0.3, 1, 1};
+    for (int i=1; i<argc; i++)
+    {
+        if (i+1 == argc)
+            usage();
+        const char *option = argv[i], *value = argv[++i];
+        if (strcmp(option, "-rules") == 0) p.rules = (uint32_t) strtoul(value, NULL, 10);
+        else if (strcmp(option, "-props") == 0) p.props = (uint32_t) strtoul(value, NULL, 10);
+        else if (strcmp(option, "-overlap") == 0) p.overlap = strtod(value, NULL);
+        else if (strcmp(option, "-disagree") == 0) p.disagree = strtod(value, NULL);
+        else if (strcmp(option, "-seed") == 0) p.seed = strtoull(value, NULL, 10);
+        else if (strcmp(option, "-threads") == 0) p.threads = (uint32_t) strtoul(value, NULL, 10);
+        else usage();
+    }
+    if (p.rules == 0 || p.props == 0 || p.threads == 0)
+        usage();
+    printf("{\"bench\": \"params\", \"rules\": %u, \"props\": %u, \"overlap\": %g, \"disagree\": %g, "
+           "\"seed\": %llu, \"threads\": %u}\n", p.rules, p.props, p.overlap, p.disagree,
+           (unsigned long long) p.seed, p.threads);
+
+    /* the chain and its properties, which ask that traffic to a service is accepted or dropped */
+    state = p.seed*0x9e3779b97f4a7c15ull + 1;
+    struct chain chain;
+    uint32_t *prop_lo = malloc(sizeof(*prop_lo)*SIZE*p.props), *prop_hi = malloc(sizeof(*prop_hi)*SIZE*p.props);
+    uint32_t *prop_va = malloc(sizeof(*prop_va)*p.props);
+    double *project = malloc(sizeof(*project)*p.props), *search = malloc(sizeof(*search)*p.props);
+    double *total = malloc(sizeof(*total)*p.props);
+    bool *found = malloc(sizeof(*found)*p.props);
+    uint32_t *witnesses = malloc(sizeof(*witnesses)*SIZE*p.props);
+    double start = now();
+    if (!generate_chain(&p, &chain) || prop_lo == NULL || prop_hi == NULL || prop_va == NULL || project == NULL
+        || search == NULL || total == NULL || found == NULL || witnesses == NULL)
+    {
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+    for (uint32_t i=0; i<p.props; i++)
+    {
+        generate_fields(&prop_lo[i*SIZE], &prop_hi[i*SIZE], NULL, false);
+        prop_va[i] = (chance(0.5)) ? ACCEPT : DROP;
+    }
+    phase("generate", now() - start);
+    struct ranges ranges = {chain.record, chain.values};
+    const struct ranges *multi = (chain.values_n) ? &ranges : NULL;
+
+    /* the phases of compiling the chain, as a Firewall compiles it before verifying */
+    start = now();
+    struct layout *rules = layout_build_rules(chain.lo, chain.hi, chain.va, chain.count, multi);
+    phase("layout", now() - start);
+    start = now();
+    struct bounds *bounds = (rules != NULL) ? bounds_build(rules) : NULL;
+    phase("bounds", now() - start);
+    start = now();
+    struct layout *reduced = (bounds != NULL) ? reduce_rules(rules, bounds, NULL) : NULL;
+    phase("reduce", now() - start);
+    start = now();
+    struct bounds *reduced_bounds = (reduced != NULL) ? bounds_build(reduced) : NULL;
+    phase("reduced_bounds", now() - start);
+    start = now();
+    struct fdd *fdd = (reduced != NULL) ? fdd_build(reduced, FDD_LIMIT) : NULL;
+    phase("fdd", now() - start);
+    if (reduced_bounds == NULL)
+    {
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+    // a diagram which does not fit within FDD_LIMIT has no nodes, and is not benchmarked
+    printf("{\"bench\": \"chain\", \"rules\": %u, \"multi\": %s, \"reduced\": %u, \"fdd_nodes\": %u}\n",
+           chain.count-1, (multi != NULL) ? "true" : "false", reduced->count, (fdd != NULL) ? fdd_nodes(fdd) : 0);
+
+    /* each search mode and engine on its own, against the whole chain */
+    struct workspace *workspace = workspace_alloc();
+    struct options opt = {true, ENGINE_SCAN, (p.threads > 1) ? pool_create(p.threads) : NULL, workspace};
+    for (int slicing=1; slicing>=0; slicing--)
+    {
+        opt.slicing = slicing;
+        for (opt.engine=ENGINE_SCAN; opt.engine<=ENGINE_REFINE; opt.engine++)
+            bench_search(&chain, multi, prop_lo, prop_hi, prop_va, p.props, &opt, project, search, total);
+    }
+
+    /* every property at once against the reduced chain, as a Firewall verifies them */
+    opt.slicing = true;
+    opt.engine = ENGINE_SCAN;
+    char extra[64];
+    start = now();
+    if (find_witnesses_in(reduced, reduced_bounds, prop_lo, prop_hi, prop_va, p.props, witnesses, found, &opt) == 0)
+    {
+        snprintf(extra, sizeof(extra), ", \"workspace_bytes\": %zu", workspace_bytes(workspace));
+        batch("batch", p.props, found, now() - start, extra);
+    }
+    start = now();
+    if (fdd != NULL && fdd_witnesses(fdd, prop_lo, prop_hi, prop_va, p.props, witnesses, found) == 0)
+    {
+        snprintf(extra, sizeof(extra), ", \"fdd_bytes\": %zu", fdd_bytes(fdd));
+        batch("fdd", p.props, found, now() - start, extra);
+    }
+
+    pool_free(opt.pool);
+    workspace_free(workspace);
+    fdd_free(fdd);
+    bounds_free(reduced_bounds);
+    layout_free(reduced);
+    bounds_free(bounds);
+    layout_free(rules);
+    chain_free(&chain);
+    free(prop_lo);
+    free(prop_hi);
+    free(prop_va);
+    free(project);
+    free(search);
+    free(total);
+    free(found);
+    free(witnesses);
+    return 0;
+}
@@ -0,0 +1,190 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of the bit-vector (Lucent-style) matcher
+ *   the end-points of a field split it into elementary intervals, every
+ *   interval is given a bit-vector of the rules which cover it, so a
+ *   candidate hits the rule of the lowest bit set in the AND of its vectors
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "bitset.h"
+
+struct bitset
+{
+    uint32_t words;          // number of 64-bit words in each vector
+    uint64_t *vectors[SIZE]; // indices[f] consecutive vectors for each field f
+    uint64_t *disagree;      // rules whose action differs from the property
+};
+
+// build bit-vectors
+struct bitset* bitset_build(const struct layout *layout, const uint32_t *set, const uint32_t *indices)
+{
+    uint32_t count = layout->count, points = layout_points(layout);
+    uint32_t words = (count+63)/64;
+
+    /* refuse to build vectors which would not fit in the memory limit */
+    uint64_t total = 1;
+    for (uint32_t f=0; f<SIZE; f++) total += indices[f];
+    if (total*words*sizeof(uint64_t) > BITSET_MAX_BYTES)
+        return NULL;
+
+    struct bitset *bitset = calloc(1, sizeof(*bitset));
+    if (bitset == NULL)
+        return NULL;
+    bitset->words = words;
+    bitset->disagree = calloc(words + 1, sizeof(uint64_t));
+    if (bitset->disagree == NULL)
+        goto fail;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        bitset->vectors[f] = calloc((size_t)indices[f]*words + 1, sizeof(uint64_t));
+        if (bitset->vectors[f] == NULL)
+            goto fail;
+    }
+
+    for (uint32_t r=0; r<count; r++) // for each rule
+    {
+        uint64_t bit = (uint64_t)1 << (r & 63);
+        if (layout->va[r] != layout->action)
+            bitset->disagree[r >> 6] |= bit;
+        for (uint32_t f=0; f<SIZE; f++) // for each field
+        {   /* mark the end-points which fall inside the rule */
+            for (uint32_t k=0; k<indices[f]; k++)
+            {
+                uint32_t endp = set[f*points+k];
+                if (layout_has(layout, r, f, endp))
+                    bitset->vectors[f][(uint64_t)k*words + (r >> 6)] |= bit;
+            }
+        }
+    }
+    return bitset;
+
+fail:
+    bitset_free(bitset);
+    return NULL;
+}
+
+/* AND the vector of end-point k[l] into the partial AND of the outer fields,
+ * returns false if the result contains no disagreeing rule */
+static bool and_level(const struct bitset *bitset, uint64_t *acc, uint32_t l, const uint32_t *k,
+                      uint32_t *first, uint32_t *last)
+{
+    uint32_t words = bitset->words;
+    const uint64_t *vec = bitset->vectors[l] + (uint64_t)k[l]*words;
+    const uint64_t *in = (l) ? acc + (l-1)*words : NULL;
+    uint64_t *out = acc + l*words;
+    uint32_t a = (l) ? first[l-1] : 0, b = (l) ? last[l-1] : words-1;
+    uint32_t lo_w = words, hi_w = 0;
+    uint64_t disagree = 0;
+    for (uint32_t w=a; w<=b; w++)
+    {
+        uint64_t x = (in) ? in[w] & vec[w] : vec[w];
+        out[w] = x;
+        if (x)
+        {
+            if (lo_w == words) lo_w = w;
+            hi_w = w;
+            disagree |= x & bitset->disagree[w];
+        }
+    }
+    first[l] = lo_w;
+    last[l] = hi_w;
+    return disagree != 0;
+}
+
+// cartesian product using bit-vectors
+int bitset_search(const struct bitset *bitset, uint32_t points,
+                  const uint32_t *set, const uint32_t *indices,
+                  const uint32_t *prefix, uint32_t depth,
+                  bool (*stop)(void *arg), void *arg, uint32_t *witness)
+{
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        if (indices[f] == 0)
+            return 0;
+    }
+
+    uint32_t words = bitset->words;
+    uint64_t *acc = malloc(sizeof(*acc)*words*SIZE); // AND of the vectors of fields 0..l at acc[l*words]
+    uint32_t first[SIZE], last[SIZE];                // range of non-zero words of each partial AND
+    uint32_t k[SIZE];                                // current end-point of each field
+    int found = 0;
+    if (acc == NULL)
+        return -1;
+
+    /* AND the vectors of the fixed leading fields */
+    uint32_t l = 0;
+    for (; l<depth; l++)
+    {
+        k[l] = prefix[l];
+        if (!and_level(bitset, acc, l, k, first, last))
+            goto end;
+    }
+
+    /* depth-first walk over the remaining fields, level l holds the AND of fields 0..l */
+    if (l == SIZE)
+    {   // every field is fixed, test the single candidate
+        l = SIZE-1;
+        goto test;
+    }
+    k[l] = 0;
+    for (;;)
+    {
+        if (k[l] == indices[l])
+        {   // field exhausted, move the outer field on
+            if (l-- == depth)
+                break;
+            k[l]++;
+            continue;
+        }
+
+        // no candidate of this sub-product can hit a disagreeing rule first
+        if (!and_level(bitset, acc, l, k, first, last))
+        {
+            k[l]++;
+            continue;
+        }
+
+        if (l < SIZE-1)
+        {
+            if (stop != NULL && stop(arg))
+                break;
+            k[++l] = 0;
+            continue;
+        }
+
+test:
+        {   // lowest bit is the first rule hit by the candidate
+            uint64_t x = acc[l*words + first[l]];
+            if (bitset->disagree[first[l]] & x & (~x + 1))
+            {
+                for (uint32_t f=0; f<SIZE; f++)
+                    witness[f] = set[f*points + k[f]];
+                found = 1;
+                break;
+            }
+        }
+        if (l < depth)
+            break;
+        k[l]++;
+    }
+
+end:
+    free(acc);
+    return found;
+}
+
+// free bit-vectors
+void bitset_free(struct bitset *bitset)
+{
+    if (bitset == NULL)
+        return;
+    for (uint32_t f=0; f<SIZE; f++)
+        free(bitset->vectors[f]);
+    free(bitset->disagree);
+    free(bitset);
+}
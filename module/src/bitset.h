@@ -0,0 +1,64 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the bit-vector matching component of the project
+ *   for every field and every end-point of that field a bit-vector of
+ *   the rules containing the end-point is precomputed, the first rule
+ *   hit by a candidate is then found by AND-ing one vector per field
+ */
+
+#ifndef IPTABLES_VERIFICATION_BITSET_H
+#define IPTABLES_VERIFICATION_BITSET_H
+
+#include <stdint.h>
+#include "algorithm.h"
+#include "layout.h"
+
+/** upper limit of the memory used by the bit-vectors of one rule set */
+#define BITSET_MAX_BYTES ((uint64_t) 256 << 20)
+
+/** opaque set of bit-vectors, see bitset.c */
+struct bitset;
+
+/**
+ * builds the bit-vectors of each end-point of each field
+ * bit r of a vector is set when the rule at position r of the layout contains the end-point
+ *
+ * @param layout  rules the candidates are tested against
+ * @param set     set (as an array SIZE*layout_points(layout)) of unique possible endpoints
+ * @param indices the number of endpoints for each field (an array of SIZE)
+ * @return the bit-vectors, or NULL if they would exceed BITSET_MAX_BYTES
+ */
+struct bitset* bitset_build(const struct layout *layout, const uint32_t *set, const uint32_t *indices);
+
+/**
+ * tests the cartesian product of the end-points in the same order as
+ * test_candidates, the AND of the outer fields is kept while the inner
+ * fields are varied and sub-products without a disagreeing rule are skipped
+ * only the candidates whose leading fields equal the given prefix are tested
+ *
+ * @param bitset  vectors created by bitset_build
+ * @param points  end-points per field of the set (layout_points of the layout the vectors were built from)
+ * @param set     the set the vectors were built from
+ * @param indices the number of endpoints for each field
+ * @param prefix  end-point positions of the leading fields
+ * @param depth   number of leading fields given in prefix (0 to test every candidate)
+ * @param stop    polled while searching, the search is abandoned once it returns true (may be NULL)
+ * @param arg     argument passed to stop
+ * @param witness array of SIZE elements, filled with the witness if one is found
+ * @return 1 if a witness was found, 0 if not, -1 if memory could not be allocated
+ */
+int bitset_search(const struct bitset *bitset, uint32_t points,
+                  const uint32_t *set, const uint32_t *indices,
+                  const uint32_t *prefix, uint32_t depth,
+                  bool (*stop)(void *arg), void *arg, uint32_t *witness);
+
+/**
+ * releases the memory held by the bit-vectors
+ * @param bitset vectors created by bitset_build (may be NULL)
+ */
+void bitset_free(struct bitset *bitset);
+
+#endif //IPTABLES_VERIFICATION_BITSET_H
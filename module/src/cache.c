@@ -0,0 +1,161 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of the result cache
+ *   results are stored in the order they are added and found through
+ *   a hash table of their positions, which is rebuilt whenever results
+ *   are dropped (a change drops few results and happens rarely compared
+ *   to lookups)
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "cache.h"
+
+/** empty slot of the table */
+#define EMPTY UINT32_MAX
+
+// hash of a property
+static uint32_t hash(const uint32_t *lo, const uint32_t *hi, uint32_t va)
+{
+    uint32_t h = 2166136261u;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        h = (h ^ lo[f]) * 16777619u;
+        h = (h ^ hi[f]) * 16777619u;
+    }
+    h = (h ^ va) * 16777619u;
+    return h ^ (h >> 16);
+}
+
+// true if a result is that of a property
+static bool same(const struct result *result, const uint32_t *lo, const uint32_t *hi, uint32_t va)
+{
+    return result->va == va && memcmp(result->lo, lo, sizeof(result->lo)) == 0
+           && memcmp(result->hi, hi, sizeof(result->hi)) == 0;
+}
+
+// put the position of a result into the table
+static void place(struct cache *cache, uint32_t r)
+{
+    const struct result *result = &cache->results[r];
+    uint32_t at = hash(result->lo, result->hi, result->va) & cache->mask;
+    while (cache->slots[at] != EMPTY) at = (at+1) & cache->mask;
+    cache->slots[at] = r;
+}
+
+// fill the table with the positions of the results held
+static void rehash(struct cache *cache)
+{
+    memset(cache->slots, 0xff, sizeof(*cache->slots)*(cache->mask+1));
+    for (uint32_t r=0; r<cache->n; r++)
+        place(cache, r);
+}
+
+// initialise an empty cache
+void cache_init(struct cache *cache)
+{
+    memset(cache, 0, sizeof(*cache));
+}
+
+// find the result of a property
+bool cache_lookup(const struct cache *cache, const uint32_t *lo, const uint32_t *hi, uint32_t va,
+                  bool *found, uint32_t *witness)
+{
+    if (cache->n == 0)
+        return false;
+    uint32_t at = hash(lo, hi, va) & cache->mask;
+    for (uint32_t r; (r = cache->slots[at]) != EMPTY; at = (at+1) & cache->mask)
+    {
+        const struct result *result = &cache->results[r];
+        if (same(result, lo, hi, va))
+        {
+            *found = result->found;
+            if (result->found)
+                memcpy(witness, result->witness, sizeof(result->witness));
+            return true;
+        }
+    }
+    return false;
+}
+
+// keep the result of a property
+int cache_store(struct cache *cache, const uint32_t *lo, const uint32_t *hi, uint32_t va,
+                bool found, const uint32_t *witness)
+{
+    bool held;
+    uint32_t ignored[SIZE];
+    if (cache_lookup(cache, lo, hi, va, &held, ignored))
+        return 0;
+    if (cache->n == CACHE_LIMIT)
+        cache_clear(cache);
+
+    /* grow the results, and the table so that it stays at most half full */
+    if (cache->n == cache->max)
+    {
+        uint32_t max = (cache->max) ? 2*cache->max : 64;
+        struct result *results = realloc(cache->results, sizeof(*results)*max);
+        uint32_t *slots = malloc(sizeof(*slots)*2*max);
+        if (results == NULL || slots == NULL)
+        {
+            free(slots);
+            if (results != NULL)
+                cache->results = results;
+            cache_free(cache);
+            return -1;
+        }
+        free(cache->slots);
+        cache->results = results;
+        cache->slots = slots;
+        cache->max = max;
+        cache->mask = 2*max - 1;
+        rehash(cache);
+    }
+
+    struct result *result = &cache->results[cache->n];
+    memcpy(result->lo, lo, sizeof(result->lo));
+    memcpy(result->hi, hi, sizeof(result->hi));
+    result->va = va;
+    result->found = found;
+    if (found)
+        memcpy(result->witness, witness, sizeof(result->witness));
+    place(cache, cache->n++);
+    return 0;
+}
+
+// drop the results of the properties whose box meets a rule which changed
+void cache_invalidate(struct cache *cache, const uint32_t *lo, const uint32_t *hi)
+{
+    uint32_t kept = 0;
+    for (uint32_t r=0; r<cache->n; r++)
+    {
+        const struct result *result = &cache->results[r];
+        bool meets = true;
+        for (uint32_t f=0; f<SIZE && meets; f++)
+            meets = result->lo[f] <= hi[f] && lo[f] <= result->hi[f];
+        if (!meets)
+            cache->results[kept++] = *result;
+    }
+    if (kept == cache->n)
+        return;
+    cache->n = kept;
+    rehash(cache);
+}
+
+// drop every result
+void cache_clear(struct cache *cache)
+{
+    cache->n = 0;
+    if (cache->slots != NULL)
+        rehash(cache);
+}
+
+// release the memory held by a cache
+void cache_free(struct cache *cache)
+{
+    free(cache->results);
+    free(cache->slots);
+    cache_init(cache);
+}
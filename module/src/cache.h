@@ -0,0 +1,94 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the result cache component of the project
+ *   the outcome of verifying a property only depends on the rules which
+ *   intersect its box, so results are kept until a rule meeting the box
+ *   is inserted, deleted or replaced and only those properties have to
+ *   be verified again once a firewall changes
+ */
+
+#ifndef IPTABLES_VERIFICATION_CACHE_H
+#define IPTABLES_VERIFICATION_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "algorithm.h"
+
+/** most results a cache holds, every result is dropped once it is full */
+#define CACHE_LIMIT ((uint32_t) 1 << 16)
+
+/** the result of verifying a property */
+struct result
+{
+    uint32_t lo[SIZE];      // lower bounds of the property
+    uint32_t hi[SIZE];      // upper bounds of the property
+    uint32_t va;            // action value of the property
+    bool found;             // true if the property is violated
+    uint32_t witness[SIZE]; // witness of a violated property
+};
+
+/** results of the properties verified against a firewall, looked up by property */
+struct cache
+{
+    struct result *results;
+    uint32_t n, max;
+    uint32_t *slots; // open addressing table of positions in results, UINT32_MAX for empty slots
+    uint32_t mask;   // size of the table less one, the size is a power of two
+};
+
+/**
+ * initialises an empty cache
+ * @param cache cache to initialise
+ */
+void cache_init(struct cache *cache);
+
+/**
+ * finds the result of a property
+ * @param cache   cache to search
+ * @param lo      lower bounds of the property (an array of SIZE)
+ * @param hi      upper bounds of the property (an array of SIZE)
+ * @param va      action value of the property
+ * @param found   set true if the property is violated
+ * @param witness filled with the witness of a violated property (an array of SIZE)
+ * @return true if the result of the property is held
+ */
+bool cache_lookup(const struct cache *cache, const uint32_t *lo, const uint32_t *hi, uint32_t va,
+                  bool *found, uint32_t *witness);
+
+/**
+ * keeps the result of a property, a property held already is not stored again
+ * @param cache   cache to add to
+ * @param lo      lower bounds of the property (an array of SIZE)
+ * @param hi      upper bounds of the property (an array of SIZE)
+ * @param va      action value of the property
+ * @param found   true if the property is violated
+ * @param witness witness of a violated property (an array of SIZE), ignored otherwise
+ * @return 0 on success, -1 if memory could not be allocated (the cache is then left empty)
+ */
+int cache_store(struct cache *cache, const uint32_t *lo, const uint32_t *hi, uint32_t va,
+                bool found, const uint32_t *witness);
+
+/**
+ * drops the results of the properties whose box meets a rule which changed
+ * @param cache cache to update
+ * @param lo    lower bounds of the rule, or of the hull of a multi-valued rule (an array of SIZE)
+ * @param hi    upper bounds of the rule, or of the hull of a multi-valued rule (an array of SIZE)
+ */
+void cache_invalidate(struct cache *cache, const uint32_t *lo, const uint32_t *hi);
+
+/**
+ * drops every result, once the rules of a firewall are replaced as a whole
+ * @param cache cache to empty
+ */
+void cache_clear(struct cache *cache);
+
+/**
+ * releases the memory held by a cache, which is left empty
+ * @param cache cache initialised by cache_init
+ */
+void cache_free(struct cache *cache);
+
+#endif //IPTABLES_VERIFICATION_CACHE_H
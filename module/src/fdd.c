@@ -0,0 +1,472 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of the firewall decision diagram
+ *   a node along a field splits the values of the field into intervals
+ *   within which the same rules are hit, each leading to the node of the
+ *   rules which hold that interval, the first rule of a set decides the
+ *   leaf once it holds every value of the fields left
+ *   the nodes of equal rule sets are remembered and equal nodes are only
+ *   kept once (hash-consing), so a diagram grows with the distinct ways
+ *   the rules meet rather than with the packets they tell apart
+ *   a property is verified by walking the edges which meet its box in
+ *   ascending order, the first leaf whose action differs from that of
+ *   the property gives the least packet which violates it
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "fdd.h"
+
+/** node id returned when the diagram does not fit */
+#define NO_NODE UINT32_MAX
+
+/** a node of the diagram, leaves are marked with a field value of SIZE */
+struct node
+{
+    uint32_t field; // field the node splits
+    uint32_t first; // position of the first edge, or the action of a leaf (NO_RULE if no rule is hit)
+    uint32_t count; // number of edges, 0 for leaves
+    uint32_t hash;  // hash of the field and edges, or of the action
+};
+
+struct fdd
+{
+    struct node *nodes;
+    uint32_t *lo;        // lowest value of each edge, the edge ends where the next one starts
+    uint32_t *to;        // node each edge leads to
+    uint32_t nodes_n, nodes_max;
+    uint32_t edges_n, edges_max;
+    uint32_t root;
+};
+
+/** a rule set whose node has been built */
+struct memo
+{
+    uint32_t field; // field the set was split on
+    uint32_t first; // position of the set in the keys
+    uint32_t len;   // number of rules of the set
+    uint32_t hash;  // hash of the field and rules
+    uint32_t node;  // node built for the set
+};
+
+/** open addressing hash table of ids */
+struct table
+{
+    uint32_t *slots; // NO_NODE for empty slots
+    uint32_t mask;   // size of the table less one, the size is a power of two
+    uint32_t n;      // number of ids held
+};
+
+/** state of a diagram being compiled */
+struct build
+{
+    struct fdd *fdd;
+    const struct layout *rules;
+    uint8_t *full;          // per rule: the first field from which the rule holds every value
+    struct table unique;    // nodes by their field and edges
+    struct table sets;      // memos by their field and rules
+    struct memo *memo;
+    uint32_t memo_n, memo_max;
+    uint32_t *keys;         // rule sets of the memos
+    uint32_t keys_n, keys_max;
+    uint32_t *cut[SIZE];    // per field: lowest value of each interval
+    uint32_t *sub[SIZE+1];  // per field: the rule set split along the field, filled by the field before
+    uint32_t *elo[SIZE];    // per field: edges of the node being built
+    uint32_t *eto[SIZE];
+    size_t bytes;           // memory held by the diagram and its tables
+    size_t limit;           // most memory the diagram may use
+    uint64_t work;          // rule tests left before compiling gives up
+};
+
+// mix a value into a hash
+static uint32_t mix(uint32_t hash, uint32_t value)
+{
+    hash = (hash ^ value) * 0x9E3779B1u;
+    return hash ^ (hash >> 15);
+}
+
+// grow a buffer so that it can hold at least need elements, within the memory limit
+static int reserve(struct build *b, void **buf, uint32_t *max, uint32_t need, size_t elem)
+{
+    if (need <= *max)
+        return 0;
+    uint32_t size = (*max) ? *max : 64;
+    while (size < need) size *= 2;
+    if (b->bytes + elem*(size - *max) > b->limit)
+        return -1;
+    void *tmp = realloc(*buf, elem*size);
+    if (tmp == NULL)
+        return -1;
+    b->bytes += elem*(size - *max);
+    *buf = tmp;
+    *max = size;
+    return 0;
+}
+
+// hash of a node of the diagram
+static uint32_t node_hash(const struct build *b, uint32_t id)
+{
+    return b->fdd->nodes[id].hash;
+}
+
+// hash of a memo
+static uint32_t memo_hash(const struct build *b, uint32_t id)
+{
+    return b->memo[id].hash;
+}
+
+// double a table once it is half full, within the memory limit
+static int table_grow(struct build *b, struct table *table, uint32_t (*hash)(const struct build *, uint32_t))
+{
+    uint32_t size = table->mask + 1;
+    if (table->slots != NULL && 2*(table->n + 1) <= size)
+        return 0;
+    uint32_t grown = (table->slots != NULL) ? 2*size : 1024;
+    size_t added = sizeof(*table->slots)*(grown - ((table->slots != NULL) ? size : 0));
+    if (b->bytes + added > b->limit)
+        return -1;
+    uint32_t *slots = malloc(sizeof(*slots)*grown);
+    if (slots == NULL)
+        return -1;
+    memset(slots, 0xff, sizeof(*slots)*grown);
+    for (uint32_t s=0; table->slots != NULL && s<size; s++)
+    {
+        uint32_t id = table->slots[s];
+        if (id == NO_NODE)
+            continue;
+        uint32_t at = hash(b, id) & (grown-1);
+        while (slots[at] != NO_NODE) at = (at+1) & (grown-1);
+        slots[at] = id;
+    }
+    free(table->slots);
+    b->bytes += added;
+    table->slots = slots;
+    table->mask = grown-1;
+    return 0;
+}
+
+// find the node with the given field and edges (or action), adding it if there is none
+static uint32_t intern(struct build *b, uint32_t field, uint32_t first, const uint32_t *lo, const uint32_t *to,
+                       uint32_t count)
+{
+    struct fdd *fdd = b->fdd;
+    uint32_t hash = mix(mix(0, field), first);
+    for (uint32_t e=0; e<count; e++)
+        hash = mix(mix(hash, lo[e]), to[e]);
+
+    /* look for an equal node */
+    if (table_grow(b, &b->unique, node_hash))
+        return NO_NODE;
+    uint32_t at = hash & b->unique.mask;
+    for (uint32_t id; (id = b->unique.slots[at]) != NO_NODE; at = (at+1) & b->unique.mask)
+    {
+        const struct node *node = &fdd->nodes[id];
+        if (node->hash != hash || node->field != field || node->count != count)
+            continue;
+        if (count == 0 && node->first == first)
+            return id;
+        if (count != 0 && memcmp(&fdd->lo[node->first], lo, sizeof(*lo)*count) == 0
+            && memcmp(&fdd->to[node->first], to, sizeof(*to)*count) == 0)
+            return id;
+    }
+
+    /* add it */
+    if (reserve(b, (void **)&fdd->nodes, &fdd->nodes_max, fdd->nodes_n+1, sizeof(*fdd->nodes)))
+        return NO_NODE;
+    if (count != 0)
+    {
+        uint32_t edges_max = fdd->edges_max;
+        if (reserve(b, (void **)&fdd->lo, &fdd->edges_max, fdd->edges_n+count, sizeof(*fdd->lo)))
+            return NO_NODE;
+        if (reserve(b, (void **)&fdd->to, &edges_max, fdd->edges_n+count, sizeof(*fdd->to)))
+            return NO_NODE;
+        memcpy(&fdd->lo[fdd->edges_n], lo, sizeof(*lo)*count);
+        memcpy(&fdd->to[fdd->edges_n], to, sizeof(*to)*count);
+        first = fdd->edges_n;
+        fdd->edges_n += count;
+    }
+    uint32_t id = fdd->nodes_n++;
+    fdd->nodes[id] = (struct node){field, first, count, hash};
+    b->unique.slots[at] = id;
+    b->unique.n++;
+    return id;
+}
+
+// ascending order of values
+static int compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// ranges of a field of a rule, a box has a single range
+static const uint32_t* field_ranges(const struct layout *rules, uint32_t r, uint32_t f,
+                                    uint32_t *box, uint32_t *n)
+{
+    if (rules->record[r] != 0)
+        return layout_ranges(rules, r, f, n);
+    box[0] = rules->lo[f][r];
+    box[1] = rules->hi[f][r];
+    *n = 1;
+    return box;
+}
+
+static uint32_t remember(struct build *b, uint32_t f, const uint32_t *set, uint32_t len);
+
+/* build the node of a rule set along field f, each rule of the set holds the
+ * values which lead to the node along the fields before f, in priority order */
+static uint32_t build(struct build *b, uint32_t f, const uint32_t *set, uint32_t len)
+{
+    const struct layout *rules = b->rules;
+    if (len == 0)
+        return intern(b, SIZE, NO_RULE, NULL, NULL, 0);
+    if (b->full[set[0]] <= f)
+        return intern(b, SIZE, rules->va[set[0]], NULL, NULL, 0);
+
+    /* the intervals of the field start at 0 and wherever a range of a rule starts or ends */
+    uint32_t *cut = b->cut[f], cuts = 0;
+    cut[cuts++] = 0;
+    for (uint32_t i=0; i<len; i++)
+    {
+        uint32_t box[2], n;
+        const uint32_t *pairs = field_ranges(rules, set[i], f, box, &n);
+        for (uint32_t k=0; k<n; k++)
+        {
+            cut[cuts++] = pairs[2*k];
+            if (pairs[2*k+1] != UINT32_MAX)
+                cut[cuts++] = pairs[2*k+1] + 1;
+        }
+    }
+    qsort(cut, cuts, sizeof(*cut), compare);
+    uint32_t unique = 1;
+    for (uint32_t i=1; i<cuts; i++)
+    {
+        if (cut[i] != cut[unique-1])
+            cut[unique++] = cut[i];
+    }
+    cuts = unique;
+
+    /* an edge for each interval, neighbouring intervals leading to the same node share it */
+    uint32_t *sub = b->sub[f+1], *lo = b->elo[f], *to = b->eto[f], edges = 0;
+    for (uint32_t i=0; i<cuts; i++)
+    {
+        if (b->work < len)
+            return NO_NODE;
+        b->work -= len;
+
+        // rules after one which holds every value of the fields left are never hit
+        uint32_t m = 0;
+        for (uint32_t k=0; k<len; k++)
+        {
+            if (!layout_has(rules, set[k], f, cut[i]))
+                continue;
+            sub[m++] = set[k];
+            if (b->full[set[k]] <= f+1)
+                break;
+        }
+        uint32_t child = remember(b, f+1, sub, m);
+        if (child == NO_NODE)
+            return NO_NODE;
+        if (edges > 0 && to[edges-1] == child)
+            continue;
+        lo[edges] = cut[i];
+        to[edges++] = child;
+    }
+
+    // a node with a single edge would tell nothing apart
+    if (edges == 1)
+        return to[0];
+    return intern(b, f, 0, lo, to, edges);
+}
+
+// build the node of a rule set unless it was built before
+static uint32_t remember(struct build *b, uint32_t f, const uint32_t *set, uint32_t len)
+{
+    if (len == 0 || b->full[set[0]] <= f) // leaves are found without a memo
+        return build(b, f, set, len);
+
+    uint32_t hash = mix(0, f);
+    for (uint32_t i=0; i<len; i++)
+        hash = mix(hash, set[i]);
+    if (table_grow(b, &b->sets, memo_hash))
+        return NO_NODE;
+    uint32_t at = hash & b->sets.mask;
+    for (uint32_t id; (id = b->sets.slots[at]) != NO_NODE; at = (at+1) & b->sets.mask)
+    {
+        const struct memo *memo = &b->memo[id];
+        if (memo->hash == hash && memo->field == f && memo->len == len
+            && memcmp(&b->keys[memo->first], set, sizeof(*set)*len) == 0)
+            return memo->node;
+    }
+
+    uint32_t node = build(b, f, set, len);
+    if (node == NO_NODE)
+        return NO_NODE;
+
+    /* the table may have grown while building, so the slot is found again */
+    if (reserve(b, (void **)&b->memo, &b->memo_max, b->memo_n+1, sizeof(*b->memo))
+        || reserve(b, (void **)&b->keys, &b->keys_max, b->keys_n+len, sizeof(*b->keys))
+        || table_grow(b, &b->sets, memo_hash))
+        return NO_NODE;
+    memcpy(&b->keys[b->keys_n], set, sizeof(*set)*len);
+    b->memo[b->memo_n] = (struct memo){f, b->keys_n, len, hash, node};
+    b->keys_n += len;
+    at = hash & b->sets.mask;
+    while (b->sets.slots[at] != NO_NODE) at = (at+1) & b->sets.mask;
+    b->sets.slots[at] = b->memo_n++;
+    b->sets.n++;
+    return node;
+}
+
+// compile the rules of a firewall into a decision diagram
+struct fdd* fdd_build(const struct layout *rules, size_t limit)
+{
+    uint32_t n = rules->count, points = 2*layout_points(rules) + 1;
+    struct build b = {0};
+    b.rules = rules;
+    b.limit = limit;
+    b.work = limit;
+    b.fdd = calloc(1, sizeof(*b.fdd));
+    b.full = malloc(sizeof(*b.full)*n + 1);
+    b.sub[0] = malloc(sizeof(*b.sub[0])*n + 1);
+    bool ok = b.fdd != NULL && b.full != NULL && b.sub[0] != NULL;
+    for (uint32_t f=0; f<SIZE && ok; f++)
+    {
+        b.cut[f] = malloc(sizeof(*b.cut[f])*points);
+        b.sub[f+1] = malloc(sizeof(*b.sub[f+1])*n + 1);
+        b.elo[f] = malloc(sizeof(*b.elo[f])*points);
+        b.eto[f] = malloc(sizeof(*b.eto[f])*points);
+        ok = b.cut[f] != NULL && b.sub[f+1] != NULL && b.elo[f] != NULL && b.eto[f] != NULL;
+    }
+
+    if (ok)
+    {
+        /* the first field from which each rule holds every value */
+        for (uint32_t r=0; r<n; r++)
+        {
+            uint32_t f = SIZE;
+            bool all = true;
+            while (f > 0 && layout_meets(rules, r, f-1, 0, UINT32_MAX, &all) && all)
+                f--;
+            b.full[r] = (uint8_t)f;
+        }
+
+        /* every rule may be hit by the first packet, until one which holds every packet */
+        uint32_t len = 0;
+        while (len < n && b.full[len++] != 0);
+        for (uint32_t r=0; r<len; r++) b.sub[0][r] = r;
+        b.fdd->root = build(&b, 0, b.sub[0], len);
+        ok = b.fdd->root != NO_NODE;
+    }
+
+    free(b.full);
+    free(b.unique.slots);
+    free(b.sets.slots);
+    free(b.memo);
+    free(b.keys);
+    free(b.sub[0]);
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        free(b.cut[f]);
+        free(b.sub[f+1]);
+        free(b.elo[f]);
+        free(b.eto[f]);
+    }
+    if (!ok)
+    {
+        fdd_free(b.fdd);
+        return NULL;
+    }
+    return b.fdd;
+}
+
+/* walk the edges of a node which meet the box of a property in ascending order,
+ * nodes walked without finding a witness are marked seen as the box is the same
+ * whichever way they are reached */
+static bool walk(const struct fdd *fdd, uint32_t id, const uint32_t *prop_lo, const uint32_t *prop_hi,
+                 uint32_t action, uint32_t *packet, uint32_t *seen, uint32_t epoch)
+{
+    if (seen[id] == epoch)
+        return false;
+    const struct node *node = &fdd->nodes[id];
+    if (node->field == SIZE)
+    {
+        if (node->first != NO_RULE && node->first != action)
+            return true;
+        seen[id] = epoch;
+        return false;
+    }
+
+    /* find the edge holding the lowest value of the property by binary search */
+    uint32_t f = node->field, *lo = &fdd->lo[node->first], *to = &fdd->to[node->first];
+    uint32_t a = 0, z = node->count - 1;
+    while (a < z)
+    {
+        uint32_t mid = (a+z+1)/2;
+        if (lo[mid] <= prop_lo[f]) a = mid;
+        else z = mid-1;
+    }
+    for (uint32_t e=a; e<node->count && lo[e] <= prop_hi[f]; e++)
+    {
+        packet[f] = (lo[e] > prop_lo[f]) ? lo[e] : prop_lo[f];
+
+        // fields skipped on the way to the next node take the lowest value of the property
+        for (uint32_t k=f+1; k<fdd->nodes[to[e]].field; k++) packet[k] = prop_lo[k];
+        if (walk(fdd, to[e], prop_lo, prop_hi, action, packet, seen, epoch))
+            return true;
+    }
+    seen[id] = epoch;
+    return false;
+}
+
+// verify several properties against a decision diagram
+int fdd_witnesses(const struct fdd *fdd, const uint32_t *prop_lo, const uint32_t *prop_hi, const uint32_t *prop_va,
+                  uint32_t props, uint32_t *witnesses, bool *found)
+{
+    uint32_t *seen = calloc(fdd->nodes_n + 1, sizeof(*seen));
+    if (seen == NULL)
+        return -1;
+    uint32_t root = fdd->nodes[fdd->root].field;
+    for (uint32_t p=0; p<props; p++)
+    {
+        const uint32_t *lo = &prop_lo[p*SIZE], *hi = &prop_hi[p*SIZE];
+        uint32_t *packet = &witnesses[p*SIZE];
+        found[p] = false;
+        bool empty = false;
+        for (uint32_t k=0; k<SIZE; k++) empty |= lo[k] > hi[k];
+        if (empty) // a property holding no packet is never violated
+            continue;
+        for (uint32_t k=0; k<root; k++) packet[k] = lo[k];
+        found[p] = walk(fdd, fdd->root, lo, hi, prop_va[p], packet, seen, p+1);
+    }
+    free(seen);
+    return 0;
+}
+
+// number of nodes of a decision diagram
+uint32_t fdd_nodes(const struct fdd *fdd)
+{
+    return fdd->nodes_n;
+}
+
+// memory held by a decision diagram
+size_t fdd_bytes(const struct fdd *fdd)
+{
+    if (fdd == NULL)
+        return 0;
+    return sizeof(*fdd) + sizeof(*fdd->nodes)*fdd->nodes_max + (sizeof(*fdd->lo) + sizeof(*fdd->to))*fdd->edges_max;
+}
+
+// release the memory held by a decision diagram
+void fdd_free(struct fdd *fdd)
+{
+    if (fdd == NULL)
+        return;
+    free(fdd->nodes);
+    free(fdd->lo);
+    free(fdd->to);
+    free(fdd);
+}
@@ -0,0 +1,80 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the firewall decision diagram component of the project
+ *   the rules of a firewall are compiled once into a reduced decision
+ *   diagram over the fields in order, so that each property verified
+ *   afterwards only walks the edges of the diagram within its box
+ *   rather than testing candidate packets against the rule list
+ */
+
+#ifndef IPTABLES_VERIFICATION_FDD_H
+#define IPTABLES_VERIFICATION_FDD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "algorithm.h"
+#include "layout.h"
+
+/** memory a diagram may use unless told otherwise, in bytes */
+#define FDD_LIMIT ((size_t) 64 << 20)
+
+/** opaque decision diagram, see fdd.c */
+struct fdd;
+
+/**
+ * compiles the rules of a firewall into a decision diagram
+ *
+ * equal sub-diagrams are shared and a node whose edges all lead to the
+ * same node is left out, compiling gives up once the diagram and its
+ * tables would use more than limit bytes, or once as many rule ranges
+ * as limit has been tested, so that firewalls whose diagram would grow
+ * too large are found out early and verified by searching instead
+ *
+ * @param rules layout created by layout_build_rules
+ * @param limit most memory the diagram may use, in bytes
+ * @return the diagram, or NULL if it does not fit within limit or memory could not be allocated
+ */
+struct fdd* fdd_build(const struct layout *rules, size_t limit);
+
+/**
+ * verifies several properties against a decision diagram, the witness
+ * of a failing property is the least packet (in the order candidates
+ * are tested) which violates it, as found searching without slicing
+ *
+ * @param fdd       diagram created by fdd_build
+ * @param prop_lo   lower bounds of the properties, FIVE elements per property
+ * @param prop_hi   upper bounds of the properties, FIVE elements per property
+ * @param prop_va   action value of each property
+ * @param props     number of properties
+ * @param witnesses array of FIVE elements per property, filled with the witness of each failing property
+ * @param found     array of one element per property, set true when a witness was found
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int fdd_witnesses(const struct fdd *fdd, const uint32_t *prop_lo, const uint32_t *prop_hi, const uint32_t *prop_va,
+                  uint32_t props, uint32_t *witnesses, bool *found);
+
+/**
+ * number of nodes of a decision diagram, its leaves included
+ * @param fdd diagram created by fdd_build
+ * @return the number of nodes
+ */
+uint32_t fdd_nodes(const struct fdd *fdd);
+
+/**
+ * memory held by a decision diagram once built
+ * @param fdd diagram created by fdd_build (may be NULL)
+ * @return the number of bytes held
+ */
+size_t fdd_bytes(const struct fdd *fdd);
+
+/**
+ * releases the memory held by a decision diagram
+ * @param fdd diagram created by fdd_build (may be NULL)
+ */
+void fdd_free(struct fdd *fdd);
+
+#endif //IPTABLES_VERIFICATION_FDD_H
@@ -0,0 +1,686 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of the chain flattening
+ *   each rule of a chain is intersected with the match the chain was
+ *   entered with, what is left is emitted, handed to the called chain or
+ *   followed by the rules the packets return to, a chain is left as soon
+ *   as one of its rules covers the whole match, the rules emitted are kept
+ *   in one list so the expansion of a chain which never returns early can
+ *   be copied when it is entered again with the same match
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "flatten.h"
+
+/** most ranges a field of an intersection may hold, enough for two port lists */
+#define FLATTEN_RANGES (2*FIELD_RANGES)
+
+/** deepest nesting of expansions, rules which would nest deeper are skipped */
+#define FLATTEN_MAX_DEPTH ((uint32_t) 128)
+
+/** rules a table may expand into for each rule it holds, a rule of the base chain which goes past it is skipped */
+#define FLATTEN_GROWTH ((size_t) 64)
+
+/** target of a skipped line */
+#define TARGET_SKIPPED ((uint32_t) 4)
+
+/** a rule or skipped line of a chain */
+struct entry
+{
+    uint32_t lo[SIZE], hi[SIZE];
+    size_t record;   // position of its ranges in values plus one, 0 if single-valued
+    size_t reason;   // position of the reason of a skipped line in text
+    uint32_t target; // enum target, or TARGET_SKIPPED
+    uint32_t value;  // action value or chain
+    uint32_t line;   // line of the rule
+    bool reported;   // true once it was reported skipped
+};
+
+/** a chain and its rules */
+struct chain
+{
+    char *name;
+    size_t len;
+    bool user;             // user-defined, may be jumped to
+    bool dependent;        // its expansion depends on where it returns to
+    uint32_t *rules;       // entries of its rules, in order
+    size_t count, max;     // used and allocated size of the rules
+};
+
+/** packets entering a chain, the ranges of each field in ascending order and disjoint */
+struct match
+{
+    uint32_t count[SIZE];
+    uint32_t pairs[SIZE][2*FLATTEN_RANGES];
+};
+
+/** where returning packets go: the rules of a chain from start on, then where that chain returns to */
+struct frame
+{
+    uint32_t chain, start, hops;
+    const struct frame *parent; // NULL for the policy of the base chain
+};
+
+/** a rule of the flattened list */
+struct flat
+{
+    uint32_t lo[SIZE], hi[SIZE];
+    size_t record; // position of its ranges in out_values plus one, 0 if single-valued
+    uint32_t va;
+};
+
+/** an expansion of a chain which never returns early, by the match it was entered with */
+struct memo
+{
+    uint64_t hash;
+    uint32_t chain;
+    size_t key, key_n;  // encoded match in keys
+    size_t start, end;  // rules emitted in out
+    int decided;        // result of the expansion
+};
+
+struct flatten
+{
+    struct chain *chains;
+    size_t chains_n, chains_max;
+    struct entry *entries;
+    size_t entries_n, entries_max;
+    uint32_t *values;            // ranges of the multi-valued entries (see struct ranges)
+    size_t values_n, values_max;
+    char *text;                  // reasons of the skipped lines
+    size_t text_n, text_max;
+
+    /* state of an expansion */
+    struct flat *out;            // rules emitted so far
+    size_t out_n, out_max, out_limit;
+    uint32_t *out_values;        // ranges of the multi-valued rules emitted
+    size_t out_values_n, out_values_max;
+    struct memo *memos;
+    size_t memos_n, memos_max;
+    uint32_t *keys;              // encoded matches of the memos
+    size_t keys_n, keys_max;
+    size_t *slots;               // memos by hash (position plus one), a power of two of them
+    size_t slots_n;
+    parse_skip skip;
+    void *arg;
+    uint32_t policy;
+    uint32_t depth;              // expansions open
+    bool overflow;               // the expansion went past out_limit
+};
+
+// make room for need elements of size bytes, the array or NULL if memory could not be allocated
+static void* grow(void *array, size_t *max, size_t need, size_t size)
+{
+    if (need <= *max && array != NULL)
+        return array;
+    size_t n = (*max) ? *max : 16;
+    while (n < need) n *= 2;
+    void *tmp = realloc(array, size*n);
+    if (tmp != NULL)
+        *max = n;
+    return tmp;
+}
+
+// allocate a table
+struct flatten* flatten_alloc(void)
+{
+    return calloc(1, sizeof(struct flatten));
+}
+
+// find a chain
+uint32_t flatten_find(const struct flatten *flatten, const char *name, size_t len, bool *user)
+{
+    for (size_t c=0; flatten != NULL && c<flatten->chains_n; c++)
+    {
+        const struct chain *chain = &flatten->chains[c];
+        if (chain->len == len && memcmp(chain->name, name, len) == 0)
+        {
+            if (user != NULL)
+                *user = chain->user;
+            return (uint32_t) c;
+        }
+    }
+    return NO_CHAIN;
+}
+
+// find or add a chain
+uint32_t flatten_chain(struct flatten *flatten, const char *name, size_t len, bool user)
+{
+    uint32_t found = flatten_find(flatten, name, len, NULL);
+    if (found != NO_CHAIN)
+        return found;
+    struct chain *chains = grow(flatten->chains, &flatten->chains_max, flatten->chains_n + 1, sizeof(*chains));
+    if (chains == NULL)
+        return NO_CHAIN;
+    flatten->chains = chains;
+    struct chain *chain = &chains[flatten->chains_n];
+    memset(chain, 0, sizeof(*chain));
+    chain->name = malloc(len + 1);
+    if (chain->name == NULL)
+        return NO_CHAIN;
+    memcpy(chain->name, name, len);
+    chain->name[len] = '\0';
+    chain->len = len;
+    chain->user = user;
+    return (uint32_t) flatten->chains_n++;
+}
+
+// append an entry to a chain, NULL if memory could not be allocated
+static struct entry* add_entry(struct flatten *flatten, uint32_t c, uint32_t line)
+{
+    struct chain *chain = &flatten->chains[c];
+    struct entry *entries = grow(flatten->entries, &flatten->entries_max, flatten->entries_n + 1, sizeof(*entries));
+    if (entries == NULL)
+        return NULL;
+    flatten->entries = entries;
+    uint32_t *rules = grow(chain->rules, &chain->max, chain->count + 1, sizeof(*rules));
+    if (rules == NULL)
+        return NULL;
+    chain->rules = rules;
+    rules[chain->count++] = (uint32_t) flatten->entries_n;
+    struct entry *entry = &entries[flatten->entries_n++];
+    memset(entry, 0, sizeof(*entry));
+    entry->line = line;
+    return entry;
+}
+
+// append a rule
+bool flatten_rule(struct flatten *flatten, uint32_t chain, uint32_t line, const uint32_t *lo, const uint32_t *hi,
+                  const uint32_t *record, enum target target, uint32_t value)
+{
+    size_t n = 0;
+    if (record != NULL)
+    {
+        n = SIZE;
+        for (uint32_t f=0; f<SIZE; f++)
+            n += 2*record[f];
+        uint32_t *values = grow(flatten->values, &flatten->values_max, flatten->values_n + n, sizeof(*values));
+        if (values == NULL)
+            return false;
+        flatten->values = values;
+    }
+    struct entry *entry = add_entry(flatten, chain, line);
+    if (entry == NULL)
+        return false;
+    memcpy(entry->lo, lo, sizeof(entry->lo));
+    memcpy(entry->hi, hi, sizeof(entry->hi));
+    entry->target = target;
+    entry->value = value;
+    if (record != NULL)
+    {
+        memcpy(flatten->values + flatten->values_n, record, sizeof(*record)*n);
+        entry->record = flatten->values_n + 1;
+        flatten->values_n += n;
+    }
+    return true;
+}
+
+// append a skipped line
+bool flatten_skip(struct flatten *flatten, uint32_t chain, uint32_t line, const char *reason)
+{
+    size_t len = strlen(reason) + 1;
+    char *text = grow(flatten->text, &flatten->text_max, flatten->text_n + len, 1);
+    if (text == NULL)
+        return false;
+    flatten->text = text;
+    struct entry *entry = add_entry(flatten, chain, line);
+    if (entry == NULL)
+        return false;
+    memcpy(text + flatten->text_n, reason, len);
+    entry->target = TARGET_SKIPPED;
+    entry->reason = flatten->text_n;
+    flatten->text_n += len;
+    return true;
+}
+
+// report an entry skipped the first time a packet reaches it, false if the callback abandoned the expansion
+static bool report(struct flatten *flatten, struct entry *entry, const char *reason)
+{
+    if (entry->reported || flatten->skip == NULL)
+        return true;
+    entry->reported = true;
+    return flatten->skip(flatten->arg, entry->line, reason);
+}
+
+// the match of an entry
+static void match_entry(const struct flatten *flatten, const struct entry *entry, struct match *match)
+{
+    if (entry->record == 0)
+    {
+        for (uint32_t f=0; f<SIZE; f++)
+        {
+            match->count[f] = 1;
+            match->pairs[f][0] = entry->lo[f];
+            match->pairs[f][1] = entry->hi[f];
+        }
+        return;
+    }
+    const uint32_t *record = flatten->values + entry->record - 1, *pairs = record + SIZE;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        match->count[f] = record[f];
+        memcpy(match->pairs[f], pairs, sizeof(*pairs)*2*record[f]);
+        pairs += 2*record[f];
+    }
+}
+
+/* intersect two matches, 1 if they meet, 0 if they do not,
+ * -1 if a field of the intersection holds too many ranges */
+static int match_meet(const struct match *a, const struct match *b, struct match *out)
+{
+    int met = 1;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        const uint32_t *x = a->pairs[f], *y = b->pairs[f];
+        uint32_t i = 0, j = 0, n = 0;
+        while (i < a->count[f] && j < b->count[f] && n < FLATTEN_RANGES)
+        {
+            uint32_t lo = (x[2*i] > y[2*j]) ? x[2*i] : y[2*j];
+            uint32_t hi = (x[2*i+1] < y[2*j+1]) ? x[2*i+1] : y[2*j+1];
+            if (lo <= hi)
+            {
+                out->pairs[f][2*n] = lo;
+                out->pairs[f][2*n+1] = hi;
+                n++;
+            }
+            if (x[2*i+1] < y[2*j+1]) i++;
+            else j++;
+        }
+        if (n == 0)
+            return 0;
+        if (n == FLATTEN_RANGES && i < a->count[f] && j < b->count[f])
+            met = -1;
+        out->count[f] = n;
+    }
+    return met;
+}
+
+// true if two matches hold the same packets
+static bool match_equal(const struct match *a, const struct match *b)
+{
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        if (a->count[f] != b->count[f] || memcmp(a->pairs[f], b->pairs[f], sizeof(a->pairs[f][0])*2*a->count[f]) != 0)
+            return false;
+    }
+    return true;
+}
+
+// write a match as the counts of its fields followed by their ranges, returns its length
+static size_t match_encode(const struct match *match, uint32_t *key)
+{
+    size_t n = SIZE;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        key[f] = match->count[f];
+        memcpy(key + n, match->pairs[f], sizeof(*key)*2*match->count[f]);
+        n += 2*match->count[f];
+    }
+    return n;
+}
+
+/* emit the packets of a match with an action, a field holding more ranges
+ * than a rule may hold is split over several rules, false on overflow or
+ * if memory could not be allocated */
+static bool emit(struct flatten *flatten, const struct match *match, uint32_t va)
+{
+    uint32_t chunk[SIZE] = {0}; // which FIELD_RANGES ranges of each field the next rule holds
+    for (;;)
+    {
+        if (flatten->out_n >= flatten->out_limit)
+        {
+            flatten->overflow = true;
+            return false;
+        }
+        struct flat *out = grow(flatten->out, &flatten->out_max, flatten->out_n + 1, sizeof(*out));
+        uint32_t *values = grow(flatten->out_values, &flatten->out_values_max,
+                                flatten->out_values_n + SIZE + 2*SIZE*FIELD_RANGES, sizeof(*values));
+        if (out != NULL)
+            flatten->out = out;
+        if (values != NULL)
+            flatten->out_values = values;
+        if (out == NULL || values == NULL)
+            return false;
+
+        /* the hull of each field, with its ranges kept aside if any field holds several */
+        struct flat *rule = &out[flatten->out_n++];
+        uint32_t *record = values + flatten->out_values_n, *pairs = record + SIZE;
+        bool multi = false;
+        for (uint32_t f=0; f<SIZE; f++)
+        {
+            uint32_t first = chunk[f]*FIELD_RANGES, n = match->count[f] - first;
+            if (n > FIELD_RANGES)
+                n = FIELD_RANGES;
+            rule->lo[f] = match->pairs[f][2*first];
+            rule->hi[f] = match->pairs[f][2*(first+n)-1];
+            record[f] = n;
+            memcpy(pairs, &match->pairs[f][2*first], sizeof(*pairs)*2*n);
+            pairs += 2*n;
+            multi |= n > 1;
+        }
+        rule->va = va;
+        rule->record = 0;
+        if (multi)
+        {
+            rule->record = flatten->out_values_n + 1;
+            flatten->out_values_n = (size_t)(pairs - values);
+        }
+
+        /* move on to the next combination of chunks */
+        uint32_t f = 0;
+        while (f < SIZE && (++chunk[f])*FIELD_RANGES >= match->count[f])
+            chunk[f++] = 0;
+        if (f == SIZE)
+            return true;
+    }
+}
+
+// forget every memo, after the rules they point to were dropped
+static void memo_clear(struct flatten *flatten)
+{
+    flatten->memos_n = 0;
+    flatten->keys_n = 0;
+    if (flatten->slots != NULL)
+        memset(flatten->slots, 0, sizeof(*flatten->slots)*flatten->slots_n);
+}
+
+// find the memo of a chain entered with an encoded match, NULL if there is none
+static const struct memo* memo_find(const struct flatten *flatten, uint32_t chain, const uint32_t *key, size_t n,
+                                    uint64_t hash)
+{
+    if (flatten->slots_n == 0)
+        return NULL;
+    size_t mask = flatten->slots_n - 1;
+    for (size_t s = hash & mask; flatten->slots[s] != 0; s = (s+1) & mask)
+    {
+        const struct memo *memo = &flatten->memos[flatten->slots[s] - 1];
+        if (memo->hash == hash && memo->chain == chain && memo->key_n == n &&
+            memcmp(flatten->keys + memo->key, key, sizeof(*key)*n) == 0)
+            return memo;
+    }
+    return NULL;
+}
+
+// remember an expansion, false if memory could not be allocated
+static bool memo_add(struct flatten *flatten, uint32_t chain, const uint32_t *key, size_t n, uint64_t hash,
+                     size_t start, int decided)
+{
+    struct memo *memos = grow(flatten->memos, &flatten->memos_max, flatten->memos_n + 1, sizeof(*memos));
+    if (memos == NULL)
+        return false;
+    flatten->memos = memos;
+    uint32_t *keys = grow(flatten->keys, &flatten->keys_max, flatten->keys_n + n, sizeof(*keys));
+    if (keys == NULL)
+        return false;
+    flatten->keys = keys;
+
+    /* keep the table at most half full */
+    if (2*(flatten->memos_n + 1) > flatten->slots_n)
+    {
+        size_t slots_n = (flatten->slots_n) ? 2*flatten->slots_n : 64;
+        size_t *slots = calloc(slots_n, sizeof(*slots));
+        if (slots == NULL)
+            return false;
+        for (size_t m=0; m<flatten->memos_n; m++)
+        {
+            size_t s = memos[m].hash & (slots_n-1);
+            while (slots[s] != 0) s = (s+1) & (slots_n-1);
+            slots[s] = m + 1;
+        }
+        free(flatten->slots);
+        flatten->slots = slots;
+        flatten->slots_n = slots_n;
+    }
+
+    memcpy(keys + flatten->keys_n, key, sizeof(*key)*n);
+    memos[flatten->memos_n] = (struct memo){hash, chain, flatten->keys_n, n, start, flatten->out_n, decided};
+    flatten->keys_n += n;
+    size_t s = hash & (flatten->slots_n-1);
+    while (flatten->slots[s] != 0) s = (s+1) & (flatten->slots_n-1);
+    flatten->slots[s] = ++flatten->memos_n;
+    return true;
+}
+
+static int call(struct flatten *flatten, uint32_t chain, const struct match *match, const struct frame *ret,
+                uint32_t hops);
+
+/* emit rules start to end of a chain for the packets of a match, ret is where they go on return,
+ * 1 if a rule decided every packet of the match, 0 if some may fall through,
+ * -1 on overflow, if memory could not be allocated or a callback abandoned the expansion */
+static int expand(struct flatten *flatten, uint32_t c, size_t start, size_t end, const struct match *match,
+                  const struct frame *ret, uint32_t hops);
+
+// continue with the rules the packets of a match return to, and at last the policy
+static int resume(struct flatten *flatten, const struct match *match, const struct frame *ret)
+{
+    for (; ret != NULL; ret = ret->parent)
+    {
+        int decided = expand(flatten, ret->chain, ret->start, flatten->chains[ret->chain].count, match,
+                             ret->parent, ret->hops);
+        if (decided != 0)
+            return decided;
+    }
+    if (flatten->policy == PARSE_NO_POLICY)
+        return 0;
+    return emit(flatten, match, flatten->policy) ? 1 : -1;
+}
+
+// expand rules of a chain
+static int expand(struct flatten *flatten, uint32_t c, size_t start, size_t end, const struct match *match,
+                  const struct frame *ret, uint32_t hops)
+{
+    struct match rule, met;
+    char reason[128];
+    int decided = 0;
+    flatten->depth++;
+    for (size_t i=start; i<end && decided == 0; i++)
+    {
+        struct entry *entry = &flatten->entries[flatten->chains[c].rules[i]];
+        if (entry->target == TARGET_SKIPPED)
+        {
+            if (!report(flatten, entry, flatten->text + entry->reason))
+                decided = -1;
+            continue;
+        }
+
+        /* only the packets of the match which the rule holds reach its target */
+        match_entry(flatten, entry, &rule);
+        int meets = match_meet(match, &rule, &met);
+        if (meets == 0)
+            continue;
+        if (meets < 0)
+        {
+            if (!report(flatten, entry, "port lists too long once nested"))
+                decided = -1;
+            continue;
+        }
+        bool covers = match_equal(&met, match);
+        bool jump = entry->target == TARGET_CALL || entry->target == TARGET_GOTO;
+
+        // a path through more chains than the table holds passes one of them twice
+        int d;
+        if (jump && hops + 1 >= flatten->chains_n)
+        {
+            snprintf(reason, sizeof(reason), "loop through chain '%.64s'", flatten->chains[entry->value].name);
+            d = report(flatten, entry, reason) ? 0 : -1;
+        }
+        else if (entry->target != TARGET_ACTION && flatten->depth >= FLATTEN_MAX_DEPTH)
+            d = report(flatten, entry, "chains nest too deeply") ? 0 : -1;
+        else if (entry->target == TARGET_ACTION)
+            d = emit(flatten, &met, entry->value) ? 1 : -1;
+        else if (entry->target == TARGET_RETURN)
+            d = resume(flatten, &met, ret);
+        else if (entry->target == TARGET_CALL)
+        {   /* returning packets continue after this rule */
+            struct frame frame = {c, (uint32_t) i+1, hops, ret};
+            d = call(flatten, entry->value, &met, &frame, hops+1);
+        }
+        else
+        {   /* returning packets continue where this chain returns to, as do those falling off the end */
+            d = call(flatten, entry->value, &met, ret, hops+1);
+            if (d == 0)
+                d = resume(flatten, &met, ret);
+        }
+
+        if (d < 0)
+            decided = -1;
+        else if (d == 1 && covers)
+            decided = 1;
+    }
+    flatten->depth--;
+    return decided;
+}
+
+// expand a called chain, or copy its expansion if it was entered with the same match before
+static int call(struct flatten *flatten, uint32_t chain, const struct match *match, const struct frame *ret,
+                uint32_t hops)
+{
+    const struct chain *callee = &flatten->chains[chain];
+    if (callee->dependent)
+        return expand(flatten, chain, 0, callee->count, match, ret, hops);
+
+    uint32_t key[SIZE + 2*SIZE*FLATTEN_RANGES];
+    size_t n = match_encode(match, key);
+    uint64_t hash = 1469598103934665603ULL ^ chain;
+    for (size_t k=0; k<n; k++)
+        hash = (hash ^ key[k]) * 1099511628211ULL;
+
+    const struct memo *memo = memo_find(flatten, chain, key, n, hash);
+    if (memo != NULL)
+    {
+        size_t len = memo->end - memo->start;
+        if (flatten->out_n + len > flatten->out_limit)
+        {
+            flatten->overflow = true;
+            return -1;
+        }
+        struct flat *out = grow(flatten->out, &flatten->out_max, flatten->out_n + len, sizeof(*out));
+        if (out == NULL)
+            return -1;
+        flatten->out = out;
+        memcpy(out + flatten->out_n, out + memo->start, sizeof(*out)*len);
+        flatten->out_n += len;
+        return memo->decided;
+    }
+
+    size_t start = flatten->out_n;
+    int decided = expand(flatten, chain, 0, callee->count, match, ret, hops);
+    if (decided >= 0 && !memo_add(flatten, chain, key, n, hash, start, decided))
+        return -1;
+    return decided;
+}
+
+// mark the chains whose expansion depends on where they return to
+static void mark_dependent(struct flatten *flatten)
+{
+    for (size_t c=0; c<flatten->chains_n; c++)
+    {
+        struct chain *chain = &flatten->chains[c];
+        chain->dependent = false;
+        for (size_t i=0; i<chain->count && !chain->dependent; i++)
+        {
+            uint32_t target = flatten->entries[chain->rules[i]].target;
+            chain->dependent = target == TARGET_RETURN || target == TARGET_GOTO;
+        }
+    }
+
+    /* as does the expansion of a chain which calls such a chain */
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t c=0; c<flatten->chains_n; c++)
+        {
+            struct chain *chain = &flatten->chains[c];
+            for (size_t i=0; i<chain->count && !chain->dependent; i++)
+            {
+                const struct entry *entry = &flatten->entries[chain->rules[i]];
+                if (entry->target == TARGET_CALL && flatten->chains[entry->value].dependent)
+                    changed = chain->dependent = true;
+            }
+        }
+    }
+}
+
+// expand a base chain
+bool flatten_run(struct flatten *flatten, uint32_t chain, uint32_t policy,
+                 parse_rule rule, parse_skip skip, void *arg, uint32_t *rules)
+{
+    flatten->skip = skip;
+    flatten->arg = arg;
+    flatten->policy = policy;
+    flatten->depth = 0;
+    flatten->overflow = false;
+    flatten->out_n = 0;
+    flatten->out_values_n = 0;
+    flatten->out_limit = FLATTEN_GROWTH*(flatten->entries_n + 1);
+    memo_clear(flatten);
+    mark_dependent(flatten);
+
+    /* each rule of the base chain is reached by the packets no earlier rule decided */
+    static const uint32_t any_lo[SIZE] = ANY_LO, any_hi[SIZE] = ANY_HI;
+    struct match any;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        any.count[f] = 1;
+        any.pairs[f][0] = any_lo[f];
+        any.pairs[f][1] = any_hi[f];
+    }
+    const struct chain *base = &flatten->chains[chain];
+    for (size_t i=0; i<base->count; i++)
+    {
+        size_t out_n = flatten->out_n, out_values_n = flatten->out_values_n;
+        int decided = expand(flatten, chain, i, i+1, &any, NULL, 0);
+        if (decided < 0 && flatten->overflow)
+        {   /* leave the rule out rather than the chain */
+            flatten->out_n = out_n;
+            flatten->out_values_n = out_values_n;
+            flatten->overflow = false;
+            memo_clear(flatten);
+            if (!report(flatten, &flatten->entries[base->rules[i]], "expands into too many rules"))
+                return false;
+            continue;
+        }
+        if (decided < 0)
+            return false;
+        if (decided == 1) // no packet reaches the rules after it
+            break;
+    }
+
+    for (size_t i=0; i<flatten->out_n; i++)
+    {
+        const struct flat *flat = &flatten->out[i];
+        const uint32_t *record = (flat->record) ? flatten->out_values + flat->record - 1 : NULL;
+        if (!rule(arg, flat->lo, flat->hi, record, flat->va))
+            return false;
+        (*rules)++;
+    }
+    return true;
+}
+
+// release a table
+void flatten_free(struct flatten *flatten)
+{
+    if (flatten == NULL)
+        return;
+    for (size_t c=0; c<flatten->chains_n; c++)
+    {
+        free(flatten->chains[c].name);
+        free(flatten->chains[c].rules);
+    }
+    free(flatten->chains);
+    free(flatten->entries);
+    free(flatten->values);
+    free(flatten->text);
+    free(flatten->out);
+    free(flatten->out_values);
+    free(flatten->memos);
+    free(flatten->keys);
+    free(flatten->slots);
+    free(flatten);
+}
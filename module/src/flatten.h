@@ -0,0 +1,117 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the chain flattening component of the project
+ *   the rules of every chain of a table are kept until the table ends,
+ *   then the rules of a base chain are expanded into one ordered list:
+ *   a jump to a user-defined chain is replaced by the rules of that chain
+ *   projected onto the match of the jumping rule, a RETURN (or the end of
+ *   a chain entered with goto) by the rules which follow the call, and
+ *   rules which no packet reaching them can match are left out
+ */
+
+#ifndef IPTABLES_VERIFICATION_FLATTEN_H
+#define IPTABLES_VERIFICATION_FLATTEN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "algorithm.h"
+#include "parse.h"
+
+/** chain value returned when a chain is not known */
+#define NO_CHAIN UINT32_MAX
+
+/** what a rule does with the packets it matches */
+enum target
+{
+    TARGET_ACTION, // decides them with an action value
+    TARGET_RETURN, // hands them back to the calling chain (the policy in a base chain)
+    TARGET_CALL,   // hands them to a user-defined chain, returning after the rule (-j)
+    TARGET_GOTO    // hands them to a user-defined chain, returning where this chain returns (-g)
+};
+
+/** chains of one table */
+struct flatten;
+
+/**
+ * allocates an empty table
+ * @return the table, or NULL if memory could not be allocated
+ */
+struct flatten* flatten_alloc(void);
+
+/**
+ * finds a chain of the table, adding it if it is not there yet
+ * @param flatten table created by flatten_alloc
+ * @param name    name of the chain (not NUL terminated)
+ * @param len     length of the name
+ * @param user    true if the chain is user-defined (may be a target), false for a base chain
+ * @return the chain, or NO_CHAIN if memory could not be allocated
+ */
+uint32_t flatten_chain(struct flatten *flatten, const char *name, size_t len, bool user);
+
+/**
+ * finds a chain of the table
+ * @param flatten table created by flatten_alloc
+ * @param name    name of the chain (not NUL terminated)
+ * @param len     length of the name
+ * @param user    set to true if the chain is user-defined (may be NULL)
+ * @return the chain, or NO_CHAIN if the table has no such chain
+ */
+uint32_t flatten_find(const struct flatten *flatten, const char *name, size_t len, bool *user);
+
+/**
+ * appends a rule to a chain
+ * @param flatten table created by flatten_alloc
+ * @param chain   chain returned by flatten_chain
+ * @param line    line of the rule
+ * @param lo      lower bounds of the rule
+ * @param hi      upper bounds of the rule
+ * @param record  ranges of the rule when a field holds a port list (see struct ranges), otherwise NULL
+ * @param target  what the rule does with its packets
+ * @param value   action value of TARGET_ACTION, the user-defined chain of TARGET_CALL and TARGET_GOTO
+ * @return false if memory could not be allocated
+ */
+bool flatten_rule(struct flatten *flatten, uint32_t chain, uint32_t line, const uint32_t *lo, const uint32_t *hi,
+                  const uint32_t *record, enum target target, uint32_t value);
+
+/**
+ * appends a skipped line to a chain, it is reported if a packet can reach it
+ * @param flatten table created by flatten_alloc
+ * @param chain   chain returned by flatten_chain
+ * @param line    line skipped
+ * @param reason  why it was skipped
+ * @return false if memory could not be allocated
+ */
+bool flatten_skip(struct flatten *flatten, uint32_t chain, uint32_t line, const char *reason);
+
+/**
+ * expands a base chain into one ordered list of rules, handed to a callback
+ *
+ * a call is expanded into the rules of the called chain intersected with
+ * the match of the calling rule, so a jump costs as many rules as the
+ * called chain has rules which meet it, expansions of chains which never
+ * return early are memoized by the match they are entered with, and the
+ * rules after one which decides every packet reaching it are left out,
+ * lines skipped and rules which nest too deeply or loop are reported
+ *
+ * @param flatten table created by flatten_alloc
+ * @param chain   base chain to expand
+ * @param policy  action value of the policy of the chain, PARSE_NO_POLICY if it has none
+ * @param rule    called for each rule of the list
+ * @param skip    called for each line reached which was skipped (may be NULL)
+ * @param arg     argument passed to the callbacks
+ * @param rules   incremented for each rule passed to the rule callback
+ * @return false if memory could not be allocated or a callback abandoned the expansion
+ */
+bool flatten_run(struct flatten *flatten, uint32_t chain, uint32_t policy,
+                 parse_rule rule, parse_skip skip, void *arg, uint32_t *rules);
+
+/**
+ * releases a table
+ * @param flatten table created by flatten_alloc (may be NULL)
+ */
+void flatten_free(struct flatten *flatten);
+
+#endif //IPTABLES_VERIFICATION_FLATTEN_H
@@ -0,0 +1,272 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of a HiCuts-style decision tree
+ *   the box of the property is recursively cut into equal sized pieces
+ *   along one field at a time until the number of rules which intersect
+ *   a piece is small, lookups then only scan the rules of a single leaf
+ *   pieces are cut against the hull of multi-valued rules, their ranges
+ *   are only consulted when deciding whether a rule covers a piece and
+ *   when a lookup hits the rule
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "index.h"
+
+/** a node of the tree, leaves are marked with a field value of SIZE */
+struct node
+{
+    uint32_t base;  // lower bound of the node along the field it is cut on
+    uint32_t first; // position of the first child node, or of the first rule for leaves
+    uint32_t size;  // number of children, or number of rules for leaves
+    uint8_t field;  // field the node is cut on
+    uint8_t shift;  // log2 of the width of each cut
+};
+
+struct index
+{
+    struct node *nodes;  // children of a node are stored consecutively
+    uint32_t *rules;     // rule lists of the leaves, in ascending order
+    uint32_t nodes_n, nodes_max;
+    uint32_t rules_n, rules_max;
+    uint32_t budget;     // once nodes_n + rules_n reaches budget no more cuts are made
+};
+
+// grow a buffer so that it can hold at least need elements
+static int reserve(void **buf, uint32_t *max, uint32_t need, size_t elem)
+{
+    if (need <= *max)
+        return 0;
+    uint32_t size = (*max) ? *max : 64;
+    while (size < need) size *= 2;
+    void *tmp = realloc(*buf, elem*size);
+    if (tmp == NULL)
+        return -1;
+    *buf = tmp;
+    *max = size;
+    return 0;
+}
+
+// smallest shift such that (1 << shift) >= value
+static uint32_t log2_ceil(uint64_t value)
+{
+    uint32_t shift = 0;
+    while (((uint64_t)1 << shift) < value) shift++;
+    return shift;
+}
+
+// determines which children of a cut the rule r spans
+static void span(const struct layout *layout, uint32_t r, uint32_t f,
+                 const uint32_t *blo, const uint32_t *bhi, uint32_t shift,
+                 uint32_t *first, uint32_t *last)
+{
+    uint32_t l = (layout->lo[f][r] > blo[f]) ? layout->lo[f][r] : blo[f];
+    uint32_t h = (layout->hi[f][r] < bhi[f]) ? layout->hi[f][r] : bhi[f];
+    *first = (uint32_t)((uint64_t)(l - blo[f]) >> shift);
+    *last = (uint32_t)((uint64_t)(h - blo[f]) >> shift);
+}
+
+/* choose the field and the cut width which leave the fewest rules in the
+ * fullest child, the number of cuts of a field is doubled for as long as
+ * the rules replicated into the children stay within the space factor */
+static uint32_t choose_cut(const struct layout *layout, const uint32_t *list, uint32_t len,
+                           const uint32_t *blo, const uint32_t *bhi, uint32_t *shift_out)
+{
+    uint32_t field = SIZE, best = len;
+    uint32_t counts[INDEX_CUTS+1];
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        uint64_t width = (uint64_t)bhi[f] - blo[f] + 1;
+        if (width < 2)
+            continue;
+
+        /* find the largest number of cuts within the space factor */
+        uint32_t shift = log2_ceil((width+1)/2);
+        for (uint32_t cuts=4; cuts<=INDEX_CUTS && shift > 0; cuts*=2)
+        {
+            uint32_t next = log2_ceil((width+cuts-1)/cuts);
+            uint64_t sum = 0;
+            for (uint32_t i=0; i<len; i++)
+            {
+                uint32_t a, b;
+                span(layout, list[i], f, blo, bhi, next, &a, &b);
+                sum += b - a + 1;
+            }
+            if (sum > (uint64_t)INDEX_SPFAC*len)
+                break;
+            shift = next;
+        }
+
+        /* count the rules of the fullest child */
+        uint32_t children = (uint32_t)(((width-1) >> shift) + 1);
+        memset(counts, 0, sizeof(counts));
+        for (uint32_t i=0; i<len; i++)
+        {
+            uint32_t a, b;
+            span(layout, list[i], f, blo, bhi, shift, &a, &b);
+            counts[a]++;
+            counts[b+1]--;
+        }
+        uint32_t worst = 0, running = 0;
+        for (uint32_t c=0; c<children; c++)
+        {
+            running += counts[c];
+            if (running > worst) worst = running;
+        }
+        if (worst < best)
+        {
+            best = worst;
+            field = f;
+            *shift_out = shift;
+        }
+    }
+    return field;
+}
+
+// recursively build the node at position 'at' which covers the box blo..bhi
+static int build(struct index *index, uint32_t at, const struct layout *layout,
+                 uint32_t *list, uint32_t len, uint32_t *blo, uint32_t *bhi, uint32_t depth)
+{
+    /* rules after one which covers the whole box can never be hit first */
+    for (uint32_t i=0; i<len; i++)
+    {
+        uint32_t r = list[i];
+        bool covers = true;
+        for (uint32_t j=0; j<SIZE && covers; j++)
+        {
+            if (!layout_meets(layout, r, j, blo[j], bhi[j], &covers))
+                covers = false;
+        }
+        if (covers)
+        {
+            len = i+1;
+            break;
+        }
+    }
+
+    uint32_t field = SIZE, shift = 0;
+    if (len > INDEX_BINTH && depth < INDEX_DEPTH && index->nodes_n + index->rules_n < index->budget)
+        field = choose_cut(layout, list, len, blo, bhi, &shift);
+
+    if (field == SIZE)
+    {   /* make a leaf holding the remaining rules */
+        if (reserve((void **)&index->rules, &index->rules_max, index->rules_n+len, sizeof(*index->rules)))
+            return -1;
+        if (len)
+            memcpy(&index->rules[index->rules_n], list, sizeof(*list)*len);
+        index->nodes[at] = (struct node){0, index->rules_n, len, SIZE, 0};
+        index->rules_n += len;
+        return 0;
+    }
+
+    /* make an inner node and allocate its children */
+    uint64_t width = (uint64_t)bhi[field] - blo[field] + 1;
+    uint32_t children = (uint32_t)(((width-1) >> shift) + 1);
+    if (reserve((void **)&index->nodes, &index->nodes_max, index->nodes_n+children, sizeof(*index->nodes)))
+        return -1;
+    uint32_t first = index->nodes_n;
+    index->nodes_n += children;
+    index->nodes[at] = (struct node){blo[field], first, children, (uint8_t)field, (uint8_t)shift};
+
+    uint32_t *sub = malloc(sizeof(*sub)*len);
+    if (sub == NULL)
+        return -1;
+    uint32_t olo = blo[field], ohi = bhi[field];
+    int err = 0;
+    for (uint32_t c=0; c<children && !err; c++)
+    {
+        /* box of the child along the cut field */
+        uint64_t clo = (uint64_t)olo + ((uint64_t)c << shift);
+        uint64_t chi = clo + ((uint64_t)1 << shift) - 1;
+        blo[field] = (uint32_t)clo;
+        bhi[field] = (chi < ohi) ? (uint32_t)chi : ohi;
+
+        /* keep the rules that intersect the child */
+        uint32_t n = 0;
+        for (uint32_t i=0; i<len; i++)
+        {
+            bool covers;
+            if (layout_meets(layout, list[i], field, blo[field], bhi[field], &covers))
+                sub[n++] = list[i];
+        }
+        err = build(index, first+c, layout, sub, n, blo, bhi, depth+1);
+    }
+    blo[field] = olo;
+    bhi[field] = ohi;
+    free(sub);
+    return err;
+}
+
+// build decision tree
+struct index* index_build(const struct layout *layout)
+{
+    struct index *index = calloc(1, sizeof(*index));
+    uint32_t *list = malloc(sizeof(*list)*(layout->count+1));
+    if (index == NULL || list == NULL)
+        goto fail;
+
+    /* root box is the property, every rule of the layout lies within it */
+    uint32_t blo[SIZE], bhi[SIZE];
+    for (uint32_t k=0; k<SIZE; k++)
+    {
+        blo[k] = layout->prop_lo[k];
+        bhi[k] = layout->prop_hi[k];
+    }
+    for (uint32_t r=0; r<layout->count; r++) list[r] = r;
+
+    index->budget = INDEX_BUDGET*layout->count + INDEX_CUTS;
+    if (reserve((void **)&index->nodes, &index->nodes_max, 1, sizeof(*index->nodes)))
+        goto fail;
+    index->nodes_n = 1;
+    if (build(index, 0, layout, list, layout->count, blo, bhi, 0))
+        goto fail;
+
+    free(list);
+    return index;
+
+fail:
+    free(list);
+    index_free(index);
+    return NULL;
+}
+
+// find first rule hit
+uint32_t index_lookup(const struct index *index, const struct layout *layout, const uint32_t *packet)
+{
+    /* descend to the leaf which holds the packet */
+    const struct node *node = index->nodes;
+    while (node->field < SIZE)
+    {
+        uint64_t c = (uint64_t)(packet[node->field] - node->base) >> node->shift;
+        if (c >= node->size) // packet lies outside of the property
+            return NO_RULE;
+        node = &index->nodes[node->first + c];
+    }
+
+    /* scan the rules of the leaf */
+    for (uint32_t i=0; i<node->size; i++)
+    {
+        uint32_t r = index->rules[node->first+i], f;
+        for (f=0; f<SIZE; f++)
+        {
+            if (packet[f] > layout->hi[f][r] || packet[f] < layout->lo[f][r])
+                break;
+        }
+        if (f == SIZE && layout_holds(layout, r, packet))
+            return r;
+    }
+    return NO_RULE;
+}
+
+// free decision tree
+void index_free(struct index *index)
+{
+    if (index == NULL)
+        return;
+    free(index->nodes);
+    free(index->rules);
+    free(index);
+}
@@ -0,0 +1,52 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the classification index component of the project
+ *   exposes a HiCuts-style decision tree which answers "first rule
+ *   hit by a packet" without scanning every rule of the firewall
+ */
+
+#ifndef IPTABLES_VERIFICATION_INDEX_H
+#define IPTABLES_VERIFICATION_INDEX_H
+
+#include <stdint.h>
+#include "algorithm.h"
+#include "layout.h"
+
+/** tuning parameters of the decision tree */
+#define INDEX_BINTH  ((uint32_t) 8)  // leaves holding this many rules (or fewer) are not cut further
+#define INDEX_SPFAC  ((uint32_t) 4)  // a cut may replicate rules into at most SPFAC*n child slots
+#define INDEX_CUTS   ((uint32_t) 64) // maximum number of children of a single node
+#define INDEX_DEPTH  ((uint32_t) 24) // maximum depth of the tree
+#define INDEX_BUDGET ((uint32_t) 16) // nodes & leaf entries allowed per rule before cutting stops
+
+/** opaque decision tree, see index.c */
+struct index;
+
+/**
+ * builds a decision tree over the rules of a layout
+ * the tree covers the box of the property the rules were projected over
+ *
+ * @param layout rules to index
+ * @return the tree, or NULL if memory could not be allocated
+ */
+struct index* index_build(const struct layout *layout);
+
+/**
+ * finds the first rule hit by a packet
+ * @param index  tree created by index_build
+ * @param layout the rules the tree was built over
+ * @param packet array of SIZE field values within the property
+ * @return position of the first rule hit, or NO_RULE if no rule is hit
+ */
+uint32_t index_lookup(const struct index *index, const struct layout *layout, const uint32_t *packet);
+
+/**
+ * releases the memory held by a tree
+ * @param index tree created by index_build (may be NULL)
+ */
+void index_free(struct index *index);
+
+#endif //IPTABLES_VERIFICATION_INDEX_H
@@ -0,0 +1,644 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of the column-wise rule layout and its range check kernels
+ *   the AVX2 kernel tests a packet against LAYOUT_LANES rules per compare
+ *   and picks the first hit out of the lane mask, other CPUs use plain C
+ *   sorted per-field bounds let a batch of properties each visit only the
+ *   rules which intersect them along their most selective field
+ *   multi-valued rules are range checked by their hull, a hit on one of
+ *   them is confirmed against its ranges before it is returned
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "layout.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LAYOUT_AVX2
+#include <immintrin.h>
+#endif
+
+// scalar range check
+static uint32_t first_scalar(const struct layout *layout, const uint32_t *packet)
+{
+    for (uint32_t r=0; r<layout->count; r++) // compare packet to each rule
+    {
+        uint32_t f;
+        for (f=0; f<SIZE; f++)
+        {   // search for fields which miss
+            if (packet[f] < layout->lo[f][r] || packet[f] > layout->hi[f][r])
+                break;
+        }
+        if (f == SIZE && layout_holds(layout, r, packet))
+            return r;
+    }
+    return NO_RULE;
+}
+
+#ifdef LAYOUT_AVX2
+// vector range check, LAYOUT_LANES rules at a time
+__attribute__((target("avx2")))
+static uint32_t first_avx2(const struct layout *layout, const uint32_t *packet)
+{
+    __m256i p[SIZE];
+    for (uint32_t f=0; f<SIZE; f++)
+        p[f] = _mm256_set1_epi32((int)packet[f]);
+
+    for (uint32_t b=0; b<layout->count; b+=LAYOUT_LANES)
+    {
+        /* unsigned lo <= p <= hi is tested as max(p,lo) == p && min(p,hi) == p */
+        __m256i hit = _mm256_set1_epi32(-1);
+        for (uint32_t f=0; f<SIZE; f++)
+        {
+            __m256i lo = _mm256_load_si256((const __m256i *)&layout->lo[f][b]);
+            __m256i hi = _mm256_load_si256((const __m256i *)&layout->hi[f][b]);
+            hit = _mm256_and_si256(hit, _mm256_cmpeq_epi32(_mm256_max_epu32(p[f], lo), p[f]));
+            hit = _mm256_and_si256(hit, _mm256_cmpeq_epi32(_mm256_min_epu32(p[f], hi), p[f]));
+        }
+
+        // one bit per lane, lanes past the last rule are ignored
+        uint32_t bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(hit));
+        if (layout->count - b < LAYOUT_LANES)
+            bits &= (1u << (layout->count - b)) - 1;
+        for (; bits; bits &= bits-1)
+        {   // the hull of a multi-valued rule may hold the packet while its ranges do not
+            uint32_t r = b + (uint32_t)__builtin_ctz(bits);
+            if (layout_holds(layout, r, packet))
+                return r;
+        }
+    }
+    return NO_RULE;
+}
+#endif
+
+// pick the kernel supported by the running CPU
+static layout_kernel pick_kernel(void)
+{
+#ifdef LAYOUT_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        return first_avx2;
+#endif
+    return first_scalar;
+}
+
+/** packed columns hold a multiple of this many rules, so a column of any width starts 32-byte aligned */
+#define PACKED_ROUND ((uint32_t) 32)
+
+/* each field of a packed rule is range checked in its own width, the
+ * checks of the fields are expanded from FIELDS */
+#define PACKED_SCALAR(name, bits, min, max) \
+    if (packet[name] < packed->lo_##name[r] || packet[name] > packed->hi_##name[r]) \
+        continue;
+
+// scalar range check of packed columns
+static uint32_t packed_scalar(const struct packed *packed, const struct layout *layout, const uint32_t *packet)
+{
+    for (uint32_t r=0; r<packed->count; r++)
+    {
+        FIELDS(PACKED_SCALAR)
+        if (layout_holds(layout, r, packet))
+            return r;
+    }
+    return NO_RULE;
+}
+
+#ifdef LAYOUT_AVX2
+/* LAYOUT_LANES bounds of a column widened to 32 bits, by the width of the column */
+#define PACKED_LOAD_32(column, b) _mm256_load_si256((const __m256i *)&(column)[b])
+#define PACKED_LOAD_16(column, b) _mm256_cvtepu16_epi32(_mm_load_si128((const __m128i *)&(column)[b]))
+#define PACKED_LOAD_8(column, b) _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&(column)[b]))
+
+#define PACKED_VECTOR(name, bits, min, max) \
+    { \
+        __m256i lo = PACKED_LOAD_##bits(packed->lo_##name, b); \
+        __m256i hi = PACKED_LOAD_##bits(packed->hi_##name, b); \
+        hit = _mm256_and_si256(hit, _mm256_cmpeq_epi32(_mm256_max_epu32(p[name], lo), p[name])); \
+        hit = _mm256_and_si256(hit, _mm256_cmpeq_epi32(_mm256_min_epu32(p[name], hi), p[name])); \
+    }
+
+// vector range check of packed columns, LAYOUT_LANES rules at a time
+__attribute__((target("avx2")))
+static uint32_t packed_avx2(const struct packed *packed, const struct layout *layout, const uint32_t *packet)
+{
+    __m256i p[SIZE];
+    for (uint32_t f=0; f<SIZE; f++)
+        p[f] = _mm256_set1_epi32((int)packet[f]);
+
+    for (uint32_t b=0; b<packed->count; b+=LAYOUT_LANES)
+    {
+        /* unsigned lo <= p <= hi, as in first_avx2 */
+        __m256i hit = _mm256_set1_epi32(-1);
+        FIELDS(PACKED_VECTOR)
+
+        uint32_t bits = (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(hit));
+        if (packed->count - b < LAYOUT_LANES)
+            bits &= (1u << (packed->count - b)) - 1;
+        for (; bits; bits &= bits-1)
+        {
+            uint32_t r = b + (uint32_t)__builtin_ctz(bits);
+            if (layout_holds(layout, r, packet))
+                return r;
+        }
+    }
+    return NO_RULE;
+}
+#endif
+
+#define PACKED_BYTES(name, bits, min, max) + 2*(bits)/8
+#define PACKED_WRAP(name, bits, min, max) \
+    packed->lo_##name = (void *) column; \
+    column += (size_t)(bits)/8*packed->capacity; \
+    packed->hi_##name = (void *) column; \
+    column += (size_t)(bits)/8*packed->capacity;
+
+// allocate packed columns
+struct packed* packed_alloc(uint32_t capacity)
+{
+    struct packed *packed = calloc(1, sizeof(*packed));
+    if (packed == NULL)
+        return NULL;
+    packed->capacity = (capacity + PACKED_ROUND-1) / PACKED_ROUND * PACKED_ROUND;
+    if (packed->capacity == 0)
+        packed->capacity = PACKED_ROUND;
+    packed->block = aligned_alloc(32, (size_t)packed->capacity*(0 FIELDS(PACKED_BYTES)));
+    if (packed->block == NULL)
+    {
+        free(packed);
+        return NULL;
+    }
+    unsigned char *column = packed->block;
+    FIELDS(PACKED_WRAP)
+    packed->first = packed_scalar;
+#ifdef LAYOUT_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        packed->first = packed_avx2;
+#endif
+    return packed;
+}
+
+#define PACKED_FILL(name, bits, min, max) \
+    for (uint32_t r=0; r<layout->count; r++) \
+    { \
+        if ((uint64_t)layout->hi[name][r] >> (bits) != 0) \
+            return false; \
+        packed->lo_##name[r] = (uint##bits##_t) layout->lo[name][r]; \
+        packed->hi_##name[r] = (uint##bits##_t) layout->hi[name][r]; \
+    }
+
+// pack the bounds of a layout
+bool packed_fill(struct packed *packed, const struct layout *layout)
+{
+    packed->count = 0;
+    FIELDS(PACKED_FILL)
+    packed->count = layout->count;
+    return true;
+}
+
+// free packed columns
+void packed_free(struct packed *packed)
+{
+    if (packed == NULL)
+        return;
+    free(packed->block);
+    free(packed);
+}
+
+// allocate empty layout
+struct layout* layout_alloc(uint32_t capacity, uint32_t values)
+{
+    struct layout *layout = calloc(1, sizeof(*layout));
+    if (layout == NULL)
+        return NULL;
+    layout->values = malloc(sizeof(*layout->values)*values + 1);
+    layout->values_max = values;
+    if (layout->values == NULL)
+    {
+        free(layout);
+        return NULL;
+    }
+
+    /* one aligned block holds every column, rounded up to whole vectors */
+    layout->capacity = (capacity + LAYOUT_LANES-1) / LAYOUT_LANES * LAYOUT_LANES;
+    if (layout->capacity == 0)
+        layout->capacity = LAYOUT_LANES;
+    size_t column = sizeof(uint32_t)*layout->capacity;
+    uint32_t *block = aligned_alloc(32, column*LAYOUT_COLUMNS);
+    if (block == NULL)
+    {
+        free(layout->values);
+        free(layout);
+        return NULL;
+    }
+    layout_wrap(layout, block, layout->capacity);
+    return layout;
+}
+
+// set the columns of a layout
+void layout_wrap(struct layout *layout, uint32_t *block, uint32_t capacity)
+{
+    layout->capacity = capacity;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        layout->lo[f] = block + (2*f)*capacity;
+        layout->hi[f] = block + (2*f+1)*capacity;
+    }
+    layout->va = block + (2*SIZE)*capacity;
+    layout->id = block + (2*SIZE+1)*capacity;
+    layout->record = block + (2*SIZE+2)*capacity;
+    layout->first = pick_kernel();
+}
+
+// size of the record of a multi-valued rule
+static uint32_t record_size(const uint32_t *record)
+{
+    uint32_t size = SIZE;
+    for (uint32_t f=0; f<SIZE; f++) size += 2*record[f];
+    return size;
+}
+
+// size of the records of the multi-valued rules of a firewall
+static uint32_t records_size(const struct ranges *ranges, uint32_t count)
+{
+    uint32_t size = 0;
+    for (uint32_t i=1; i<count && ranges != NULL; i++)
+    {
+        if (ranges->record[i] != 0)
+            size += record_size(&ranges->values[ranges->record[i]-1]);
+    }
+    return size;
+}
+
+/* clip the ranges of a record to a box, writing the clipped record and its hull
+ * at position n of out, rules left with a single range per field are written as
+ * plain boxes, false if a field of the record misses the box */
+static bool clip_record(const uint32_t *record, const uint32_t *lo, const uint32_t *hi,
+                        struct layout *out, uint32_t n)
+{
+    uint32_t *dst = &out->values[out->values_n], size = SIZE, ranges = 0;
+    const uint32_t *pair = record + SIZE;
+    for (uint32_t k=0; k<SIZE; k++) // for each field in rule
+    {
+        uint32_t first = size;
+        for (uint32_t i=0; i<record[k]; i++, pair+=2)
+        {
+            if (pair[1] < lo[k] || pair[0] > hi[k])
+                continue;
+            dst[size++] = (pair[0] < lo[k]) ? lo[k] : pair[0]; // set lo to max
+            dst[size++] = (pair[1] < hi[k]) ? pair[1] : hi[k]; // set hi to min
+        }
+        if (size == first) // no range of the field meets the box
+            return false;
+        dst[k] = (size - first)/2;
+        ranges += dst[k];
+        out->lo[k][n] = dst[first];
+        out->hi[k][n] = dst[size-1];
+    }
+
+    out->record[n] = 0;
+    if (ranges > SIZE)
+    {
+        out->record[n] = out->values_n + 1;
+        out->values_n += size;
+        out->extra += ranges - SIZE;
+    }
+    return true;
+}
+
+// clip the ranges of a multi-valued rule to a box
+bool layout_clip_ranges(const struct layout *rules, uint32_t r, const uint32_t *lo, const uint32_t *hi,
+                        struct layout *out, uint32_t n)
+{
+    return clip_record(&rules->values[rules->record[r]-1], lo, hi, out, n);
+}
+
+// project rules over the property
+struct layout* layout_build(const uint32_t *lo, const uint32_t *hi, const uint32_t *va, uint32_t count,
+                            const struct ranges *ranges)
+{
+    struct layout *layout = layout_alloc(count, records_size(ranges, count));
+    if (layout == NULL)
+        return NULL;
+
+    /* copy property */
+    for (uint32_t k=0; k<SIZE; k++)
+    {
+        layout->prop_lo[k] = lo[k];
+        layout->prop_hi[k] = hi[k];
+    }
+    layout->action = va[0];
+
+    /* project over rule, dropping the rules which miss the property */
+    uint32_t n = 0;
+    for (uint32_t i=1; i<count; i++) // for each rule
+    {
+        uint32_t p = i * SIZE, k; // offset of rule start
+        if (ranges != NULL && ranges->record[i] != 0)
+        {   // multi-valued rule
+            k = (clip_record(&ranges->values[ranges->record[i]-1], lo, hi, layout, n)) ? SIZE : 0;
+        }
+        else
+        {
+            for (k=0; k<SIZE; k++)    // for each field in rule
+            {
+                uint32_t z = p + k;   // current position
+                if (hi[z] < lo[k] || lo[z] > hi[k])
+                    break;
+                layout->hi[k][n] = (hi[z] < hi[k]) ? hi[z] : hi[k]; // set hi to min
+                layout->lo[k][n] = (lo[z] < lo[k]) ? lo[k] : lo[z]; // set lo to max
+            }
+            layout->record[n] = 0;
+        }
+        if (k == SIZE)
+        {
+            layout->va[n] = va[i];
+            layout->id[n] = i;
+            n++;
+        }
+    }
+    layout->count = n;
+    return layout;
+}
+
+// copy rules without projecting them
+struct layout* layout_build_rules(const uint32_t *lo, const uint32_t *hi, const uint32_t *va, uint32_t count,
+                                  const struct ranges *ranges)
+{
+    struct layout *layout = layout_alloc(count, records_size(ranges, count));
+    if (layout == NULL)
+        return NULL;
+
+    /* the property of the copy covers every packet */
+    for (uint32_t k=0; k<SIZE; k++)
+    {
+        layout->prop_lo[k] = 0;
+        layout->prop_hi[k] = UINT32_MAX;
+    }
+    layout->action = 0;
+
+    /* transpose the rules into columns, skipping the property slot */
+    uint32_t n = (count) ? count-1 : 0;
+    for (uint32_t i=0; i<n; i++)
+    {
+        if (ranges != NULL && ranges->record[i+1] != 0)
+        {   // clipping to the whole space copies the record and finds its hull
+            clip_record(&ranges->values[ranges->record[i+1]-1], layout->prop_lo, layout->prop_hi, layout, i);
+        }
+        else
+        {
+            for (uint32_t k=0; k<SIZE; k++)
+            {
+                layout->lo[k][i] = lo[(i+1)*SIZE + k];
+                layout->hi[k][i] = hi[(i+1)*SIZE + k];
+            }
+            layout->record[i] = 0;
+        }
+        layout->va[i] = va[i+1];
+        layout->id[i] = i+1;
+    }
+    layout->count = n;
+    return layout;
+}
+
+// stable sort of packed bounds on their upper 32 bits, one byte per pass
+static void sort_keys(uint64_t *keys, uint64_t *tmp, uint32_t n)
+{
+    uint64_t *src = keys, *dst = tmp;
+    for (uint32_t shift=32; shift<64; shift+=8)
+    {
+        uint32_t counts[256] = {0};
+        for (uint32_t i=0; i<n; i++) counts[(src[i] >> shift) & 0xff]++;
+        for (uint32_t d=0, sum=0; d<256; d++)
+        {
+            uint32_t c = counts[d];
+            counts[d] = sum;
+            sum += c;
+        }
+        for (uint32_t i=0; i<n; i++) dst[counts[(src[i] >> shift) & 0xff]++] = src[i];
+        uint64_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+}
+
+// sort the bounds of each field
+struct bounds* bounds_build(const struct layout *rules)
+{
+    struct bounds *bounds = calloc(1, sizeof(*bounds));
+    if (bounds == NULL)
+        return NULL;
+    uint32_t n = rules->count, blocks = (n+BOUNDS_BLOCK-1)/BOUNDS_BLOCK;
+    uint64_t *tmp = malloc(sizeof(*tmp)*n + 1); // scratch space used when sorting
+    bounds->count = n;
+    for (uint32_t k=0; k<SIZE; k++)
+    {
+        bounds->lo[k] = malloc(sizeof(*bounds->lo[k])*n + 1);
+        bounds->hi[k] = malloc(sizeof(*bounds->hi[k])*n + 1);
+        bounds->reach[k] = malloc(sizeof(*bounds->reach[k])*blocks + 1);
+        bounds->ends[k] = malloc(sizeof(*bounds->ends[k])*n + 1);
+        if (tmp == NULL || bounds->lo[k] == NULL || bounds->hi[k] == NULL
+            || bounds->reach[k] == NULL || bounds->ends[k] == NULL)
+        {
+            free(tmp);
+            bounds_free(bounds);
+            return NULL;
+        }
+
+        /* rule positions are appended in ascending order, so they stay in order between equal bounds */
+        for (uint32_t r=0; r<n; r++)
+        {
+            bounds->lo[k][r] = (uint64_t)rules->lo[k][r] << 32 | r;
+            bounds->ends[k][r] = (uint64_t)rules->hi[k][r] << 32 | r;
+        }
+        sort_keys(bounds->lo[k], tmp, n);
+        sort_keys(bounds->ends[k], tmp, n);
+
+        /* upper bounds in the order of the lower bounds, and the reach of each block */
+        for (uint32_t i=0; i<n; i++)
+        {
+            uint32_t h = rules->hi[k][(uint32_t)bounds->lo[k][i]];
+            bounds->hi[k][i] = h;
+            if (i % BOUNDS_BLOCK == 0 || h > bounds->reach[k][i/BOUNDS_BLOCK])
+                bounds->reach[k][i/BOUNDS_BLOCK] = h;
+        }
+    }
+    free(tmp);
+    return bounds;
+}
+
+// memory held by sorted bounds
+size_t bounds_bytes(const struct bounds *bounds)
+{
+    if (bounds == NULL)
+        return 0;
+    size_t n = bounds->count, blocks = (n+BOUNDS_BLOCK-1)/BOUNDS_BLOCK;
+    return sizeof(*bounds) + SIZE*(n*(sizeof(*bounds->lo[0]) + sizeof(*bounds->hi[0]) + sizeof(*bounds->ends[0]))
+                                   + blocks*sizeof(*bounds->reach[0]));
+}
+
+// free sorted bounds
+void bounds_free(struct bounds *bounds)
+{
+    if (bounds == NULL)
+        return;
+    for (uint32_t k=0; k<SIZE; k++)
+    {
+        free(bounds->lo[k]);
+        free(bounds->hi[k]);
+        free(bounds->reach[k]);
+        free(bounds->ends[k]);
+    }
+    free(bounds);
+}
+
+// number of lower bounds <= value
+static uint32_t count_lo(const uint64_t *keys, uint32_t n, uint32_t value)
+{
+    uint32_t a = 0, b = n;
+    while (a < b)
+    {
+        uint32_t m = a + (b-a)/2;
+        if ((uint32_t)(keys[m] >> 32) <= value) a = m+1;
+        else b = m;
+    }
+    return a;
+}
+
+// number of upper bounds < value
+static uint32_t count_hi(const uint64_t *ends, uint32_t n, uint32_t value)
+{
+    uint32_t a = 0, b = n;
+    while (a < b)
+    {
+        uint32_t m = a + (b-a)/2;
+        if ((uint32_t)(ends[m] >> 32) < value) a = m+1;
+        else b = m;
+    }
+    return a;
+}
+
+/* the rules which intersect a box along field k are those with lo <= box hi less
+ * those with hi < box lo (which all have lo <= box hi), picks the field with the
+ * fewest and returns their number, lo_n is set to the number with lo <= box hi */
+static uint32_t select_field(const struct bounds *bounds, const uint32_t *lo, const uint32_t *hi,
+                             uint32_t *field, uint32_t *lo_n)
+{
+    uint32_t field_n = bounds->count;
+    *field = SIZE;
+    *lo_n = 0;
+    for (uint32_t k=0; k<SIZE; k++)
+    {
+        uint32_t a = count_lo(bounds->lo[k], bounds->count, hi[k]);
+        uint32_t b = count_hi(bounds->ends[k], bounds->count, lo[k]);
+        if (a - b < field_n || *field == SIZE)
+        {
+            *field = k;
+            field_n = a - b;
+            *lo_n = a;
+        }
+    }
+    return field_n;
+}
+
+// positions of the rules which intersect a box along its most selective field
+uint32_t bounds_query(const struct bounds *bounds, const uint32_t *lo, const uint32_t *hi,
+                      uint32_t limit, uint32_t *out)
+{
+    uint32_t field, lo_n;
+    if (select_field(bounds, lo, hi, &field, &lo_n) > limit)
+        return NO_RULE;
+
+    /* gather the rules with lo <= box hi and hi >= box lo, skipping blocks which end too early */
+    const uint64_t *keys = bounds->lo[field];
+    const uint32_t *ends = bounds->hi[field], *reach = bounds->reach[field];
+    uint32_t n = 0;
+    for (uint32_t i=0; i<lo_n; i+=BOUNDS_BLOCK)
+    {
+        if (reach[i/BOUNDS_BLOCK] < lo[field])
+            continue;
+        uint32_t end = (i+BOUNDS_BLOCK < lo_n) ? i+BOUNDS_BLOCK : lo_n;
+        for (uint32_t j=i; j<end; j++)
+        {
+            uint32_t r = (uint32_t)keys[j];
+            if (ends[j] >= lo[field] && r < limit)
+                out[n++] = r;
+        }
+    }
+    return n;
+}
+
+// project column-wise rules over a property
+void layout_project(const struct layout *rules, const struct bounds *bounds, uint64_t *marks,
+                    const uint32_t *prop_lo, const uint32_t *prop_hi, uint32_t action, struct layout *out)
+{
+    for (uint32_t k=0; k<SIZE; k++)
+    {
+        out->prop_lo[k] = prop_lo[k];
+        out->prop_hi[k] = prop_hi[k];
+    }
+    out->action = action;
+    out->values_n = 0;
+    out->extra = 0;
+
+    /* find the field along which the property intersects the fewest rules */
+    uint32_t field = SIZE, field_n = rules->count, lo_n = 0;
+    if (bounds != NULL)
+        field_n = select_field(bounds, prop_lo, prop_hi, &field, &lo_n);
+
+    uint32_t n = 0;
+    if (field == SIZE || field_n > rules->count/2)
+    {   /* not selective enough, visit every rule */
+        for (uint32_t r=0; r<rules->count; r++)
+            n += layout_clip(rules, r, prop_lo, prop_hi, out, n);
+    }
+    else
+    {   /* mark the rules with lo <= prop_hi and hi >= prop_lo, skipping blocks which end too early,
+         * then visit them in their original order */
+        uint32_t words = (rules->count+63)/64;
+        const uint64_t *keys = bounds->lo[field];
+        const uint32_t *hi = bounds->hi[field], *reach = bounds->reach[field];
+        memset(marks, 0, sizeof(*marks)*words);
+        for (uint32_t i=0; i<lo_n; i+=BOUNDS_BLOCK)
+        {
+            if (reach[i/BOUNDS_BLOCK] < prop_lo[field])
+                continue;
+            uint32_t end = (i+BOUNDS_BLOCK < lo_n) ? i+BOUNDS_BLOCK : lo_n;
+            for (uint32_t j=i; j<end; j++)
+            {
+                uint32_t r = (uint32_t)keys[j];
+                if (hi[j] >= prop_lo[field])
+                    marks[r >> 6] |= (uint64_t)1 << (r & 63);
+            }
+        }
+        for (uint32_t w=0; w<words; w++)
+        {
+            for (uint64_t bits = marks[w]; bits; bits &= bits-1)
+            {
+                uint32_t r = w*64 + (uint32_t)__builtin_ctzll(bits);
+                n += layout_clip(rules, r, prop_lo, prop_hi, out, n);
+            }
+        }
+    }
+    out->count = n;
+}
+
+// memory held by a layout
+size_t layout_bytes(const struct layout *layout)
+{
+    if (layout == NULL)
+        return 0;
+    return sizeof(*layout) + sizeof(uint32_t)*LAYOUT_COLUMNS*layout->capacity
+           + sizeof(*layout->values)*layout->values_max;
+}
+
+// free layout
+void layout_free(struct layout *layout)
+{
+    if (layout == NULL)
+        return;
+    free(layout->lo[0]);
+    free(layout->values);
+    free(layout);
+}
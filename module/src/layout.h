@@ -0,0 +1,399 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the rule layout component of the project
+ *   rules projected over a property are stored column-wise (one array
+ *   per field bound) so that a vector kernel can range check a packet
+ *   against several rules at once, the columns of a multi-valued rule
+ *   hold its hull and its ranges are only checked once the hull is hit
+ */
+
+#ifndef IPTABLES_VERIFICATION_LAYOUT_H
+#define IPTABLES_VERIFICATION_LAYOUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "algorithm.h"
+
+/** number of rules range checked together by the vector kernel */
+#define LAYOUT_LANES ((uint32_t) 8)
+
+/** number of columns of a layout: lo & hi of each field, va, id and record */
+#define LAYOUT_COLUMNS (2*SIZE+3)
+
+/** position returned when a packet hits no rule */
+#define NO_RULE UINT32_MAX
+
+struct layout;
+
+/** kernel which finds the position of the first rule containing a packet, NO_RULE if none */
+typedef uint32_t (*layout_kernel)(const struct layout *layout, const uint32_t *packet);
+
+/** rules of a firewall projected over a property, stored column-wise */
+struct layout
+{
+    uint32_t count;         // number of rules
+    uint32_t capacity;      // number of rules the columns can hold, a multiple of LAYOUT_LANES
+    uint32_t *lo[SIZE];     // lower bound of each field
+    uint32_t *hi[SIZE];     // upper bound of each field
+    uint32_t *va;           // action value of each rule
+    uint32_t *id;           // position of each rule in the firewall
+    uint32_t *record;       // 0 for boxes, otherwise 1 + position in values of the record of the rule
+    uint32_t *values;       // records of the multi-valued rules (see struct ranges)
+    uint32_t values_n;      // used size of values
+    uint32_t values_max;    // allocated size of values
+    uint32_t extra;         // ranges of the multi-valued rules beyond one per field
+    uint32_t prop_lo[SIZE]; // lower bounds of the property
+    uint32_t prop_hi[SIZE]; // upper bounds of the property
+    uint32_t action;        // action value of the property
+    layout_kernel first;    // range check kernel picked for the running CPU
+};
+
+/**
+ * allocates an empty layout, the range check kernel is picked here
+ * using AVX2 when the CPU supports it and plain C otherwise
+ * @param capacity maximum number of rules the layout will hold
+ * @param values   size of the records of the multi-valued rules it will hold
+ * @return the layout, or NULL if memory could not be allocated
+ */
+struct layout* layout_alloc(uint32_t capacity, uint32_t values);
+
+/**
+ * points the columns of a layout into a block held elsewhere (such as a
+ * snapshot) and picks its range check kernel, layout_free must not be
+ * used on such a layout
+ * @param layout   layout whose columns are set
+ * @param block    LAYOUT_COLUMNS columns of capacity values each, aligned to 32 bytes
+ * @param capacity length of each column, a multiple of LAYOUT_LANES
+ */
+void layout_wrap(struct layout *layout, uint32_t *block, uint32_t capacity);
+
+/**
+ * most end-points one field of the rules of a layout may add, end-point
+ * sets hold this many values per field
+ * @param layout rules of the set
+ * @return the number of end-points
+ */
+static inline uint32_t layout_points(const struct layout *layout)
+{
+    return layout->count + layout->extra;
+}
+
+/**
+ * projects the rules of a firewall over its property, only the rules
+ * which intersect the property are kept (in their original order)
+ *
+ * @param lo     lower bounds for firewall rules
+ *               the first FIVE elements specify the property fields
+ * @param hi     upper bounds of firewall rules
+ *               the first FIVE elements specify the property fields
+ * @param va     action value for each rule
+ *               the first ONE element specifies the property action
+ * @param count  number of property & firewall rules supplied
+ * @param ranges ranges of the multi-valued rules, NULL if every rule is a box
+ * @return the layout, or NULL if memory could not be allocated
+ */
+struct layout* layout_build(const uint32_t *lo, const uint32_t *hi, const uint32_t *va, uint32_t count,
+                            const struct ranges *ranges);
+
+/**
+ * copies the rules of a firewall column-wise without projecting them,
+ * the property of the copy covers every packet
+ *
+ * @param lo     lower bounds for firewall rules
+ *               the first FIVE elements (the property slot) are ignored
+ * @param hi     upper bounds of firewall rules
+ *               the first FIVE elements (the property slot) are ignored
+ * @param va     action value for each rule
+ *               the first ONE element (the property slot) is ignored
+ * @param count  number of property & firewall rules supplied
+ * @param ranges ranges of the multi-valued rules, NULL if every rule is a box
+ * @return the layout, or NULL if memory could not be allocated
+ */
+struct layout* layout_build_rules(const uint32_t *lo, const uint32_t *hi, const uint32_t *va, uint32_t count,
+                                  const struct ranges *ranges);
+
+/** number of consecutive sorted rules summarised by a single reach value */
+#define BOUNDS_BLOCK ((uint32_t) 64)
+
+/** bounds of every rule sorted per field, used to find the rules which may intersect a property */
+struct bounds
+{
+    uint32_t count;         // number of rules
+    uint64_t *lo[SIZE];     // lower bound << 32 | rule position, ascending, for each field
+    uint32_t *hi[SIZE];     // upper bound of each rule in the order of lo
+    uint32_t *reach[SIZE];  // greatest upper bound of each block of BOUNDS_BLOCK rules of lo
+    uint64_t *ends[SIZE];   // upper bound << 32 | rule position, ascending, for each field
+};
+
+/**
+ * sorts the bounds of each field of a layout
+ * @param rules layout created by layout_build_rules
+ * @return the sorted bounds, or NULL if memory could not be allocated
+ */
+struct bounds* bounds_build(const struct layout *rules);
+
+/**
+ * memory held by sorted bounds
+ * @param bounds bounds created by bounds_build (may be NULL)
+ * @return the number of bytes held
+ */
+size_t bounds_bytes(const struct bounds *bounds);
+
+/**
+ * releases the memory held by sorted bounds
+ * @param bounds bounds created by bounds_build (may be NULL)
+ */
+void bounds_free(struct bounds *bounds);
+
+/**
+ * finds the rules which intersect a box along the field where it intersects
+ * the fewest rules, the rules found may still miss the box along other fields
+ *
+ * @param bounds bounds created by bounds_build
+ * @param lo     lower bounds of the box (an array of SIZE)
+ * @param hi     upper bounds of the box (an array of SIZE)
+ * @param limit  only the rules at positions below limit are wanted
+ * @param out    filled with the positions of the rules found, in no particular order
+ *               (space for limit positions is needed)
+ * @return the number of positions found, or NO_RULE if more than limit rules
+ *         intersect the box along every field (visiting the first limit rules is cheaper)
+ */
+uint32_t bounds_query(const struct bounds *bounds, const uint32_t *lo, const uint32_t *hi,
+                      uint32_t limit, uint32_t *out);
+
+/**
+ * projects column-wise rules over a property, only the rules which
+ * intersect the property are kept (in their original order)
+ *
+ * when sorted bounds are given only the rules which intersect the property
+ * along its most selective field are visited, the field is found by binary search
+ *
+ * @param rules   layout created by layout_build_rules
+ * @param bounds  bounds created by bounds_build from rules (may be NULL to visit every rule)
+ * @param marks   scratch space of (rules->count+63)/64 words, unused if bounds is NULL
+ * @param prop_lo lower bounds of the property (an array of SIZE)
+ * @param prop_hi upper bounds of the property (an array of SIZE)
+ * @param action  action value of the property
+ * @param out     layout the projection is written to, allocated with the capacity of rules or more
+ */
+void layout_project(const struct layout *rules, const struct bounds *bounds, uint64_t *marks,
+                    const uint32_t *prop_lo, const uint32_t *prop_hi, uint32_t action, struct layout *out);
+
+/**
+ * clips the ranges of a multi-valued rule to a box, see layout_clip
+ * @return false if a field of the rule misses the box
+ */
+bool layout_clip_ranges(const struct layout *rules, uint32_t r, const uint32_t *lo, const uint32_t *hi,
+                        struct layout *out, uint32_t n);
+
+/**
+ * clips a rule to a box and writes it at position n of another layout,
+ * whose record space must be able to hold the record of the rule
+ * @param rules layout holding the rule
+ * @param r     position of the rule
+ * @param lo    lower bounds of the box (an array of SIZE)
+ * @param hi    upper bounds of the box (an array of SIZE)
+ * @param out   layout the rule is written to
+ * @param n     position the rule is written at
+ * @return true if the rule intersects the box, otherwise nothing is written
+ */
+static inline bool layout_clip(const struct layout *rules, uint32_t r, const uint32_t *lo, const uint32_t *hi,
+                               struct layout *out, uint32_t n)
+{
+    for (uint32_t k=0; k<SIZE; k++) // for each field in rule
+    {
+        uint32_t l = rules->lo[k][r], h = rules->hi[k][r];
+        if (h < lo[k] || l > hi[k])
+            return false;
+        out->hi[k][n] = (h < hi[k]) ? h : hi[k]; // set hi to min
+        out->lo[k][n] = (l < lo[k]) ? lo[k] : l; // set lo to max
+    }
+    out->record[n] = 0;
+    if (rules->record[r] != 0 && !layout_clip_ranges(rules, r, lo, hi, out, n))
+        return false;
+    out->va[n] = rules->va[r];
+    out->id[n] = rules->id[r];
+    return true;
+}
+
+/**
+ * finds the ranges of a field of a multi-valued rule
+ * @param layout layout holding the rule
+ * @param r      position of the rule, its record must not be 0
+ * @param f      field
+ * @param n      set to the number of ranges
+ * @return the lo,hi pairs of the ranges, in ascending order
+ */
+static inline const uint32_t* layout_ranges(const struct layout *layout, uint32_t r, uint32_t f, uint32_t *n)
+{
+    const uint32_t *record = &layout->values[layout->record[r]-1];
+    const uint32_t *pairs = record + SIZE;
+    for (uint32_t k=0; k<f; k++) pairs += 2*record[k];
+    *n = record[f];
+    return pairs;
+}
+
+/**
+ * tests a value against a field of a rule
+ * @param layout layout holding the rule
+ * @param r      position of the rule
+ * @param f      field
+ * @param value  value of the field
+ * @return true if the value lies within the field
+ */
+static inline bool layout_has(const struct layout *layout, uint32_t r, uint32_t f, uint32_t value)
+{
+    if (value < layout->lo[f][r] || value > layout->hi[f][r])
+        return false;
+    if (layout->record[r] == 0)
+        return true;
+    uint32_t n;
+    const uint32_t *pairs = layout_ranges(layout, r, f, &n);
+    for (uint32_t i=0; i<n && pairs[2*i] <= value; i++)
+    {
+        if (value <= pairs[2*i+1])
+            return true;
+    }
+    return false;
+}
+
+/**
+ * tests a packet against the ranges of a rule whose hull is known to hold it
+ * @param layout layout holding the rule
+ * @param r      position of the rule
+ * @param packet array of SIZE field values
+ * @return true if the rule contains the packet
+ */
+static inline bool layout_holds(const struct layout *layout, uint32_t r, const uint32_t *packet)
+{
+    if (layout->record[r] == 0)
+        return true;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        if (!layout_has(layout, r, f, packet[f]))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * tests a range of values against a field of a rule
+ * @param layout layout holding the rule
+ * @param r      position of the rule
+ * @param f      field
+ * @param lo     lowest value of the range
+ * @param hi     highest value of the range
+ * @param covers set true if the field holds every value of the range
+ * @return true if the field holds a value of the range
+ */
+static inline bool layout_meets(const struct layout *layout, uint32_t r, uint32_t f,
+                                uint32_t lo, uint32_t hi, bool *covers)
+{
+    if (hi < layout->lo[f][r] || lo > layout->hi[f][r])
+        return false;
+    if (layout->record[r] == 0)
+    {
+        *covers = layout->lo[f][r] <= lo && layout->hi[f][r] >= hi;
+        return true;
+    }
+
+    /* only the first range which meets the values may cover them */
+    uint32_t n;
+    const uint32_t *pairs = layout_ranges(layout, r, f, &n);
+    for (uint32_t i=0; i<n && pairs[2*i] <= hi; i++)
+    {
+        if (pairs[2*i+1] >= lo)
+        {
+            *covers = pairs[2*i] <= lo && pairs[2*i+1] >= hi;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * finds the first rule hit by a packet
+ * @param layout rules to test
+ * @param packet array of SIZE field values
+ * @return position of the first rule containing the packet, NO_RULE if none
+ */
+static inline uint32_t layout_first(const struct layout *layout, const uint32_t *packet)
+{
+    return layout->first(layout, packet);
+}
+
+struct packed;
+
+/** kernel which finds the position of the first rule of a packed layout containing a packet, NO_RULE if none */
+typedef uint32_t (*packed_kernel)(const struct packed *packed, const struct layout *layout, const uint32_t *packet);
+
+#define PACKED_COLUMNS(name, bits, min, max) uint##bits##_t *lo_##name, *hi_##name;
+
+/**
+ * bounds of the rules of a layout packed in the width of their field (see
+ * FIELDS), so the range check reads fewer bytes per rule, the kernels are
+ * expanded from the field list so each column is loaded in its own width
+ */
+struct packed
+{
+    uint32_t count;          // number of rules packed
+    uint32_t capacity;       // number of rules the columns can hold
+    FIELDS(PACKED_COLUMNS)   // lower and upper bound columns of each field
+    void *block;             // block holding every column
+    packed_kernel first;     // range check kernel picked for the running CPU
+};
+
+#undef PACKED_COLUMNS
+
+/**
+ * allocates packed columns, the range check kernel is picked here
+ * using AVX2 when the CPU supports it and plain C otherwise
+ * @param capacity maximum number of rules the columns will hold
+ * @return the columns, or NULL if memory could not be allocated
+ */
+struct packed* packed_alloc(uint32_t capacity);
+
+/**
+ * packs the bounds of the rules of a layout
+ * @param packed columns created by packed_alloc with the capacity of the layout or more
+ * @param layout rules to pack
+ * @return false if a bound does not fit the width of its field, the columns may not be used then
+ */
+bool packed_fill(struct packed *packed, const struct layout *layout);
+
+/**
+ * finds the first rule hit by a packet, as layout_first does
+ * @param packed columns filled from layout by packed_fill
+ * @param layout rules which were packed, their multi-valued rules are confirmed against it
+ * @param packet array of SIZE field values
+ * @return position of the first rule containing the packet, NO_RULE if none
+ */
+static inline uint32_t packed_first(const struct packed *packed, const struct layout *layout, const uint32_t *packet)
+{
+    return packed->first(packed, layout, packet);
+}
+
+/**
+ * releases packed columns
+ * @param packed columns created by packed_alloc (may be NULL)
+ */
+void packed_free(struct packed *packed);
+
+/**
+ * memory held by a layout, its columns and records included
+ * @param layout layout created by layout_alloc or layout_build (may be NULL)
+ * @return the number of bytes held
+ */
+size_t layout_bytes(const struct layout *layout);
+
+/**
+ * releases the memory held by a layout
+ * @param layout layout created by layout_alloc or layout_build (may be NULL)
+ */
+void layout_free(struct layout *layout);
+
+#endif //IPTABLES_VERIFICATION_LAYOUT_H
@@ -0,0 +1,507 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of the iptables-save parser
+ *   a line is split into tokens in place and its options are read straight
+ *   into the bounds of the rule, port lists are kept aside and become the
+ *   ranges of a multi-valued rule once the line ends, the rules of the
+ *   chain and of every user-defined chain are kept with the table until it
+ *   ends and the chain is flattened
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <netdb.h>
+#include "parse.h"
+#include "flatten.h"
+
+/** most tokens considered in one line, a longer line is skipped */
+#define PARSE_MAX_TOKENS ((uint32_t) 256)
+
+/** longest token copied for parsing, longer values are rejected */
+#define PARSE_MAX_VALUE ((size_t) 64)
+
+/** a token of a line */
+struct token
+{
+    const char *text;
+    size_t len;
+};
+
+/** ports or port ranges of a port option */
+struct ports
+{
+    uint32_t count;
+    uint32_t pairs[2*PARSE_MAX_PORTS]; // lo,hi of each range
+};
+
+/** options of iptables and of its match extensions, grouped by the field they set */
+static const char *chains[] = {"-A", "--append", NULL};
+static const char *targets[] = {"-j", "--jump", NULL};
+static const char *gotos[] = {"-g", "--goto", NULL};
+static const char *dports[] = {"--destination-port", "--dport", "--dports", NULL};
+static const char *sports[] = {"--sport", "--source-port", "--sports", NULL};
+static const char *saddresses[] = {"-s", "--source", "-src", "--src-range", NULL};
+static const char *daddresses[] = {"-d", "--destination", "-dst", "--dst-range", NULL};
+static const char *protocols[] = {"-p", "--protocols", NULL};
+static const char *matches[] = {"-m", "--match", NULL};
+
+/** match extensions which only enable the options above */
+static const char *modules[] = {"tcp", "udp", "multiport", "iprange", NULL};
+
+/** action values of the targets, in the order of fverify.py */
+static const char *actions[] = {"DROP", "ACCEPT", "REJECT", "QUEUE", "RETURN", NULL};
+
+/** position of RETURN in actions */
+#define ACTION_RETURN 4
+
+// is the token one of the words of a NULL terminated list
+static bool token_in(const struct token *token, const char **words)
+{
+    for (; *words != NULL; words++)
+    {
+        if (strlen(*words) == token->len && memcmp(*words, token->text, token->len) == 0)
+            return true;
+    }
+    return false;
+}
+
+// position of a word in a NULL terminated list ignoring case, -1 if absent
+static int token_find(const struct token *token, const char **words)
+{
+    for (int i=0; words[i] != NULL; i++)
+    {
+        if (strlen(words[i]) == token->len && strncasecmp(words[i], token->text, token->len) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// copies a token into a NUL terminated buffer of PARSE_MAX_VALUE bytes
+static bool token_copy(const struct token *token, char *buf)
+{
+    if (token->len >= PARSE_MAX_VALUE)
+        return false;
+    memcpy(buf, token->text, token->len);
+    buf[token->len] = '\0';
+    return true;
+}
+
+// parses a decimal number no greater than max, the whole of text must be used
+static bool parse_number(const char *text, size_t len, uint32_t max, uint32_t *value)
+{
+    if (len == 0 || len > 10)
+        return false;
+    uint64_t v = 0;
+    for (size_t i=0; i<len; i++)
+    {
+        if (text[i] < '0' || text[i] > '9')
+            return false;
+        v = v*10 + (uint64_t)(text[i] - '0');
+    }
+    if (v > max)
+        return false;
+    *value = (uint32_t) v;
+    return true;
+}
+
+// parses a dotted quad address
+static bool parse_ip(const char *text, size_t len, uint32_t *ip)
+{
+    uint32_t value = 0;
+    for (int octet=0; octet<4; octet++)
+    {
+        size_t n = 0;
+        while (n < len && text[n] != '.')
+            n++;
+        if ((octet < 3) != (n < len)) // three dots, no more
+            return false;
+        uint32_t v;
+        if (!parse_number(text, n, 255, &v))
+            return false;
+        value = value << 8 | v;
+        if (octet < 3)
+        {
+            text += n+1;
+            len -= n+1;
+        }
+    }
+    *ip = value;
+    return true;
+}
+
+/* parses an address option, with the same forms as IPv4Network(strict=False)
+ * and IPv4Address: a.b.c.d/n, a.b.c.d/netmask, a.b.c.d/hostmask, a.b.c.d-e.f.g.h
+ * or a.b.c.d, where the single address 0.0.0.0 leaves the field unbounded */
+static bool parse_address(const struct token *token, uint32_t *lo, uint32_t *hi)
+{
+    const char *text = token->text;
+    size_t len = token->len;
+    const char *sep = memchr(text, '/', len);
+    if (sep != NULL)
+    {   // subnet
+        uint32_t ip, mask;
+        size_t n = (size_t)(sep - text), m = len-n-1;
+        if (!parse_ip(text, n, &ip))
+            return false;
+        uint32_t prefix;
+        if (parse_number(sep+1, m, 32, &prefix))
+            mask = (prefix) ? UINT32_MAX << (32-prefix) : 0;
+        else if (parse_ip(sep+1, m, &mask))
+        {
+            if (~mask & (~mask + 1)) // not a netmask, try as a hostmask
+                mask = ~mask;
+            if (~mask & (~mask + 1))
+                return false;
+        }
+        else
+            return false;
+        *lo = ip & mask;
+        *hi = ip | ~mask;
+        return true;
+    }
+    sep = memchr(text, '-', len);
+    if (sep != NULL)
+    {   // host range
+        size_t n = (size_t)(sep - text);
+        return parse_ip(text, n, lo) && parse_ip(sep+1, len-n-1, hi) && *lo <= *hi;
+    }
+    uint32_t ip;
+    if (!parse_ip(text, len, &ip))
+        return false;
+    if (ip != 0) // if not default route (entire IP range)
+        *lo = *hi = ip;
+    return true;
+}
+
+/* parses a port option: 80, 1000:1010, :1010 or 1000: and comma separated
+ * lists of these, the entries of a list are sorted and merged */
+static bool parse_ports(const struct token *token, struct ports *ports)
+{
+    const char *text = token->text, *end = text + token->len;
+    ports->count = 0;
+    for (;;)
+    {
+        const char *comma = memchr(text, ',', (size_t)(end - text));
+        const char *stop = (comma) ? comma : end;
+        const char *colon = memchr(text, ':', (size_t)(stop - text));
+        if (ports->count == PARSE_MAX_PORTS)
+            return false;
+        uint32_t *lo = &ports->pairs[2*ports->count], *hi = &ports->pairs[2*ports->count+1];
+        if (colon != NULL)
+        {   // range of ports, either end may be left out
+            *lo = 0;
+            *hi = 65535;
+            if (colon > text && !parse_number(text, (size_t)(colon - text), 65535, lo))
+                return false;
+            if (stop > colon+1 && !parse_number(colon+1, (size_t)(stop - colon - 1), 65535, hi))
+                return false;
+            if (*lo > *hi)
+                return false;
+        }
+        else
+        {   // single port
+            if (!parse_number(text, (size_t)(stop - text), 65535, lo))
+                return false;
+            *hi = *lo;
+        }
+        ports->count++;
+        if (comma == NULL)
+        {
+            ports->count = ranges_sort(ports->pairs, ports->count);
+            return true;
+        }
+        text = comma+1;
+    }
+}
+
+// parses a protocol option: all, a number or a name from /etc/protocols
+static bool parse_protocol(const struct token *token, uint32_t *lo, uint32_t *hi)
+{
+    char name[PARSE_MAX_VALUE];
+    uint32_t p;
+    if (token->len == 3 && memcmp(token->text, "all", 3) == 0)
+        return true;
+    if (!parse_number(token->text, token->len, 255, &p))
+    {
+        if (!token_copy(token, name))
+            return false;
+        struct protoent *entry = getprotobyname(name);
+        if (entry == NULL)
+            return false;
+        p = (uint32_t) entry->p_proto;
+    }
+    *lo = *hi = p;
+    return true;
+}
+
+// keeps a skipped line of a chain, the reason names the offending token
+static bool skip_line(struct parser *parser, uint32_t chain, const char *reason, const struct token *token)
+{
+    char text[PARSE_MAX_VALUE + 64];
+    if (token != NULL)
+    {
+        int len = (token->len < PARSE_MAX_VALUE) ? (int) token->len : (int) PARSE_MAX_VALUE;
+        snprintf(text, sizeof(text), "%s '%.*s'", reason, len, token->text);
+        reason = text;
+    }
+    return flatten_skip(parser->table, chain, parser->line, reason);
+}
+
+// the table being read, NULL if memory could not be allocated
+static struct flatten* open_table(struct parser *parser)
+{
+    if (parser->table == NULL)
+        parser->table = flatten_alloc();
+    return parser->table;
+}
+
+// flattens the chain of the table being read, which is then released
+static bool close_table(struct parser *parser)
+{
+    struct flatten *table = parser->table;
+    if (table == NULL)
+        return true;
+    parser->table = NULL;
+    uint32_t chain = flatten_find(table, parser->chain, strlen(parser->chain), NULL);
+    bool ok = chain == NO_CHAIN ||
+              flatten_run(table, chain, parser->policy, parser->rule, parser->skip, parser->arg, &parser->rules);
+    flatten_free(table);
+    return ok;
+}
+
+// prepare parser
+void parser_init(struct parser *parser, const char *chain, parse_rule rule, parse_skip skip, void *arg)
+{
+    parser->chain = chain;
+    parser->rule = rule;
+    parser->skip = skip;
+    parser->arg = arg;
+    parser->line = 0;
+    parser->rules = 0;
+    parser->policy = PARSE_NO_POLICY;
+    parser->table = NULL;
+}
+
+// parse one line
+bool parser_line(struct parser *parser, const char *line, size_t len)
+{
+    parser->line++;
+    while (len && (line[len-1] == '\r' || line[len-1] == '\n'))
+        len--;
+    if (len == 0)
+        return true;
+    if (line[0] == '*' || (len >= 6 && memcmp(line, "COMMIT", 6) == 0)) // the table ends
+        return close_table(parser);
+    if (line[0] != '-' && line[0] != ':')
+        return true;
+
+    /* split the line into tokens */
+    struct token tokens[PARSE_MAX_TOKENS];
+    uint32_t n = 0;
+    bool truncated = false;
+    for (size_t i=0; i<len;)
+    {
+        if (line[i] == ' ' || line[i] == '\t')
+        {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < len && line[i] != ' ' && line[i] != '\t')
+            i++;
+        if (n == PARSE_MAX_TOKENS)
+        {
+            truncated = true;
+            break;
+        }
+        tokens[n++] = (struct token){line + start, i - start};
+    }
+    size_t chain_len = strlen(parser->chain);
+
+    /* chain definition, the policy of the chain is its action value, a user-defined chain has none */
+    if (line[0] == ':')
+    {
+        if (n < 2)
+            return true;
+        if (tokens[0].len == chain_len+1 && memcmp(tokens[0].text+1, parser->chain, chain_len) == 0)
+            parser->policy = (tokens[1].len == 6 && memcmp(tokens[1].text, "ACCEPT", 6) == 0) ? 1 : 0;
+        bool user = tokens[1].len == 1 && tokens[1].text[0] == '-';
+        return open_table(parser) != NULL &&
+               flatten_chain(parser->table, tokens[0].text+1, tokens[0].len-1, user) != NO_CHAIN;
+    }
+
+    /* rule, ignored unless appended to the chain or to a user-defined chain */
+    const struct token *name = NULL;
+    for (uint32_t i=0; i+1<n && name == NULL; i++)
+    {
+        if (token_in(&tokens[i], chains))
+            name = &tokens[i+1];
+    }
+    if (name == NULL)
+        return true;
+    bool user = false;
+    bool ours = name->len == chain_len && memcmp(name->text, parser->chain, chain_len) == 0;
+    uint32_t chain = flatten_find(parser->table, name->text, name->len, &user);
+    if (!ours && (chain == NO_CHAIN || !user))
+        return true;
+    if (open_table(parser) == NULL)
+        return false;
+    if (chain == NO_CHAIN)
+        chain = flatten_chain(parser->table, name->text, name->len, false);
+    if (chain == NO_CHAIN)
+        return false;
+    if (truncated)
+        return skip_line(parser, chain, "too many options", NULL);
+
+    // min/max values for each field, a rule without a target is DROP
+    uint32_t lo[SIZE] = ANY_LO;
+    uint32_t hi[SIZE] = ANY_HI;
+    enum target target = TARGET_ACTION;
+    uint32_t jump = 0;
+    struct ports ports[2] = {{1, {1, 65535}}, {1, {1, 65535}}}; // source, destination
+
+    for (uint32_t i=0; i<n; i+=2)
+    {
+        const struct token *option = &tokens[i], *value = &tokens[i+1];
+        if (option->len == 1 && option->text[0] == '!')
+            return skip_line(parser, chain, "negation is not supported", NULL);
+        bool known = token_in(option, chains) || token_in(option, targets) || token_in(option, gotos) ||
+                     token_in(option, dports) || token_in(option, sports) ||
+                     token_in(option, saddresses) || token_in(option, daddresses) ||
+                     token_in(option, protocols) || token_in(option, matches);
+        if (!known) // ignore rules that contain unsupported fields
+            return skip_line(parser, chain, "unsupported option", option);
+        if (i+1 == n)
+            return skip_line(parser, chain, "missing value for", option);
+
+        if (token_in(option, chains))
+            continue;
+        else if (token_in(option, matches))
+        {
+            if (!token_in(value, modules))
+                return skip_line(parser, chain, "unsupported match", value);
+        }
+        else if (token_in(option, daddresses))
+        {
+            if (!parse_address(value, &lo[DADDR], &hi[DADDR]))
+                return skip_line(parser, chain, "bad address", value);
+        }
+        else if (token_in(option, saddresses))
+        {
+            if (!parse_address(value, &lo[SADDR], &hi[SADDR]))
+                return skip_line(parser, chain, "bad address", value);
+        }
+        else if (token_in(option, protocols))
+        {
+            if (!parse_protocol(value, &lo[PROTO], &hi[PROTO]))
+                return skip_line(parser, chain, "unknown protocol", value);
+        }
+        else if (token_in(option, dports))
+        {
+            if (!parse_ports(value, &ports[1]))
+                return skip_line(parser, chain, "bad port list", value);
+        }
+        else if (token_in(option, sports))
+        {
+            if (!parse_ports(value, &ports[0]))
+                return skip_line(parser, chain, "bad port list", value);
+        }
+        else
+        {   // target, other targets keep the default action as fverify.py does
+            bool callee_user = false;
+            uint32_t callee = flatten_find(parser->table, value->text, value->len, &callee_user);
+            int action = token_find(value, actions);
+            if (token_in(option, gotos))
+            {
+                if (callee == NO_CHAIN || !callee_user)
+                    return skip_line(parser, chain, "goto to an unknown chain", value);
+                target = TARGET_GOTO;
+                jump = callee;
+            }
+            else if (callee != NO_CHAIN && callee_user)
+            {
+                target = TARGET_CALL;
+                jump = callee;
+            }
+            else if (action == ACTION_RETURN)
+                target = TARGET_RETURN;
+            else if (action >= 0)
+                jump = (uint32_t) action;
+        }
+    }
+
+    /* the port fields hold the hull of their lists */
+    lo[SPORT] = ports[0].pairs[0];
+    hi[SPORT] = ports[0].pairs[2*ports[0].count-1];
+    lo[DPORT] = ports[1].pairs[0];
+    hi[DPORT] = ports[1].pairs[2*ports[1].count-1];
+
+    /* a port list makes the rule multi-valued, the other fields hold a single range */
+    uint32_t record[SIZE + 2*SIZE*PARSE_MAX_PORTS], *pairs = record + SIZE;
+    bool multi = ports[0].count > 1 || ports[1].count > 1;
+    for (uint32_t f=0; f<SIZE && multi; f++)
+    {
+        const struct ports *list = (f == SPORT) ? &ports[0] : (f == DPORT) ? &ports[1] : NULL;
+        record[f] = (list) ? list->count : 1;
+        if (list)
+            memcpy(pairs, list->pairs, sizeof(*pairs)*2*list->count);
+        else
+        {
+            pairs[0] = lo[f];
+            pairs[1] = hi[f];
+        }
+        pairs += 2*record[f];
+    }
+    return flatten_rule(parser->table, chain, parser->line, lo, hi, (multi) ? record : NULL, target, jump);
+}
+
+// end the output
+bool parser_end(struct parser *parser)
+{
+    return close_table(parser);
+}
+
+// parse a buffer
+bool parser_buffer(struct parser *parser, const char *text, size_t len)
+{
+    const char *end = text + len;
+    while (text < end)
+    {
+        const char *eol = memchr(text, '\n', (size_t)(end - text));
+        size_t n = (eol) ? (size_t)(eol - text) : (size_t)(end - text);
+        if (!parser_line(parser, text, n))
+        {
+            flatten_free(parser->table);
+            parser->table = NULL;
+            return false;
+        }
+        text += n + (eol != NULL);
+    }
+    return parser_end(parser);
+}
+
+// parse a file
+bool parser_file(struct parser *parser, FILE *file)
+{
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+    bool ok = true;
+    while (ok && (len = getline(&line, &size, file)) >= 0)
+        ok = parser_line(parser, line, (size_t) len);
+    free(line);
+    ok = ok && !ferror(file);
+    if (!ok)
+    {
+        flatten_free(parser->table);
+        parser->table = NULL;
+        return false;
+    }
+    return parser_end(parser);
+}
@@ -0,0 +1,112 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the iptables-save parser component of the project
+ *   the rules of one chain are turned into 5-tuple rules in a single pass
+ *   using the same field semantics as fverify.py, the user-defined chains
+ *   it jumps to are flattened into it once its table ends (see flatten.h),
+ *   each rule is handed to a callback and each line reached which is
+ *   skipped is reported, port lists are kept as multi-valued fields (see
+ *   struct ranges)
+ */
+
+#ifndef IPTABLES_VERIFICATION_PARSE_H
+#define IPTABLES_VERIFICATION_PARSE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "algorithm.h"
+
+/** most ports or port ranges accepted in one port list (as for the multiport match) */
+#define PARSE_MAX_PORTS FIELD_RANGES
+
+/** policy value left in a parser when the chain has no policy line */
+#define PARSE_NO_POLICY UINT32_MAX
+
+/**
+ * receives a rule parsed from the chain
+ * @param arg argument given to parser_init
+ * @param lo  lower bounds of the rule (src address, src port, dst address, dst port, protocol)
+ * @param hi  upper bounds of the rule
+ * @param record ranges of the rule when a field holds a port list (see struct ranges), otherwise NULL
+ * @param va  action value of the rule
+ * @return false to abandon parsing (e.g. if memory could not be allocated)
+ */
+typedef bool (*parse_rule)(void *arg, const uint32_t *lo, const uint32_t *hi, const uint32_t *record, uint32_t va);
+
+/**
+ * receives a line of the chain which was skipped
+ * @param arg    argument given to parser_init
+ * @param line   line number, starting from 1
+ * @param reason why the line was skipped
+ * @return false to abandon parsing
+ */
+typedef bool (*parse_skip)(void *arg, uint32_t line, const char *reason);
+
+/** chains of a table (see flatten.h) */
+struct flatten;
+
+/** state of a parser working through iptables-save output */
+struct parser
+{
+    const char *chain;  // name of the chain whose rules are parsed
+    parse_rule rule;    // called for each rule
+    parse_skip skip;    // called for each line skipped (may be NULL)
+    void *arg;          // argument passed to the callbacks
+    uint32_t line;      // number of the last line parsed
+    uint32_t rules;     // number of rules passed to the rule callback
+    uint32_t policy;    // action value of the default policy of the chain, PARSE_NO_POLICY until found
+    struct flatten *table; // chains of the table being read, NULL between tables
+};
+
+/**
+ * prepares a parser
+ * @param parser parser to initialise
+ * @param chain  name of the chain to parse (e.g. "INPUT")
+ * @param rule   called for each rule of the chain
+ * @param skip   called for each line of the chain which is skipped (may be NULL)
+ * @param arg    argument passed to the callbacks
+ */
+void parser_init(struct parser *parser, const char *chain, parse_rule rule, parse_skip skip, void *arg);
+
+/**
+ * parses one line of iptables-save output, the rules of the chain are
+ * handed to the rule callback once their table ends (at COMMIT, at the
+ * start of the next table or at parser_end)
+ * @param parser parser prepared by parser_init
+ * @param line   text of the line, without its line terminator
+ * @param len    length of the line
+ * @return false if a callback abandoned parsing or memory could not be allocated
+ */
+bool parser_line(struct parser *parser, const char *line, size_t len);
+
+/**
+ * ends the output given to parser_line, handing over the rules of a table
+ * left without COMMIT, and releases the memory of the parser
+ * (parser_buffer and parser_file end the output themselves)
+ * @param parser parser prepared by parser_init
+ * @return false if a callback abandoned parsing or memory could not be allocated
+ */
+bool parser_end(struct parser *parser);
+
+/**
+ * parses a buffer holding iptables-save output
+ * @param parser parser prepared by parser_init
+ * @param text   the output
+ * @param len    length of the output
+ * @return false if a callback abandoned parsing or memory could not be allocated
+ */
+bool parser_buffer(struct parser *parser, const char *text, size_t len);
+
+/**
+ * parses a file holding iptables-save output, reading it line by line
+ * @param parser parser prepared by parser_init
+ * @param file   file opened for reading
+ * @return false if a callback abandoned parsing, memory could not be allocated or the file could not be read
+ */
+bool parser_file(struct parser *parser, FILE *file);
+
+#endif //IPTABLES_VERIFICATION_PARSE_H
@@ -0,0 +1,211 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of the thread pool and of the work-stealing ranges
+ *   a range is packed into a single 64-bit word (first unit << 32 | end)
+ *   so that owners and thieves can both update it with a compare-exchange
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "pool.h"
+
+/** packs the units begin..end-1 into one word */
+#define RANGE(begin, end) (((uint64_t)(begin) << 32) | (uint64_t)(end))
+
+struct worker
+{
+    struct pool *pool;
+    uint32_t id;
+};
+
+struct pool
+{
+    uint32_t size;           // number of workers, including the calling thread
+    pthread_t *threads;      // size-1 background threads
+    struct worker *workers;  // arguments of the background threads
+    pthread_mutex_t run;     // serializes callers of pool_run
+    pthread_mutex_t lock;    // guards the fields below
+    pthread_cond_t wake;     // signalled when a task is started or the pool is stopped
+    pthread_cond_t done;     // signalled when the last background worker finishes a task
+    pool_task task;          // task currently being run
+    void *arg;               // argument of the current task
+    uint64_t generation;     // incremented each time a task is started
+    uint32_t pending;        // background workers which have not finished the current task
+    bool quit;               // set to stop the background workers
+};
+
+// main loop of a background worker
+static void* worker_main(void *arg)
+{
+    struct worker *worker = arg;
+    struct pool *pool = worker->pool;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->quit && pool->generation == seen)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->quit)
+            break;
+        seen = pool->generation;
+        pool_task task = pool->task;
+        void *task_arg = pool->arg;
+        pthread_mutex_unlock(&pool->lock);
+
+        task(task_arg, worker->id);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// start workers
+struct pool* pool_create(uint32_t size)
+{
+    if (size == 0)
+        return NULL;
+    struct pool *pool = calloc(1, sizeof(*pool));
+    if (pool == NULL)
+        return NULL;
+    pool->threads = malloc(sizeof(*pool->threads)*size);
+    pool->workers = malloc(sizeof(*pool->workers)*size);
+    if (pool->threads == NULL || pool->workers == NULL)
+    {
+        free(pool->threads);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->run, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    /* the calling thread is worker 0, start the others */
+    pool->size = 1;
+    for (uint32_t i=1; i<size; i++)
+    {
+        pool->workers[i] = (struct worker){pool, i};
+        if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->workers[i]))
+            break;
+        pool->size++;
+    }
+    return pool;
+}
+
+// number of workers
+uint32_t pool_size(const struct pool *pool)
+{
+    return (pool) ? pool->size : 1;
+}
+
+// run task on all workers
+void pool_run(struct pool *pool, pool_task task, void *arg)
+{
+    if (pool == NULL || pool->size == 1)
+    {
+        task(arg, 0);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->run);
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->arg = arg;
+    pool->pending = pool->size-1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    task(arg, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->run);
+}
+
+// stop workers
+void pool_free(struct pool *pool)
+{
+    if (pool == NULL)
+        return;
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (uint32_t i=1; i<pool->size; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run);
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+}
+
+// divide units between workers
+void ranges_init(_Atomic uint64_t *ranges, uint32_t workers, uint32_t units)
+{
+    for (uint32_t w=0; w<workers; w++)
+    {
+        uint32_t begin = (uint32_t)((uint64_t)units*w/workers);
+        uint32_t end = (uint32_t)((uint64_t)units*(w+1)/workers);
+        atomic_init(&ranges[w], RANGE(begin, end));
+    }
+}
+
+// take or steal a unit
+bool ranges_next(_Atomic uint64_t *ranges, uint32_t workers, uint32_t worker, uint32_t *unit)
+{
+    _Atomic uint64_t *own = &ranges[worker];
+    for (;;)
+    {
+        /* take the lowest unit of the worker's own range */
+        uint64_t range = atomic_load(own);
+        uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+        if (begin < end)
+        {
+            if (atomic_compare_exchange_weak(own, &range, RANGE(begin+1, end)))
+            {
+                *unit = begin;
+                return true;
+            }
+            continue;
+        }
+
+        /* steal the upper half of the first non-empty range of another worker */
+        bool stolen = false;
+        for (uint32_t i=1; i<workers && !stolen; i++)
+        {
+            _Atomic uint64_t *victim = &ranges[(worker+i) % workers];
+            range = atomic_load(victim);
+            begin = (uint32_t)(range >> 32);
+            end = (uint32_t)range;
+            while (begin < end)
+            {
+                uint32_t mid = begin + (end-begin)/2;
+                if (atomic_compare_exchange_weak(victim, &range, RANGE(begin, mid)))
+                {
+                    atomic_store(own, RANGE(mid, end));
+                    stolen = true;
+                    break;
+                }
+                begin = (uint32_t)(range >> 32);
+                end = (uint32_t)range;
+            }
+        }
+        if (!stolen)
+            return false;
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the thread pool component of the project
+ *   exposes a fixed set of worker threads which run a task together,
+ *   and work-stealing ranges used to divide a task into units
+ */
+
+#ifndef IPTABLES_VERIFICATION_POOL_H
+#define IPTABLES_VERIFICATION_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/** opaque thread pool, see pool.c */
+struct pool;
+
+/**
+ * a task run by every worker of a pool
+ * @param arg    argument given to pool_run
+ * @param worker number of the worker running the task (0 is the calling thread)
+ */
+typedef void (*pool_task)(void *arg, uint32_t worker);
+
+/**
+ * starts a pool of worker threads
+ * @param size number of workers, including the thread which calls pool_run
+ * @return the pool, or NULL if the threads could not be started
+ */
+struct pool* pool_create(uint32_t size);
+
+/**
+ * @param pool a pool created by pool_create (may be NULL)
+ * @return the number of workers of the pool, 1 for a NULL pool
+ */
+uint32_t pool_size(const struct pool *pool);
+
+/**
+ * runs a task on every worker of the pool and waits for all of them to return
+ * the calling thread runs the task as worker 0, concurrent callers are serialized
+ * @param pool a pool created by pool_create (may be NULL to run on the calling thread only)
+ * @param task function run by each worker
+ * @param arg  argument passed to the task
+ */
+void pool_run(struct pool *pool, pool_task task, void *arg);
+
+/**
+ * stops the worker threads and releases the pool
+ * @param pool a pool created by pool_create (may be NULL)
+ */
+void pool_free(struct pool *pool);
+
+/**
+ * splits units 0..units-1 into one contiguous range per worker
+ * @param ranges  array of one range per worker
+ * @param workers number of workers
+ * @param units   number of work units
+ */
+void ranges_init(_Atomic uint64_t *ranges, uint32_t workers, uint32_t units);
+
+/**
+ * takes the lowest unit of the worker's own range, once the range is empty
+ * the upper half of another worker's range is stolen
+ * @param ranges  ranges set up by ranges_init
+ * @param workers number of workers
+ * @param worker  number of the calling worker
+ * @param unit    set to the unit taken
+ * @return false once no work is left
+ */
+bool ranges_next(_Atomic uint64_t *ranges, uint32_t workers, uint32_t worker, uint32_t *unit);
+
+#endif //IPTABLES_VERIFICATION_POOL_H
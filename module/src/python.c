@@ -5,130 +5,1764 @@
  * description:
  *   python3 bindings for the least witness algorithm
  *   run setup.py to build and install the python module
+ *   each Firewall object owns its own rules, so several rulesets can be
+ *   verified at once from different python threads (the GIL is released
+ *   while searching), the module functions act on a default Firewall
+ *   a field of a rule is either a (lo, hi) range or a list of such ranges
+ *   box rules may also be added in bulk from buffers of unsigned 32-bit
+ *   values (add_many & load_arrays), which are copied in a single pass
+ *   a firewall loaded from a snapshot verifies against the mapped file
+ *   until a rule is added, the rules are then copied into its own buffers
+ *   other firewalls verify against their reduced rules (see reduce.h),
+ *   which are kept until the rules change
+ *   with set_fdd the rules are also compiled into a decision diagram
+ *   (see fdd.h) which then answers every property, firewalls whose
+ *   diagram does not fit within its memory limit are searched as before
+ *   the result of each property verified is kept (see cache.h) until a
+ *   rule meeting its box is inserted, deleted or replaced, so that after
+ *   a small change only the properties it may affect are verified again
+ *   searches take their buffers from a workspace owned by the firewall,
+ *   sized when the rules are compiled or mapped, memory() reports what
+ *   the firewall holds and the most it has held at once
+ *   with set_stats the searches count what they do and time each phase,
+ *   stats() reports the counts since they were enabled
+ *   violations() returns an iterator over every region of packets which
+ *   violates a property (see regions.h), searched as it is advanced
  */
 #include <Python.h>
+#include <pythread.h>
+#include <time.h>
 #include "algorithm.h"
+#include "cache.h"
+#include "fdd.h"
+#include "layout.h"
+#include "parse.h"
+#include "pool.h"
+#include "reduce.h"
+#include "regions.h"
+#include "snapshot.h"
 
 /// max number of rules for starting buffers
 #define BUF_INIT 128
 
-/** buffers to hold rules and counters for rule count and current buffer maximum */
-uint32_t *lo, *hi, *va, wit[SIZE]={0,0,0,0,0}, count=1, bufmax=BUF_INIT;
+/** takes the lock of a firewall, releasing the GIL if it has to wait */
+#define ACQUIRE_LOCK(obj) do { \
+    if (!PyThread_acquire_lock((obj)->lock, NOWAIT_LOCK)) { \
+        Py_BEGIN_ALLOW_THREADS \
+        PyThread_acquire_lock((obj)->lock, WAIT_LOCK); \
+        Py_END_ALLOW_THREADS \
+    } } while (0)
+#define RELEASE_LOCK(obj) PyThread_release_lock((obj)->lock)
 
-bool use_slicing = true; // whether or not to use slicing algorithm
+/** a firewall, its rule buffers, last witness and verification options */
+typedef struct
+{
+    PyObject_HEAD
+    uint32_t *lo, *hi, *va;     // rules, the first slot is left for the property (see find_witness)
+    uint32_t count, bufmax;     // number of rules (including the property) and buffer capacity
+    uint32_t *record;           // per rule: 0 for boxes, otherwise 1 + position in values of its ranges
+    uint32_t *values;           // records of the multi-valued rules (see struct ranges)
+    uint32_t values_n, values_max;
+    struct snapshot *snapshot;  // rules mapped by load_snapshot, NULL while the buffers hold the rules
+    struct layout *compiled;    // reduced rules, NULL until verified or once the rules change
+    struct bounds *sorted;      // bounds of the reduced rules
+    uint8_t *fate;              // fate of each rule of the buffers (see enum fate)
+    struct fdd *fdd;            // decision diagram of the rules verified against, NULL until verified
+    size_t fdd_limit;           // memory the diagram may use, 0 to search for witnesses instead
+    bool fdd_failed;            // true if the diagram did not fit since the rules last changed
+    struct cache results;       // results of the properties verified since the rules they meet changed
+    struct workspace *workspace; // search buffers reused by every verify, see options
+    size_t peak;                // most memory held at once after a verify, in bytes
+    struct stats stats;         // counts of the searches while options.stats points here, see set_stats
+    uint64_t verified, cached;  // properties verified, and those answered by results kept
+    uint64_t diagram;           // properties answered by the decision diagram
+    uint64_t compile_ns;        // time spent reducing the rules and building the diagram
+    uint32_t policy;            // default policy of the last chain loaded, SNAPSHOT_NO_POLICY if unknown
+    uint32_t wit[SIZE];         // last witness found
+    struct options options;     // slicing, matcher and worker pool (NULL while single threaded)
+    PyThread_type_lock lock;    // held while the buffers are used without the GIL
+} FirewallObject;
 
-/** adds a firewall rule to the global buffers */
-static PyObject *firewall_verifier_size(PyObject *self, PyObject *args)
+static PyTypeObject FirewallType;
+
+/** the violating regions of a property, returned by violations() */
+typedef struct
 {
-    if (!PyArg_ParseTuple(args, ""))
-        return NULL;
-    return PyLong_FromLong(count);
+    PyObject_HEAD
+    struct regions *regions;    // cursor over the regions, NULL once every region has been yielded
+    PyThread_type_lock lock;    // held while the cursor searches without the GIL
+} ViolationsObject;
+
+static PyTypeObject ViolationsType;
+
+/** firewall used by the module functions */
+static FirewallObject *firewall;
+
+/** allocates the rule buffers of a firewall */
+static int firewall_alloc(FirewallObject *self)
+{
+    self->count = 1;
+    self->bufmax = BUF_INIT;
+    self->lo = PyMem_Malloc(sizeof(*self->lo)*SIZE*self->bufmax);
+    self->hi = PyMem_Malloc(sizeof(*self->hi)*SIZE*self->bufmax);
+    self->va = PyMem_Malloc(sizeof(*self->va)*self->bufmax);
+    self->record = PyMem_Malloc(sizeof(*self->record)*self->bufmax);
+    if (self->lo == NULL || self->hi == NULL || self->va == NULL || self->record == NULL)
+    {
+        PyErr_NoMemory();
+        return -1;
+    }
+    self->record[0] = 0; // the property is always a box
+    return 0;
 }
 
-/** adds a firewall rule to the global buffers */
-static PyObject *firewall_verifier_add(PyObject *self, PyObject *args)
+/** resizes the rule buffers of a firewall */
+static int firewall_resize(FirewallObject *self, uint32_t bufmax)
+{
+    uint32_t *lo = PyMem_Realloc(self->lo, sizeof(*lo)*bufmax*SIZE);
+    if (lo == NULL)
+        goto fail;
+    self->lo = lo;
+    uint32_t *hi = PyMem_Realloc(self->hi, sizeof(*hi)*bufmax*SIZE);
+    if (hi == NULL)
+        goto fail;
+    self->hi = hi;
+    uint32_t *va = PyMem_Realloc(self->va, sizeof(*va)*bufmax);
+    if (va == NULL)
+        goto fail;
+    self->va = va;
+    uint32_t *record = PyMem_Realloc(self->record, sizeof(*record)*bufmax);
+    if (record == NULL)
+        goto fail;
+    self->record = record;
+    self->bufmax = bufmax;
+    return 0;
+
+fail:
+    PyErr_NoMemory();
+    return -1;
+}
+
+/** drops the reduced rules and decision diagram of a firewall once its rules change */
+static void firewall_invalidate(FirewallObject *self)
+{
+    bounds_free(self->sorted);
+    layout_free(self->compiled);
+    PyMem_RawFree(self->fate);
+    fdd_free(self->fdd);
+    self->sorted = NULL;
+    self->compiled = NULL;
+    self->fate = NULL;
+    self->fdd = NULL;
+    self->fdd_failed = false;
+}
+
+/** inserts a rule into the buffers of a firewall before the rule at position at (count to append),
+ *  a record (see struct ranges) holding a single range per field is stored as a plain box */
+static int firewall_insert(FirewallObject *self, uint32_t at, const uint32_t *lo, const uint32_t *hi,
+                           const uint32_t *record, uint32_t va)
 {
+    uint32_t size = SIZE, hull_lo[SIZE], hull_hi[SIZE];
+    if (record != NULL)
+    {
+        const uint32_t *pairs = record + SIZE;
+        for (uint32_t f=0; f<SIZE; f++)
+        {
+            hull_lo[f] = pairs[0];
+            hull_hi[f] = pairs[2*record[f]-1];
+            pairs += 2*record[f];
+        }
+        size = (uint32_t)(pairs - record);
+        lo = hull_lo;
+        hi = hull_hi;
+        if (size == 3*SIZE)
+            record = NULL;
+    }
+
     // check if buffer max has been reached
-    if (count%bufmax == 0)
+    if (self->count == self->bufmax && firewall_resize(self, self->bufmax*2))
+        return -1;
+    if (record != NULL && self->values_n + size > self->values_max)
     {
-        /* grow buffers */
-        bufmax *= 2; // double buffer size
-        lo = PyMem_Realloc(lo, sizeof(*lo)*bufmax*SIZE);
-        hi = PyMem_Realloc(hi, sizeof(*hi)*bufmax*SIZE);
-        va = PyMem_Realloc(va, sizeof(*va)*bufmax);
+        uint32_t max = (self->values_max) ? self->values_max : BUF_INIT;
+        while (max < self->values_n + size) max *= 2;
+        uint32_t *values = PyMem_Realloc(self->values, sizeof(*values)*max);
+        if (values == NULL)
+        {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->values = values;
+        self->values_max = max;
     }
 
+    // move the rules from position at down to make room
+    uint32_t moved = self->count - at;
+    memmove(&self->lo[(at+1)*SIZE], &self->lo[at*SIZE], sizeof(*self->lo)*SIZE*moved);
+    memmove(&self->hi[(at+1)*SIZE], &self->hi[at*SIZE], sizeof(*self->hi)*SIZE*moved);
+    memmove(&self->va[at+1], &self->va[at], sizeof(*self->va)*moved);
+    memmove(&self->record[at+1], &self->record[at], sizeof(*self->record)*moved);
+
+    uint32_t i = at*SIZE;
+    for (uint32_t j=0; j<SIZE; j++)
+    {
+        self->lo[i+j] = lo[j];
+        self->hi[i+j] = hi[j];
+    }
+    self->record[at] = 0;
+    if (record != NULL)
+    {
+        memcpy(&self->values[self->values_n], record, sizeof(*record)*size);
+        self->record[at] = self->values_n + 1;
+        self->values_n += size;
+    }
+    self->va[at] = va;
+    self->count++;
+    firewall_invalidate(self);
+    cache_invalidate(&self->results, lo, hi);
+    return 0;
+}
+
+/** deletes the rule at position at from the buffers of a firewall, along with its record */
+static void firewall_delete(FirewallObject *self, uint32_t at)
+{
+    cache_invalidate(&self->results, &self->lo[at*SIZE], &self->hi[at*SIZE]);
+    if (self->record[at] != 0)
+    {   /* records after the one deleted move up */
+        uint32_t first = self->record[at] - 1, size = SIZE;
+        for (uint32_t f=0; f<SIZE; f++) size += 2*self->values[first+f];
+        memmove(&self->values[first], &self->values[first+size],
+                sizeof(*self->values)*(self->values_n - first - size));
+        self->values_n -= size;
+        for (uint32_t r=1; r<self->count; r++)
+        {
+            if (self->record[r] > first + 1)
+                self->record[r] -= size;
+        }
+    }
+
+    uint32_t moved = self->count - at - 1;
+    memmove(&self->lo[at*SIZE], &self->lo[(at+1)*SIZE], sizeof(*self->lo)*SIZE*moved);
+    memmove(&self->hi[at*SIZE], &self->hi[(at+1)*SIZE], sizeof(*self->hi)*SIZE*moved);
+    memmove(&self->va[at], &self->va[at+1], sizeof(*self->va)*moved);
+    memmove(&self->record[at], &self->record[at+1], sizeof(*self->record)*moved);
+    self->count--;
+    firewall_invalidate(self);
+}
+
+/** true if none of n ranges ends before it starts, otherwise raises ValueError, the ranges are read
+ *  stride values apart and every one is compared without branching so that large arrays are vectorised */
+static inline bool check_ranges(const uint32_t *lo, const uint32_t *hi, size_t n, size_t stride)
+{
+    uint32_t bad = 0;
+    for (size_t i=0; i<n; i++)
+        bad |= (lo[i*stride] > hi[i*stride]);
+    if (bad)
+        PyErr_SetString(PyExc_ValueError, "a range must not end before it starts");
+    return !bad;
+}
+
+/** reads a rule whose fields may each be a (lo, hi) range or a list of ranges into a record */
+static int parse_ranges(PyObject *rule, uint32_t *record, uint32_t *va)
+{
+    PyObject *seq = PySequence_Fast(rule, "a rule must be a tuple");
+    if (seq == NULL)
+        return -1;
+    int err = -1;
+    if (PySequence_Fast_GET_SIZE(seq) != SIZE+1)
+    {
+        PyErr_SetString(PyExc_TypeError, "a rule must hold five fields and an action value");
+        goto end;
+    }
+
+    uint32_t *pairs = record + SIZE;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        PyObject *field = PySequence_Fast(PySequence_Fast_GET_ITEM(seq, f),
+                                          "a field must be a range or a list of ranges");
+        if (field == NULL)
+            goto end;
+        Py_ssize_t n = PySequence_Fast_GET_SIZE(field);
+        bool ok = true;
+        if (n == 2 && PyLong_Check(PySequence_Fast_GET_ITEM(field, 0)))
+        {   // a single range
+            n = 1;
+            ok = PyArg_Parse(field, "(II)", &pairs[0], &pairs[1]);
+        }
+        else if (n < 1 || n > FIELD_RANGES)
+        {
+            PyErr_Format(PyExc_ValueError, "a field must hold 1 to %u ranges", FIELD_RANGES);
+            ok = false;
+        }
+        else
+        {   // a list of ranges
+            for (Py_ssize_t i=0; i<n && ok; i++)
+                ok = PyArg_Parse(PySequence_Fast_GET_ITEM(field, i), "(II)", &pairs[2*i], &pairs[2*i+1]);
+        }
+        Py_DECREF(field);
+        if (!ok)
+            goto end;
+
+        // lower bounds value must not be greater than the upper bounds value
+        for (Py_ssize_t i=0; i<n; i++)
+        {
+            if (pairs[2*i] > pairs[2*i+1])
+            {
+                PyErr_SetString(PyExc_ValueError, "a range must not end before it starts");
+                goto end;
+            }
+        }
+        record[f] = ranges_sort(pairs, (uint32_t) n);
+        pairs += 2*record[f];
+    }
+    if (!PyArg_Parse(PySequence_Fast_GET_ITEM(seq, SIZE), "I", va))
+        goto end;
+    err = 0;
+
+end:
+    Py_DECREF(seq);
+    return err;
+}
+
+/** the multi-valued rules of a firewall, NULL if it has none */
+static const struct ranges *firewall_ranges(const FirewallObject *self, struct ranges *ranges)
+{
+    ranges->record = self->record;
+    ranges->values = self->values;
+    return (self->values_n) ? ranges : NULL;
+}
+
+/** nanoseconds on the monotonic clock */
+static uint64_t firewall_clock(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec*1000000000u + (uint64_t)t.tv_nsec;
+}
+
+/** reduces the rules of a firewall unless that was done since they last changed,
+ *  may be called without the GIL, -1 if memory could not be allocated */
+static int firewall_compile(FirewallObject *self)
+{
+    if (self->snapshot != NULL || self->compiled != NULL)
+        return 0;
+    uint64_t start = firewall_clock();
+    struct ranges ranges;
+    struct layout *rules = layout_build_rules(self->lo, self->hi, self->va, self->count,
+                                              firewall_ranges(self, &ranges));
+    struct bounds *bounds = (rules != NULL) ? bounds_build(rules) : NULL;
+    self->fate = PyMem_RawMalloc(sizeof(*self->fate)*self->count);
+    if (bounds != NULL && self->fate != NULL)
+        self->compiled = reduce_rules(rules, bounds, self->fate);
+    if (self->compiled != NULL)
+        self->sorted = bounds_build(self->compiled);
+    bounds_free(bounds);
+    layout_free(rules);
+    if (self->sorted == NULL)
+    {
+        firewall_invalidate(self);
+        return -1;
+    }
+    // buffers which could not be allocated here are tried again by the search
+    workspace_reserve(self->workspace, self->compiled, &self->options);
+    self->compile_ns += firewall_clock() - start;
+    return 0;
+}
+
+/** the rules a firewall verifies against and their sorted bounds (NULL if there are none) */
+static const struct layout *firewall_rules(const FirewallObject *self, const struct bounds **bounds)
+{
+    if (self->snapshot != NULL)
+    {
+        *bounds = (self->snapshot->indexed) ? &self->snapshot->bounds : NULL;
+        return &self->snapshot->rules;
+    }
+    *bounds = self->sorted;
+    return self->compiled;
+}
+
+/** memory held by a firewall, the parts are those reported by memory() */
+static void firewall_memory(const FirewallObject *self, size_t *rules, size_t *compiled, size_t *diagram,
+                            size_t *results, size_t *workspace)
+{
+    *rules = (sizeof(*self->lo) + sizeof(*self->hi))*SIZE*self->bufmax
+             + (sizeof(*self->va) + sizeof(*self->record))*self->bufmax + sizeof(*self->values)*self->values_max;
+    *compiled = layout_bytes(self->compiled) + bounds_bytes(self->sorted)
+                + ((self->fate != NULL) ? sizeof(*self->fate)*self->count : 0);
+    if (self->snapshot != NULL)
+        *compiled = self->snapshot->size;
+    *diagram = fdd_bytes(self->fdd);
+    *results = (sizeof(*self->results.results) + 2*sizeof(*self->results.slots))*self->results.max;
+    *workspace = workspace_bytes(self->workspace);
+}
+
+/** verifies properties against the rules of a firewall, with its decision diagram when
+ *  it has one that fits, may be called without the GIL, -1 if memory could not be allocated */
+static int firewall_search(FirewallObject *self, const uint32_t *lo, const uint32_t *hi, const uint32_t *va,
+                           uint32_t props, uint32_t *witnesses, bool *found)
+{
+    if (firewall_compile(self))
+        return -1;
+    const struct bounds *bounds;
+    const struct layout *rules = firewall_rules(self, &bounds);
+    if (self->fdd_limit != 0 && self->fdd == NULL && !self->fdd_failed)
+    {
+        uint64_t start = firewall_clock();
+        self->fdd = fdd_build(rules, self->fdd_limit);
+        self->fdd_failed = (self->fdd == NULL);
+        self->compile_ns += firewall_clock() - start;
+    }
+    if (self->fdd != NULL)
+    {
+        self->diagram += props;
+        return fdd_witnesses(self->fdd, lo, hi, va, props, witnesses, found);
+    }
+    return find_witnesses_in(rules, bounds, lo, hi, va, props, witnesses, found, &self->options);
+}
+
+/** verifies properties, the results kept since the rules they meet last changed are reused and the
+ *  others are searched for and kept, may be called without the GIL, -1 if memory could not be allocated */
+static int firewall_verify(FirewallObject *self, const uint32_t *lo, const uint32_t *hi, const uint32_t *va,
+                           uint32_t props, uint32_t *witnesses, bool *found)
+{
+    uint32_t *miss = PyMem_RawMalloc(sizeof(*miss)*props + 1);
+    uint32_t *miss_lo = PyMem_RawMalloc(sizeof(*miss_lo)*SIZE*props + 1);
+    uint32_t *miss_hi = PyMem_RawMalloc(sizeof(*miss_hi)*SIZE*props + 1);
+    uint32_t *miss_va = PyMem_RawMalloc(sizeof(*miss_va)*props + 1);
+    uint32_t *miss_wit = PyMem_RawMalloc(sizeof(*miss_wit)*SIZE*props + 1);
+    bool *miss_found = PyMem_RawMalloc(sizeof(*miss_found)*props + 1);
+    int err = -1;
+    if (miss == NULL || miss_lo == NULL || miss_hi == NULL || miss_va == NULL || miss_wit == NULL || miss_found == NULL)
+        goto end;
+
+    /* gather the properties without a result */
+    uint32_t misses = 0;
+    for (uint32_t p=0; p<props; p++)
+    {
+        if (cache_lookup(&self->results, &lo[p*SIZE], &hi[p*SIZE], va[p], &found[p], &witnesses[p*SIZE]))
+            continue;
+        memcpy(&miss_lo[misses*SIZE], &lo[p*SIZE], sizeof(*lo)*SIZE);
+        memcpy(&miss_hi[misses*SIZE], &hi[p*SIZE], sizeof(*hi)*SIZE);
+        miss_va[misses] = va[p];
+        miss[misses++] = p;
+    }
+    self->verified += props;
+    self->cached += props - misses;
+    err = (misses) ? firewall_search(self, miss_lo, miss_hi, miss_va, misses, miss_wit, miss_found) : 0;
+
+    // a result which can't be kept is searched for again next time
+    for (uint32_t m=0; m<misses && !err; m++)
+    {
+        uint32_t p = miss[m];
+        found[p] = miss_found[m];
+        if (miss_found[m])
+            memcpy(&witnesses[p*SIZE], &miss_wit[m*SIZE], sizeof(*witnesses)*SIZE);
+        cache_store(&self->results, &miss_lo[m*SIZE], &miss_hi[m*SIZE], miss_va[m], miss_found[m], &miss_wit[m*SIZE]);
+    }
+
+    /* the workspace and diagram only grow while searching, so the firewall holds the most it will here */
+    size_t rules, compiled, diagram, results, workspace;
+    firewall_memory(self, &rules, &compiled, &diagram, &results, &workspace);
+    if (rules + compiled + diagram + results + workspace > self->peak)
+        self->peak = rules + compiled + diagram + results + workspace;
+
+end:
+    PyMem_RawFree(miss);
+    PyMem_RawFree(miss_lo);
+    PyMem_RawFree(miss_hi);
+    PyMem_RawFree(miss_va);
+    PyMem_RawFree(miss_wit);
+    PyMem_RawFree(miss_found);
+    return err;
+}
+
+/** releases the snapshot mapped by a firewall, if any */
+static void firewall_release(FirewallObject *self)
+{
+    if (self->snapshot == NULL)
+        return;
+    snapshot_close(self->snapshot);
+    PyMem_Free(self->snapshot);
+    self->snapshot = NULL;
+}
+
+/** copies the rules of the snapshot mapped by a firewall into its buffers so that more may be added */
+static int firewall_unmap(FirewallObject *self)
+{
+    if (self->snapshot == NULL)
+        return 0;
+    const struct layout *rules = &self->snapshot->rules;
+    uint32_t bufmax = BUF_INIT;
+    while (bufmax <= rules->count) bufmax *= 2;
+    if (bufmax > self->bufmax && firewall_resize(self, bufmax))
+        return -1;
+    if (rules->values_n > self->values_max)
+    {
+        uint32_t *values = PyMem_Realloc(self->values, sizeof(*values)*rules->values_n);
+        if (values == NULL)
+        {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->values = values;
+        self->values_max = rules->values_n;
+    }
+
+    // records keep their positions, so the values are copied as they are
+    for (uint32_t r=0; r<rules->count; r++)
+    {
+        for (uint32_t k=0; k<SIZE; k++)
+        {
+            self->lo[(r+1)*SIZE + k] = rules->lo[k][r];
+            self->hi[(r+1)*SIZE + k] = rules->hi[k][r];
+        }
+        self->va[r+1] = rules->va[r];
+        self->record[r+1] = rules->record[r];
+    }
+    if (rules->values_n)
+        memcpy(self->values, rules->values, sizeof(*self->values)*rules->values_n);
+    self->values_n = rules->values_n;
+    self->count = rules->count + 1;
+    firewall_release(self);
+    return 0;
+}
+
+/** replaces the worker pool of a firewall */
+static int firewall_threads(FirewallObject *self, unsigned int threads)
+{
+    if (threads == 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "thread count must be at least 1");
+        return -1;
+    }
+    pool_free(self->options.pool);
+    self->options.pool = NULL;
+    if (threads > 1)
+    {
+        self->options.pool = pool_create(threads);
+        if (self->options.pool == NULL)
+        {
+            PyErr_NoMemory();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/** validates a matcher engine */
+static int firewall_engine(int engine)
+{
+    if (engine < ENGINE_SCAN || engine > ENGINE_REFINE)
+    {
+        PyErr_SetString(PyExc_ValueError, "unknown engine");
+        return -1;
+    }
+    return 0;
+}
+
+/** validates the memory limit of a decision diagram */
+static int firewall_fdd(Py_ssize_t limit)
+{
+    if (limit < 0)
+    {
+        PyErr_SetString(PyExc_ValueError, "diagram memory limit must not be negative");
+        return -1;
+    }
+    return 0;
+}
+
+/** creates an empty firewall */
+static PyObject *Firewall_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    FirewallObject *self = (FirewallObject *) type->tp_alloc(type, 0);
+    if (self == NULL)
+        return NULL;
+    self->workspace = workspace_alloc();
+    self->options = (struct options){true, ENGINE_SCAN, NULL, self->workspace};
+    self->policy = SNAPSHOT_NO_POLICY;
+    cache_init(&self->results);
+    stats_clear(&self->stats);
+    self->lock = PyThread_allocate_lock();
+    if (self->lock == NULL || self->workspace == NULL || firewall_alloc(self))
+    {
+        if (self->lock == NULL || self->workspace == NULL)
+            PyErr_NoMemory();
+        Py_DECREF(self);
+        return NULL;
+    }
+    return (PyObject *) self;
+}
+
+/** Firewall(engine=ENGINE_SCAN, threads=1, fdd=0) */
+static int Firewall_init(FirewallObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = {"engine", "threads", "fdd", NULL};
+    int engine = ENGINE_SCAN;
+    unsigned int threads = 1;
+    Py_ssize_t limit = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|iIn", kwlist, &engine, &threads, &limit))
+        return -1;
+    if (firewall_engine(engine) || firewall_fdd(limit))
+        return -1;
+    ACQUIRE_LOCK(self);
+    int err = firewall_threads(self, threads);
+    if (!err)
+    {
+        self->options.engine = engine;
+        fdd_free(self->fdd);
+        self->fdd = NULL;
+        self->fdd_failed = false;
+        self->fdd_limit = (size_t) limit;
+    }
+    RELEASE_LOCK(self);
+    return err;
+}
+
+/** releases the buffers and worker pool of a firewall */
+static void Firewall_dealloc(FirewallObject *self)
+{
+    pool_free(self->options.pool);
+    firewall_release(self);
+    firewall_invalidate(self);
+    cache_free(&self->results);
+    workspace_free(self->workspace);
+    PyMem_Free(self->lo);
+    PyMem_Free(self->hi);
+    PyMem_Free(self->va);
+    PyMem_Free(self->record);
+    PyMem_Free(self->values);
+    if (self->lock != NULL)
+        PyThread_free_lock(self->lock);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/** retrieves the number of rules of the firewall */
+static PyObject *Firewall_size(FirewallObject *self, PyObject *args)
+{
+    if (!PyArg_ParseTuple(args, ""))
+        return NULL;
+    return PyLong_FromLong(self->count);
+}
+
+/** adds a firewall rule to the firewall buffers */
+static PyObject *Firewall_add(FirewallObject *self, PyObject *args)
+{
     // extract firewall rule from arguments
-    uint32_t i=count*SIZE;
+    uint32_t lo[SIZE], hi[SIZE], va, record[SIZE + 2*SIZE*FIELD_RANGES];
+    bool multi = false;
     if (!PyArg_ParseTuple(args, "((II)(II)(II)(II)(II)I)",
-                          &lo[i], &hi[i],     // field 1
-                          &lo[i+1], &hi[i+1], // field 2
-                          &lo[i+2], &hi[i+2], // field 3
-                          &lo[i+3], &hi[i+3], // field 4
-                          &lo[i+4], &hi[i+4], // field 5
-                          &va[count])) // action value
-        return NULL;
+                          &lo[0], &hi[0], // field 1
+                          &lo[1], &hi[1], // field 2
+                          &lo[2], &hi[2], // field 3
+                          &lo[3], &hi[3], // field 4
+                          &lo[4], &hi[4], // field 5
+                          &va)) // action value
+    {
+        // fields holding lists of ranges
+        PyObject *rule;
+        PyErr_Clear();
+        if (!PyArg_ParseTuple(args, "O", &rule) || parse_ranges(rule, record, &va))
+            return NULL;
+        multi = true;
+    }
 
     // verify that the rule is valid before incrementing count
     // lower bounds value must not be greater than the upper bounds value
-    for (int j=0; j<0; j++)
+    if (!multi && !check_ranges(lo, hi, SIZE, 1))
+        return NULL;
+
+    ACQUIRE_LOCK(self);
+    int err = firewall_unmap(self) || firewall_insert(self, self->count, lo, hi, (multi) ? record : NULL, va);
+    uint32_t count = self->count-1;
+    RELEASE_LOCK(self);
+    if (err)
+        return NULL;
+    return PyLong_FromLong(count); // return current size of firewall
+}
+
+/** gets a C-contiguous buffer of native unsigned 32-bit values from an object such as an
+ *  array.array('I'), a numpy uint32 array or a memoryview cast to 'I', its items are counted in n */
+static int get_values(PyObject *obj, Py_buffer *view, Py_ssize_t *n, const char *what)
+{
+    if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT))
+        return -1;
+    const char *format = (view->format != NULL) ? view->format : "B";
+    const uint16_t order = 1;
+    bool little = *(const uint8_t *)&order;
+    if (*format == '@' || *format == '=' || *format == (little ? '<' : '>') || (!little && *format == '!'))
+        format++;
+    if (view->itemsize != sizeof(uint32_t) || (strcmp(format, "I") != 0 && strcmp(format, "L") != 0))
     {
-        if (lo[i+j] > hi[i+j])
-            return NULL;
+        PyErr_Format(PyExc_TypeError, "%s must hold unsigned 32-bit values in native byte order", what);
+        PyBuffer_Release(view);
+        return -1;
+    }
+    *n = view->len / view->itemsize;
+    return 0;
+}
+
+/** appends n box rules to the buffers of a firewall, given as lo,hi pairs field by field
+ *  (the layout of a (n, 5, 2) array) and their action values, the pairs must have been checked */
+static int firewall_append(FirewallObject *self, const uint32_t *pairs, const uint32_t *va, uint32_t n)
+{
+    if (firewall_unmap(self))
+        return -1;
+    if ((uint64_t)self->count + n >= UINT32_MAX)
+    {
+        PyErr_SetString(PyExc_OverflowError, "too many rules");
+        return -1;
+    }
+    uint32_t bufmax = self->bufmax;
+    while (bufmax < self->count + n) bufmax = (bufmax > UINT32_MAX/2) ? UINT32_MAX : 2*bufmax;
+    if (bufmax > self->bufmax && firewall_resize(self, bufmax))
+        return -1;
+
+    /* one pass splits the pairs into the lo & hi buffers, gathering their hull */
+    uint32_t hull_lo[SIZE], hull_hi[SIZE];
+    for (uint32_t j=0; j<SIZE; j++)
+    {
+        hull_lo[j] = UINT32_MAX;
+        hull_hi[j] = 0;
+    }
+    uint32_t *lo = &self->lo[self->count*SIZE], *hi = &self->hi[self->count*SIZE];
+    for (size_t i=0; i<(size_t)SIZE*n; i++)
+    {
+        lo[i] = pairs[2*i];
+        hi[i] = pairs[2*i+1];
+        if (lo[i] < hull_lo[i%SIZE]) hull_lo[i%SIZE] = lo[i];
+        if (hi[i] > hull_hi[i%SIZE]) hull_hi[i%SIZE] = hi[i];
+    }
+    memcpy(&self->va[self->count], va, sizeof(*va)*n);
+    memset(&self->record[self->count], 0, sizeof(*self->record)*n);
+    self->count += n;
+    firewall_invalidate(self);
+    if (n)
+        cache_invalidate(&self->results, hull_lo, hull_hi);
+    return 0;
+}
+
+/** reads the bounds & actions arguments of add_many and load_arrays and appends their rules,
+ *  replacing the rules of the firewall first if replace is true */
+static PyObject *firewall_add_arrays(FirewallObject *self, PyObject *args, bool replace)
+{
+    PyObject *pyBounds, *pyActions;
+    if (!PyArg_ParseTuple(args, "OO", &pyBounds, &pyActions))
+        return NULL;
+    Py_buffer bounds, actions;
+    Py_ssize_t values, n;
+    if (get_values(pyBounds, &bounds, &values, "bounds"))
+        return NULL;
+    if (get_values(pyActions, &actions, &n, "actions"))
+    {
+        PyBuffer_Release(&bounds);
+        return NULL;
+    }
+
+    /* bounds may be shaped (n, 5, 2), (n, 10) or flat, only their number is checked */
+    int err = -1;
+    uint32_t count = 0;
+    if (values != n*2*SIZE)
+        PyErr_SetString(PyExc_ValueError, "bounds must hold a lo,hi pair for each field of each action");
+    else if (n >= UINT32_MAX)
+        PyErr_SetString(PyExc_OverflowError, "too many rules");
+    else if (check_ranges(bounds.buf, (const uint32_t *) bounds.buf + 1, (size_t) n*SIZE, 2))
+    {
+        ACQUIRE_LOCK(self);
+        if (replace)
+        {
+            firewall_release(self);
+            firewall_invalidate(self);
+            cache_clear(&self->results);
+            self->count = 1;
+            self->values_n = 0;
+            self->policy = SNAPSHOT_NO_POLICY;
+        }
+        err = firewall_append(self, bounds.buf, actions.buf, (uint32_t) n);
+        count = self->count-1;
+        RELEASE_LOCK(self);
+    }
+    PyBuffer_Release(&bounds);
+    PyBuffer_Release(&actions);
+    if (err)
+        return NULL;
+    return PyLong_FromLong(count); // return current size of firewall
+}
+
+/** appends the box rules held by arrays, bounds shaped (n, 5, 2) and n actions */
+static PyObject *Firewall_add_many(FirewallObject *self, PyObject *args)
+{
+    return firewall_add_arrays(self, args, false);
+}
+
+/** replaces the rules of the firewall with the box rules held by arrays, bounds shaped (n, 5, 2) and n actions */
+static PyObject *Firewall_load_arrays(FirewallObject *self, PyObject *args)
+{
+    return firewall_add_arrays(self, args, true);
+}
+
+/** reads a rule given as a tuple of five fields and an action value, multi is set if it has a record */
+static int read_rule(PyObject *rule, uint32_t *lo, uint32_t *hi, uint32_t *record, uint32_t *va, bool *multi)
+{
+    *multi = false;
+    if (PyArg_Parse(rule, "((II)(II)(II)(II)(II)I)",
+                    &lo[0], &hi[0], &lo[1], &hi[1], &lo[2], &hi[2], &lo[3], &hi[3], &lo[4], &hi[4], va))
+        return check_ranges(lo, hi, SIZE, 1) ? 0 : -1;
+    PyErr_Clear();
+    if (parse_ranges(rule, record, va))
+        return -1;
+    *multi = true;
+    return 0;
+}
+
+/** reads a property given as a sequence of five fields and an action value, a property is a box
+ *  so a field whose ranges do not merge into one range is refused with a ValueError */
+static int read_property(PyObject *property, uint32_t *lo, uint32_t *hi, uint32_t *va)
+{
+    if (PyArg_Parse(property, "((II)(II)(II)(II)(II)I)",
+                    &lo[0], &hi[0], &lo[1], &hi[1], &lo[2], &hi[2], &lo[3], &hi[3], &lo[4], &hi[4], va))
+        return check_ranges(lo, hi, SIZE, 1) ? 0 : -1;
+    PyErr_Clear();
+
+    /* fields given as lists of ranges are accepted when each list covers a single range */
+    uint32_t record[SIZE + 2*SIZE*FIELD_RANGES];
+    if (parse_ranges(property, record, va))
+        return -1;
+    const uint32_t *pairs = record + SIZE;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        if (record[f] != 1)
+        {
+            PyErr_SetString(PyExc_ValueError, "a property field must be a single range, "
+                                              "verify each combination of its ranges as a property of its own");
+            return -1;
+        }
+        lo[f] = pairs[0];
+        hi[f] = pairs[1];
+        pairs += 2;
+    }
+    return 0;
+}
+
+/** checks the position of a rule of a firewall, rules are numbered from 1 as by iptables and reduce */
+static int firewall_position(FirewallObject *self, Py_ssize_t index, bool end)
+{
+    if (index < 1 || index > (Py_ssize_t) self->count - ((end) ? 0 : 1))
+    {
+        PyErr_SetString(PyExc_IndexError, "rule index out of range");
+        return -1;
+    }
+    return 0;
+}
+
+/** inserts a rule before the rule at an index, size()+1 appends it */
+static PyObject *Firewall_insert(FirewallObject *self, PyObject *args)
+{
+    Py_ssize_t index;
+    PyObject *rule;
+    uint32_t lo[SIZE], hi[SIZE], va, record[SIZE + 2*SIZE*FIELD_RANGES];
+    bool multi;
+    if (!PyArg_ParseTuple(args, "nO", &index, &rule) || read_rule(rule, lo, hi, record, &va, &multi))
+        return NULL;
+
+    ACQUIRE_LOCK(self);
+    int err = firewall_position(self, index, true) || firewall_unmap(self)
+              || firewall_insert(self, (uint32_t) index, lo, hi, (multi) ? record : NULL, va);
+    uint32_t count = self->count-1;
+    RELEASE_LOCK(self);
+    if (err)
+        return NULL;
+    return PyLong_FromLong(count);
+}
+
+/** deletes the rule at an index */
+static PyObject *Firewall_delete(FirewallObject *self, PyObject *args)
+{
+    Py_ssize_t index;
+    if (!PyArg_ParseTuple(args, "n", &index))
+        return NULL;
+
+    ACQUIRE_LOCK(self);
+    int err = firewall_position(self, index, false) || firewall_unmap(self);
+    if (!err)
+        firewall_delete(self, (uint32_t) index);
+    uint32_t count = self->count-1;
+    RELEASE_LOCK(self);
+    if (err)
+        return NULL;
+    return PyLong_FromLong(count);
+}
+
+/** replaces the rule at an index */
+static PyObject *Firewall_replace(FirewallObject *self, PyObject *args)
+{
+    Py_ssize_t index;
+    PyObject *rule;
+    uint32_t lo[SIZE], hi[SIZE], va, record[SIZE + 2*SIZE*FIELD_RANGES];
+    bool multi;
+    if (!PyArg_ParseTuple(args, "nO", &index, &rule) || read_rule(rule, lo, hi, record, &va, &multi))
+        return NULL;
+
+    /* the new rule is inserted first, so that the firewall is left as it was if that fails */
+    ACQUIRE_LOCK(self);
+    int err = firewall_position(self, index, false) || firewall_unmap(self)
+              || firewall_insert(self, (uint32_t) index, lo, hi, (multi) ? record : NULL, va);
+    if (!err)
+        firewall_delete(self, (uint32_t) index + 1);
+    uint32_t count = self->count-1;
+    RELEASE_LOCK(self);
+    if (err)
+        return NULL;
+    return PyLong_FromLong(count);
+}
+
+/** number of properties whose result is kept */
+static PyObject *Firewall_cached(FirewallObject *self, PyObject *args)
+{
+    if (!PyArg_ParseTuple(args, ""))
+        return NULL;
+    ACQUIRE_LOCK(self);
+    uint32_t n = self->results.n;
+    RELEASE_LOCK(self);
+    return PyLong_FromLong(n);
+}
+
+/** memory held by the firewall in bytes, by part, and the most held at once after a verify */
+static PyObject *Firewall_memory(FirewallObject *self, PyObject *args)
+{
+    if (!PyArg_ParseTuple(args, ""))
+        return NULL;
+    size_t rules, compiled, diagram, results, workspace;
+    ACQUIRE_LOCK(self);
+    firewall_memory(self, &rules, &compiled, &diagram, &results, &workspace);
+    size_t peak = self->peak;
+    RELEASE_LOCK(self);
+    if (rules + compiled + diagram + results + workspace > peak)
+        peak = rules + compiled + diagram + results + workspace;
+    return Py_BuildValue("{snsnsnsnsnsn}", "rules", (Py_ssize_t) rules, "compiled", (Py_ssize_t) compiled,
+                         "diagram", (Py_ssize_t) diagram, "results", (Py_ssize_t) results,
+                         "workspace", (Py_ssize_t) workspace, "peak", (Py_ssize_t) peak);
+}
+
+/** counts of the searches since stats were enabled, and the time spent in each phase */
+static PyObject *Firewall_stats(FirewallObject *self, PyObject *args)
+{
+    if (!PyArg_ParseTuple(args, ""))
+        return NULL;
+    ACQUIRE_LOCK(self);
+    const struct stats *st = &self->stats;
+    unsigned long long endpoints[SIZE], endpoints_max[SIZE];
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        endpoints[f] = st->endpoints[f];
+        endpoints_max[f] = st->endpoints_max[f];
     }
-    count++; // increment count
-    return PyLong_FromLong(count-1); // return current size of firewall
+    PyObject *stats = Py_BuildValue(
+            "{sOsKsKsKsKsKsKsKsKs(KKKKK)s(KKKKK)sKsKs{sdsdsdsdsd}}",
+            "enabled", (self->options.stats != NULL) ? Py_True : Py_False,
+            "verified", (unsigned long long) self->verified, "cached", (unsigned long long) self->cached,
+            "diagram", (unsigned long long) self->diagram, "searched", (unsigned long long) st->properties,
+            "projected", (unsigned long long) st->projected, "slices", (unsigned long long) st->slices,
+            "sliced", (unsigned long long) st->sliced, "sets", (unsigned long long) st->sets,
+            "endpoints", endpoints[0], endpoints[1], endpoints[2], endpoints[3], endpoints[4],
+            "endpoints_max", endpoints_max[0], endpoints_max[1], endpoints_max[2], endpoints_max[3], endpoints_max[4],
+            "candidates", (unsigned long long) st->candidates, "comparisons", (unsigned long long) st->comparisons,
+            "seconds", "compile", self->compile_ns/1e9, "project", st->ns[PHASE_PROJECT]/1e9,
+            "slice", st->ns[PHASE_SLICE]/1e9, "endpoints", st->ns[PHASE_ENDPOINTS]/1e9,
+            "search", st->ns[PHASE_SEARCH]/1e9);
+    RELEASE_LOCK(self);
+    return stats;
 }
 
 /** resets the firewall index counter */
-static PyObject *firewall_verifier_clear(PyObject *self, PyObject *args)
+static PyObject *Firewall_clear(FirewallObject *self, PyObject *args)
 {
-    count=1; bufmax=BUF_INIT;
-    /* shrink dynamic buffers */
-    lo = PyMem_Realloc(lo, sizeof(*lo)*bufmax*SIZE);
-    hi = PyMem_Realloc(hi, sizeof(*hi)*bufmax*SIZE);
-    va = PyMem_Realloc(va, sizeof(*va)*bufmax);
-    return PyLong_FromLong(count-1); // return current size (0)
+    ACQUIRE_LOCK(self);
+    firewall_release(self);
+    firewall_invalidate(self);
+    cache_clear(&self->results);
+    workspace_release(self->workspace);
+    self->count = 1;
+    self->values_n = 0;
+    self->policy = SNAPSHOT_NO_POLICY;
+    /* shrink dynamic buffers, keeping the old ones if that fails */
+    if (firewall_resize(self, BUF_INIT))
+        PyErr_Clear();
+    RELEASE_LOCK(self);
+    return PyLong_FromLong(0); // return current size (0)
 }
 
-/** get witness from global */
-static PyObject *firewall_verifier_witness(PyObject *self, PyObject *args)
+/** get last witness of the firewall */
+static PyObject *Firewall_witness(FirewallObject *self, PyObject *args)
 {
+    uint32_t wit[SIZE];
+    ACQUIRE_LOCK(self);
+    memcpy(wit, self->wit, sizeof(wit));
+    RELEASE_LOCK(self);
+
     PyObject *pyWitness = PyTuple_New(SIZE);
-    for (int i=0; i<SIZE; i++)
+    if (pyWitness == NULL)
+        return NULL;
+    for (uint32_t i=0; i<SIZE; i++)
     {
         PyObject *pyObject = PyLong_FromSize_t(wit[i]);
         PyTuple_SetItem(pyWitness, i, pyObject);
     }
-    Py_INCREF(pyWitness);
     return pyWitness;
 }
 
 /** wrapper for the least witness with slicing algorithm */
-static PyObject *firewall_verifier_verify(PyObject *self, PyObject *args)
+static PyObject *Firewall_verify(FirewallObject *self, PyObject *args)
 {
-    // extract property from arguments
-    if (!PyArg_ParseTuple(args, "((II)(II)(II)(II)(II)I)",
-                          &lo[0], &hi[0], // field 1
-                          &lo[1], &hi[1], // field 2
-                          &lo[2], &hi[2], // field 3
-                          &lo[3], &hi[3], // field 4
-                          &lo[4], &hi[4], // field 5
-                          &va[0])) // action value
+    // extract property from arguments, lower bounds must not be greater than upper bounds
+    PyObject *property;
+    uint32_t lo[SIZE], hi[SIZE], va;
+    if (!PyArg_ParseTuple(args, "O", &property) || read_property(property, lo, hi, &va))
         return NULL;
 
-    // verify that the rule is valid before incrementing count
-    // lower bounds value must not be greater than the upper bounds value
-    for (int j=0; j<0; j++)
+    // run witness algorithm without the GIL, the lock keeps the buffers in place
+    bool found = false;
+    int err;
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    err = firewall_verify(self, lo, hi, &va, 1, self->wit, &found);
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+    if (err)
+        return PyErr_NoMemory();
+
+    // return true if no witness found, otherwise the witness was saved
+    if (!found) Py_RETURN_TRUE;
+    Py_RETURN_FALSE;
+}
+
+/** verifies a list of properties, sharing the firewall layout and search buffers */
+static PyObject *Firewall_verify_many(FirewallObject *self, PyObject *args)
+{
+    PyObject *pyProps;
+    if (!PyArg_ParseTuple(args, "O", &pyProps))
+        return NULL;
+    PyObject *seq = PySequence_Fast(pyProps, "properties must be iterable");
+    if (seq == NULL)
+        return NULL;
+
+    // extract properties into lo, hi & va buffers of their own
+    uint32_t props = (uint32_t) PySequence_Fast_GET_SIZE(seq);
+    uint32_t *lo = PyMem_Malloc(sizeof(*lo)*SIZE*props + 1);
+    uint32_t *hi = PyMem_Malloc(sizeof(*hi)*SIZE*props + 1);
+    uint32_t *va = PyMem_Malloc(sizeof(*va)*props + 1);
+    uint32_t *witnesses = PyMem_Malloc(sizeof(*witnesses)*SIZE*props + 1);
+    bool *found = PyMem_Malloc(sizeof(*found)*props + 1);
+    PyObject *result = NULL;
+    if (lo == NULL || hi == NULL || va == NULL || witnesses == NULL || found == NULL)
     {
-        if (lo[j] > hi[j])
-            return NULL;
+        PyErr_NoMemory();
+        goto end;
+    }
+    for (uint32_t p=0; p<props; p++)
+    {
+        if (read_property(PySequence_Fast_GET_ITEM(seq, p), &lo[p*SIZE], &hi[p*SIZE], &va[p]))
+            goto end;
+    }
+
+    // run witness algorithm on every property without the GIL
+    int err;
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    err = firewall_verify(self, lo, hi, va, props, witnesses, found);
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+    if (err)
+    {
+        PyErr_NoMemory();
+        goto end;
+    }
+
+    // None for each property which passes, otherwise its witness
+    result = PyList_New(props);
+    for (uint32_t p=0; p<props && result != NULL; p++)
+    {
+        PyObject *item = Py_None;
+        if (found[p])
+        {
+            uint32_t *w = &witnesses[p*SIZE];
+            item = Py_BuildValue("(IIIII)", w[0], w[1], w[2], w[3], w[4]);
+            if (item == NULL)
+                Py_CLEAR(result);
+        }
+        else
+        {
+            Py_INCREF(item);
+        }
+        if (result != NULL)
+            PyList_SET_ITEM(result, p, item);
+    }
+
+end:
+    PyMem_Free(lo);
+    PyMem_Free(hi);
+    PyMem_Free(va);
+    PyMem_Free(witnesses);
+    PyMem_Free(found);
+    Py_DECREF(seq);
+    return result;
+}
+
+/** iterates over the regions of packets violating a property, each yielded as a rule
+ *  ((lo, hi) of each field, then the position of the rule its packets hit first) */
+static PyObject *Firewall_violations(FirewallObject *self, PyObject *args)
+{
+    PyObject *property;
+    uint32_t lo[SIZE], hi[SIZE], va;
+    if (!PyArg_ParseTuple(args, "O", &property) || read_property(property, lo, hi, &va))
+        return NULL;
+    ViolationsObject *it = PyObject_New(ViolationsObject, &ViolationsType);
+    if (it == NULL)
+        return NULL;
+    it->regions = NULL;
+    it->lock = PyThread_allocate_lock();
+    if (it->lock == NULL)
+    {
+        Py_DECREF(it);
+        return PyErr_NoMemory();
+    }
+
+    /* the cursor keeps its own projection of the rules, so they may change while it is used,
+     * the rules of the buffers are projected rather than the reduced ones so that regions
+     * are tagged with the rule which decides them in the firewall as it was written */
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    if (self->snapshot != NULL)
+    {
+        const struct bounds *bounds;
+        const struct layout *rules = firewall_rules(self, &bounds);
+        it->regions = regions_open(rules, bounds, lo, hi, va);
+    }
+    else
+    {
+        struct ranges ranges;
+        struct layout *rules = layout_build_rules(self->lo, self->hi, self->va, self->count,
+                                                  firewall_ranges(self, &ranges));
+        if (rules != NULL)
+            it->regions = regions_open(rules, NULL, lo, hi, va);
+        layout_free(rules);
+    }
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+    if (it->regions == NULL)
+    {
+        Py_DECREF(it);
+        return PyErr_NoMemory();
+    }
+    return (PyObject *) it;
+}
+
+/** yields the next violating region, searched without the GIL */
+static PyObject *Violations_next(ViolationsObject *self)
+{
+    struct region region;
+    int found = 0;
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    if (self->regions != NULL)
+    {
+        found = regions_next(self->regions, &region);
+        if (found != 1)
+        {
+            regions_free(self->regions);
+            self->regions = NULL;
+        }
+    }
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+    if (found < 0)
+        return PyErr_NoMemory();
+    if (found == 0) // stops the iteration
+        return NULL;
+    return Py_BuildValue("((II)(II)(II)(II)(II)I)", region.lo[0], region.hi[0], region.lo[1], region.hi[1],
+                         region.lo[2], region.hi[2], region.lo[3], region.hi[3], region.lo[4], region.hi[4],
+                         region.rule);
+}
+
+/** releases the cursor of an iterator */
+static void Violations_dealloc(ViolationsObject *self)
+{
+    regions_free(self->regions);
+    if (self->lock != NULL)
+        PyThread_free_lock(self->lock);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/** state of load_iptables_save passed to the parser callbacks */
+struct load
+{
+    FirewallObject *self;
+    PyObject *skipped;  // list of (line, reason) tuples
+};
+
+/** appends a parsed rule to the firewall buffers */
+static bool load_rule(void *arg, const uint32_t *lo, const uint32_t *hi, const uint32_t *record, uint32_t va)
+{
+    FirewallObject *self = ((struct load *) arg)->self;
+    return firewall_insert(self, self->count, lo, hi, record, va) == 0;
+}
+
+/** records a skipped line */
+static bool load_skip(void *arg, uint32_t line, const char *reason)
+{
+    PyObject *item = Py_BuildValue("(Is)", line, reason);
+    if (item == NULL)
+        return false;
+    int err = PyList_Append(((struct load *) arg)->skipped, item);
+    Py_DECREF(item);
+    return err == 0;
+}
+
+/** adds the rules of a chain of iptables-save output (a path or bytes) and its default policy */
+static PyObject *Firewall_load_iptables_save(FirewallObject *self, PyObject *args)
+{
+    PyObject *source;
+    const char *chain;
+    if (!PyArg_ParseTuple(args, "Os", &source, &chain))
+        return NULL;
+
+    struct load load = {self, PyList_New(0)};
+    if (load.skipped == NULL)
+        return NULL;
+    struct parser parser;
+    parser_init(&parser, chain, load_rule, load_skip, &load);
+
+    // bytes-like objects hold the output itself, anything else is a path
+    ACQUIRE_LOCK(self);
+    if (firewall_unmap(self))
+    {
+        RELEASE_LOCK(self);
+        Py_DECREF(load.skipped);
+        return NULL;
+    }
+    uint32_t count = self->count, values_n = self->values_n;
+    bool ok;
+    if (PyObject_CheckBuffer(source))
+    {
+        Py_buffer view;
+        ok = PyObject_GetBuffer(source, &view, PyBUF_SIMPLE) == 0;
+        if (ok)
+        {
+            ok = parser_buffer(&parser, view.buf, (size_t) view.len);
+            PyBuffer_Release(&view);
+        }
+    }
+    else
+    {
+        PyObject *path = NULL;
+        FILE *file = NULL;
+        ok = PyUnicode_FSConverter(source, &path);
+        if (ok)
+        {
+            file = fopen(PyBytes_AS_STRING(path), "r");
+            if (file == NULL)
+                PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, source);
+        }
+        ok = file != NULL && parser_file(&parser, file);
+        if (file != NULL && !ok && !PyErr_Occurred())
+            PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, source);
+        if (file != NULL)
+            fclose(file);
+        Py_XDECREF(path);
+    }
+
+    if (!ok && !PyErr_Occurred())
+        PyErr_NoMemory();
+
+    // the default policy of the chain matches every packet left
+    if (ok && parser.policy == PARSE_NO_POLICY)
+    {
+        PyErr_Format(PyExc_ValueError, "can't find a default policy for '%s'", chain);
+        ok = false;
+    }
+    if (ok)
+    {
+        uint32_t lo[SIZE] = ANY_LO;
+        uint32_t hi[SIZE] = ANY_HI;
+        ok = load_rule(&load, lo, hi, NULL, parser.policy);
+    }
+    if (!ok) // leave the firewall as it was
+    {
+        self->count = count;
+        self->values_n = values_n;
+    }
+    else
+    {
+        self->policy = parser.policy;
+    }
+    uint32_t added = self->count - count;
+    RELEASE_LOCK(self);
+
+    if (!ok)
+    {
+        Py_DECREF(load.skipped);
+        return NULL;
+    }
+    return Py_BuildValue("(IN)", added, load.skipped);
+}
+
+/** reduces the rules of the firewall, listing the rules kept and the rules removed */
+static PyObject *Firewall_reduce(FirewallObject *self, PyObject *args)
+{
+    static const char *fates[] = {"kept", "shadowed", "redundant", "merged"};
+    if (!PyArg_ParseTuple(args, ""))
+        return NULL;
+
+    ACQUIRE_LOCK(self);
+    if (firewall_compile(self))
+    {
+        RELEASE_LOCK(self);
+        return PyErr_NoMemory();
+    }
+
+    // rules are numbered as add numbers them, rules removed before a snapshot was written are not listed
+    const struct bounds *bounds;
+    const struct layout *rules = firewall_rules(self, &bounds);
+    PyObject *kept = PyList_New(rules->count), *removed = PyList_New(0);
+    for (uint32_t i=0; i<rules->count && kept != NULL; i++)
+    {
+        PyObject *item = PyLong_FromUnsignedLong(rules->id[i]);
+        if (item == NULL)
+            Py_CLEAR(kept);
+        else
+            PyList_SET_ITEM(kept, i, item);
+    }
+    for (uint32_t r=1; r<self->count && self->fate != NULL && removed != NULL; r++)
+    {
+        if (self->fate[r-1] == REDUCE_KEPT)
+            continue;
+        PyObject *item = Py_BuildValue("(Is)", r, fates[self->fate[r-1]]);
+        if (item == NULL || PyList_Append(removed, item))
+            Py_CLEAR(removed);
+        Py_XDECREF(item);
+    }
+    RELEASE_LOCK(self);
+
+    if (kept == NULL || removed == NULL)
+    {
+        Py_XDECREF(kept);
+        Py_XDECREF(removed);
+        return NULL;
+    }
+    return Py_BuildValue("(NN)", kept, removed);
+}
+
+/** raises the error of a snapshot which could not be read or written */
+static PyObject *snapshot_error(int status, PyObject *path)
+{
+    if (status == SNAPSHOT_ERRNO)
+        return PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, path);
+    PyErr_Format(PyExc_ValueError, "%S: %s", path, snapshot_strerror(status));
+    return NULL;
+}
+
+/** writes the reduced rules and default policy of the firewall to a snapshot */
+static PyObject *Firewall_save_snapshot(FirewallObject *self, PyObject *args)
+{
+    PyObject *source, *path;
+    int index = 1;
+    if (!PyArg_ParseTuple(args, "O|p", &source, &index) || !PyUnicode_FSConverter(source, &path))
+        return NULL;
+
+    // reduce the rules and write them without the GIL
+    int status = SNAPSHOT_OK, err = 0;
+    bool nomem;
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    struct bounds *bounds = NULL;
+    const struct bounds *sorted = NULL;
+    const struct layout *rules = NULL;
+    if (firewall_compile(self) == 0)
+        rules = firewall_rules(self, &sorted);
+    if (rules != NULL && index && sorted == NULL) // a snapshot written without its bounds
+        sorted = bounds = bounds_build(rules);
+    nomem = rules == NULL || (index && sorted == NULL);
+    if (!nomem)
+        status = snapshot_write(PyBytes_AS_STRING(path), rules, (index) ? sorted : NULL, self->policy);
+    err = errno; // kept for the error raised below
+    bounds_free(bounds);
+    PyThread_release_lock(self->lock);
+    Py_END_ALLOW_THREADS
+    errno = err;
+
+    PyObject *result = Py_None;
+    if (nomem)
+        result = PyErr_NoMemory();
+    else if (status != SNAPSHOT_OK)
+        result = snapshot_error(status, source);
+    Py_XINCREF(result);
+    Py_DECREF(path);
+    return result;
+}
+
+/** replaces the rules of the firewall with those of a snapshot, mapping it into memory */
+static PyObject *Firewall_load_snapshot(FirewallObject *self, PyObject *args)
+{
+    PyObject *source, *path;
+    if (!PyArg_ParseTuple(args, "O", &source) || !PyUnicode_FSConverter(source, &path))
+        return NULL;
+    struct snapshot *snapshot = PyMem_Malloc(sizeof(*snapshot));
+    if (snapshot == NULL)
+    {
+        Py_DECREF(path);
+        return PyErr_NoMemory();
+    }
+
+    // the snapshot is checked before the firewall is touched
+    int status;
+    Py_BEGIN_ALLOW_THREADS
+    status = snapshot_open(PyBytes_AS_STRING(path), snapshot);
+    Py_END_ALLOW_THREADS
+    if (status != SNAPSHOT_OK)
+    {
+        snapshot_error(status, source);
+        PyMem_Free(snapshot);
+        Py_DECREF(path);
+        return NULL;
     }
+    Py_DECREF(path);
+
+    ACQUIRE_LOCK(self);
+    firewall_release(self);
+    firewall_invalidate(self);
+    cache_clear(&self->results);
+    self->snapshot = snapshot;
+    self->count = snapshot->rules.count + 1;
+    self->values_n = 0;
+    self->policy = snapshot->policy;
+    workspace_reserve(self->workspace, &snapshot->rules, &self->options); // tried again by the search if it fails
+    uint32_t count = snapshot->rules.count, policy = snapshot->policy;
+    RELEASE_LOCK(self);
+
+    if (policy == SNAPSHOT_NO_POLICY)
+        return Py_BuildValue("(IO)", count, Py_None);
+    return Py_BuildValue("(II)", count, policy);
+}
+
+/** selects the matcher used when testing candidate witnesses */
+static PyObject *Firewall_set_engine(FirewallObject *self, PyObject *args)
+{
+    int engine;
+    if (!PyArg_ParseTuple(args, "i", &engine))
+        return NULL;
+    if (firewall_engine(engine))
+        return NULL;
+    ACQUIRE_LOCK(self);
+    self->options.engine = engine;
+    RELEASE_LOCK(self);
+    Py_RETURN_NONE;
+}
+
+/** selects whether properties are verified against a decision diagram of the rules */
+static PyObject *Firewall_set_fdd(FirewallObject *self, PyObject *args)
+{
+    Py_ssize_t limit;
+    if (!PyArg_ParseTuple(args, "n", &limit))
+        return NULL;
+    if (firewall_fdd(limit))
+        return NULL;
+    ACQUIRE_LOCK(self);
+    fdd_free(self->fdd);
+    self->fdd = NULL;
+    self->fdd_failed = false;
+    self->fdd_limit = (size_t) limit;
+    RELEASE_LOCK(self);
+    Py_RETURN_NONE;
+}
+
+/** starts or stops counting what the searches do, the counts are zeroed either way */
+static PyObject *Firewall_set_stats(FirewallObject *self, PyObject *args)
+{
+    int enabled;
+    if (!PyArg_ParseTuple(args, "p", &enabled))
+        return NULL;
+    ACQUIRE_LOCK(self);
+    stats_clear(&self->stats);
+    self->verified = self->cached = self->diagram = self->compile_ns = 0;
+    self->options.stats = (enabled) ? &self->stats : NULL;
+    RELEASE_LOCK(self);
+    Py_RETURN_NONE;
+}
+
+/** sets the number of threads used when testing candidate witnesses */
+static PyObject *Firewall_set_threads(FirewallObject *self, PyObject *args)
+{
+    unsigned int threads;
+    if (!PyArg_ParseTuple(args, "I", &threads))
+        return NULL;
+    ACQUIRE_LOCK(self);
+    int err = firewall_threads(self, threads);
+    uint32_t size = pool_size(self->options.pool);
+    RELEASE_LOCK(self);
+    if (err)
+        return NULL;
+    return PyLong_FromLong(size);
+}
+
+/** Firewall method definitions */
+static PyMethodDef FirewallMethods[] = {
+        {"verify",  (PyCFunction) Firewall_verify, METH_VARARGS,
+                "Verifies a property of the firewall."},
+        {"verify_many",  (PyCFunction) Firewall_verify_many, METH_VARARGS,
+                "Verifies a list of properties, returning None or a witness for each, every field of a property\n"
+                "must be a single range."},
+        {"violations",  (PyCFunction) Firewall_violations, METH_VARARGS,
+                "Iterates over every region of packets violating a property, each a rule whose action value\n"
+                "is the position of the rule its packets hit first (rules are numbered from 1, as by insert)."},
+        {"add",  (PyCFunction) Firewall_add, METH_VARARGS,
+                "Adds a rule to the firewall, each field is a (lo, hi) range or a list of ranges."},
+        {"add_many",  (PyCFunction) Firewall_add_many, METH_VARARGS,
+                "Adds the box rules held by buffers, bounds shaped (n, 5, 2) and n actions, of unsigned 32-bit values."},
+        {"load_arrays",  (PyCFunction) Firewall_load_arrays, METH_VARARGS,
+                "Replaces the rules of the firewall with those held by buffers, as add_many takes them."},
+        {"insert",  (PyCFunction) Firewall_insert, METH_VARARGS,
+                "Inserts a rule before the rule at an index (rules are numbered from 1): insert(index, rule)."},
+        {"delete",  (PyCFunction) Firewall_delete, METH_VARARGS,
+                "Deletes the rule at an index (rules are numbered from 1): delete(index)."},
+        {"replace",  (PyCFunction) Firewall_replace, METH_VARARGS,
+                "Replaces the rule at an index (rules are numbered from 1): replace(index, rule)."},
+        {"cached",  (PyCFunction) Firewall_cached, METH_VARARGS,
+                "Retrieves the number of properties whose result is kept until a rule meeting them changes."},
+        {"memory",  (PyCFunction) Firewall_memory, METH_VARARGS,
+                "Reports the memory held by the firewall in bytes, and the most held at once."},
+        {"stats",  (PyCFunction) Firewall_stats, METH_VARARGS,
+                "Reports what the searches did since set_stats(True), and the seconds spent in each phase."},
+        {"load_iptables_save",  (PyCFunction) Firewall_load_iptables_save, METH_VARARGS,
+                "Adds the rules and default policy of a chain of iptables-save output (a path or bytes),\n"
+                "with the user-defined chains it jumps to flattened into it, returning the number of\n"
+                "rules added and a list of (line, reason) for each line reached which was skipped."},
+        {"reduce",  (PyCFunction) Firewall_reduce, METH_VARARGS,
+                "Lists the rules kept once shadowed and redundant rules are removed and boxes merged,\n"
+                "and (rule, reason) for each rule removed, verify uses the rules kept."},
+        {"save_snapshot",  (PyCFunction) Firewall_save_snapshot, METH_VARARGS,
+                "Writes the reduced rules and default policy of the firewall to a snapshot file, along\n"
+                "with their sorted bounds unless index is False: save_snapshot(path, index=True)."},
+        {"load_snapshot",  (PyCFunction) Firewall_load_snapshot, METH_VARARGS,
+                "Replaces the rules of the firewall with those of a snapshot file, mapped in place,\n"
+                "returning the number of rules and the default policy (None if unknown)."},
+        {"clear",  (PyCFunction) Firewall_clear, METH_VARARGS,
+                "Clears the firewall."},
+        {"witness",  (PyCFunction) Firewall_witness, METH_VARARGS,
+                "Retrieve last saved witness packet."},
+        {"size",  (PyCFunction) Firewall_size, METH_VARARGS,
+                "Retrieves the current size of the firewall."},
+        {"set_engine",  (PyCFunction) Firewall_set_engine, METH_VARARGS,
+                "Selects the matcher used to test candidates (ENGINE_SCAN, ENGINE_INDEX, ENGINE_BITSET or ENGINE_REFINE)."},
+        {"set_threads",  (PyCFunction) Firewall_set_threads, METH_VARARGS,
+                "Sets the number of threads used to test candidates."},
+        {"set_stats",  (PyCFunction) Firewall_set_stats, METH_VARARGS,
+                "Starts (True) or stops (False) counting what the searches do, zeroing the counts."},
+        {"set_fdd",  (PyCFunction) Firewall_set_fdd, METH_VARARGS,
+                "Verifies against a decision diagram of the rules using at most limit bytes (FDD_LIMIT is\n"
+                "a sensible value), 0 to search for witnesses, firewalls whose diagram does not fit are searched."},
+        {NULL, NULL, 0, NULL}        /* Sentinel */
+};
+
+/** Firewall type information */
+static PyTypeObject FirewallType = {
+        PyVarObject_HEAD_INIT(NULL, 0)
+        .tp_name = "firewall_verifier.Firewall",
+        .tp_doc = "Firewall(engine=ENGINE_SCAN, threads=1, fdd=0)\n"
+                  "A firewall which owns its rules, verify releases the GIL while searching.\n"
+                  "fdd is the memory limit of its decision diagram in bytes, 0 to search (see set_fdd).",
+        .tp_basicsize = sizeof(FirewallObject),
+        .tp_itemsize = 0,
+        .tp_flags = Py_TPFLAGS_DEFAULT,
+        .tp_new = Firewall_new,
+        .tp_init = (initproc) Firewall_init,
+        .tp_dealloc = (destructor) Firewall_dealloc,
+        .tp_methods = FirewallMethods,
+};
+
+/** Violations type information */
+static PyTypeObject ViolationsType = {
+        PyVarObject_HEAD_INIT(NULL, 0)
+        .tp_name = "firewall_verifier.Violations",
+        .tp_doc = "Iterator over the regions of packets violating a property, see violations().",
+        .tp_basicsize = sizeof(ViolationsObject),
+        .tp_itemsize = 0,
+        .tp_flags = Py_TPFLAGS_DEFAULT,
+        .tp_dealloc = (destructor) Violations_dealloc,
+        .tp_iter = PyObject_SelfIter,
+        .tp_iternext = (iternextfunc) Violations_next,
+};
+
+/** module functions, forwarded to the default firewall */
+static PyObject *firewall_verifier_verify(PyObject *self, PyObject *args)
+{
+    return Firewall_verify(firewall, args);
+}
+
+static PyObject *firewall_verifier_verify_many(PyObject *self, PyObject *args)
+{
+    return Firewall_verify_many(firewall, args);
+}
+
+static PyObject *firewall_verifier_violations(PyObject *self, PyObject *args)
+{
+    return Firewall_violations(firewall, args);
+}
+
+static PyObject *firewall_verifier_add(PyObject *self, PyObject *args)
+{
+    return Firewall_add(firewall, args);
+}
+
+static PyObject *firewall_verifier_add_many(PyObject *self, PyObject *args)
+{
+    return Firewall_add_many(firewall, args);
+}
+
+static PyObject *firewall_verifier_load_arrays(PyObject *self, PyObject *args)
+{
+    return Firewall_load_arrays(firewall, args);
+}
+
+static PyObject *firewall_verifier_insert(PyObject *self, PyObject *args)
+{
+    return Firewall_insert(firewall, args);
+}
+
+static PyObject *firewall_verifier_delete(PyObject *self, PyObject *args)
+{
+    return Firewall_delete(firewall, args);
+}
+
+static PyObject *firewall_verifier_replace(PyObject *self, PyObject *args)
+{
+    return Firewall_replace(firewall, args);
+}
+
+static PyObject *firewall_verifier_cached(PyObject *self, PyObject *args)
+{
+    return Firewall_cached(firewall, args);
+}
+
+static PyObject *firewall_verifier_memory(PyObject *self, PyObject *args)
+{
+    return Firewall_memory(firewall, args);
+}
+
+static PyObject *firewall_verifier_load_iptables_save(PyObject *self, PyObject *args)
+{
+    return Firewall_load_iptables_save(firewall, args);
+}
+
+static PyObject *firewall_verifier_reduce(PyObject *self, PyObject *args)
+{
+    return Firewall_reduce(firewall, args);
+}
+
+static PyObject *firewall_verifier_save_snapshot(PyObject *self, PyObject *args)
+{
+    return Firewall_save_snapshot(firewall, args);
+}
+
+static PyObject *firewall_verifier_load_snapshot(PyObject *self, PyObject *args)
+{
+    return Firewall_load_snapshot(firewall, args);
+}
+
+static PyObject *firewall_verifier_clear(PyObject *self, PyObject *args)
+{
+    return Firewall_clear(firewall, args);
+}
 
-    // run witness algorithm
-    uint32_t *witness = find_witness(lo, hi, va, count, use_slicing);
+static PyObject *firewall_verifier_witness(PyObject *self, PyObject *args)
+{
+    return Firewall_witness(firewall, args);
+}
 
-    // return 0 if no witness found
-    if (witness == NULL) Py_RETURN_TRUE;
+static PyObject *firewall_verifier_size(PyObject *self, PyObject *args)
+{
+    return Firewall_size(firewall, args);
+}
 
-    // otherwise, fill global wit variable and return false
-    for (int i=0; i<SIZE; i++) wit[i] = witness[i];
-    free(witness);      // free witness before returning
-    Py_RETURN_FALSE;    // return false
+static PyObject *firewall_verifier_set_engine(PyObject *self, PyObject *args)
+{
+    return Firewall_set_engine(firewall, args);
+}
+
+static PyObject *firewall_verifier_set_threads(PyObject *self, PyObject *args)
+{
+    return Firewall_set_threads(firewall, args);
+}
+
+static PyObject *firewall_verifier_set_fdd(PyObject *self, PyObject *args)
+{
+    return Firewall_set_fdd(firewall, args);
+}
+
+static PyObject *firewall_verifier_set_stats(PyObject *self, PyObject *args)
+{
+    return Firewall_set_stats(firewall, args);
+}
+
+static PyObject *firewall_verifier_stats(PyObject *self, PyObject *args)
+{
+    return Firewall_stats(firewall, args);
 }
 
 /** Python Module method definitions */
 static PyMethodDef FirewallVerifierMethods[] = {
         {"verify",  firewall_verifier_verify, METH_VARARGS,
                 "Verifies a property of a firewall."},
+        {"verify_many",  firewall_verifier_verify_many, METH_VARARGS,
+                "Verifies a list of properties, returning None or a witness for each, every field of a property\n"
+                "must be a single range."},
+        {"violations",  firewall_verifier_violations, METH_VARARGS,
+                "Iterates over every region of packets violating a property, each a rule whose action value\n"
+                "is the position of the rule its packets hit first (rules are numbered from 1, as by insert)."},
         {"add",  firewall_verifier_add, METH_VARARGS,
-                "Adds a rule to the firewall."},
+                "Adds a rule to the firewall, each field is a (lo, hi) range or a list of ranges."},
+        {"add_many",  firewall_verifier_add_many, METH_VARARGS,
+                "Adds the box rules held by buffers to the default firewall, bounds shaped (n, 5, 2) and n actions."},
+        {"load_arrays",  firewall_verifier_load_arrays, METH_VARARGS,
+                "Replaces the rules of the default firewall with those held by buffers, as add_many takes them."},
+        {"insert",  firewall_verifier_insert, METH_VARARGS,
+                "Inserts a rule before the rule at an index (rules are numbered from 1): insert(index, rule)."},
+        {"delete",  firewall_verifier_delete, METH_VARARGS,
+                "Deletes the rule at an index (rules are numbered from 1): delete(index)."},
+        {"replace",  firewall_verifier_replace, METH_VARARGS,
+                "Replaces the rule at an index (rules are numbered from 1): replace(index, rule)."},
+        {"cached",  firewall_verifier_cached, METH_VARARGS,
+                "Retrieves the number of properties whose result is kept until a rule meeting them changes."},
+        {"memory",  firewall_verifier_memory, METH_VARARGS,
+                "Reports the memory held by the default firewall in bytes, and the most held at once."},
+        {"stats",  firewall_verifier_stats, METH_VARARGS,
+                "Reports what the searches did since set_stats(True), and the seconds spent in each phase."},
+        {"load_iptables_save",  firewall_verifier_load_iptables_save, METH_VARARGS,
+                "Adds the rules and default policy of a chain of iptables-save output (a path or bytes),\n"
+                "with the user-defined chains it jumps to flattened into it, returning the number of\n"
+                "rules added and a list of (line, reason) for each line reached which was skipped."},
+        {"reduce",  firewall_verifier_reduce, METH_VARARGS,
+                "Lists the rules kept once shadowed and redundant rules are removed and boxes merged,\n"
+                "and (rule, reason) for each rule removed, verify uses the rules kept."},
+        {"save_snapshot",  firewall_verifier_save_snapshot, METH_VARARGS,
+                "Writes the reduced rules and default policy of the firewall to a snapshot file, along\n"
+                "with their sorted bounds unless index is False: save_snapshot(path, index=True)."},
+        {"load_snapshot",  firewall_verifier_load_snapshot, METH_VARARGS,
+                "Replaces the rules of the firewall with those of a snapshot file, mapped in place,\n"
+                "returning the number of rules and the default policy (None if unknown)."},
         {"clear",  firewall_verifier_clear, METH_VARARGS,
                 "Clears the firewall."},
         {"witness",  firewall_verifier_witness, METH_VARARGS,
                 "Retrieve last saved witness packet."},
         {"size",  firewall_verifier_size, METH_VARARGS,
                 "Retrieves the current size of the firewall."},
+        {"set_engine",  firewall_verifier_set_engine, METH_VARARGS,
+                "Selects the matcher used to test candidates (ENGINE_SCAN, ENGINE_INDEX, ENGINE_BITSET or ENGINE_REFINE)."},
+        {"set_threads",  firewall_verifier_set_threads, METH_VARARGS,
+                "Sets the number of threads used to test candidates."},
+        {"set_stats",  firewall_verifier_set_stats, METH_VARARGS,
+                "Starts (True) or stops (False) counting what the searches do, zeroing the counts."},
+        {"set_fdd",  firewall_verifier_set_fdd, METH_VARARGS,
+                "Verifies against a decision diagram of the rules using at most limit bytes (FDD_LIMIT is\n"
+                "a sensible value), 0 to search for witnesses, firewalls whose diagram does not fit are searched."},
         {NULL, NULL, 0, NULL}        /* Sentinel */
 };
 
@@ -148,17 +1782,31 @@ PyMODINIT_FUNC PyInit_firewall_verifier(void)
 {
     PyObject *m;
 
+    if (PyType_Ready(&FirewallType) < 0 || PyType_Ready(&ViolationsType) < 0)
+        return NULL;
+
     m = PyModule_Create(&firewall_verifier_module);
     if (m == NULL)
         return NULL;
 
-    /* initialize global buffers*/
-    lo = PyMem_Malloc(sizeof(*lo)*SIZE*bufmax);
-    hi = PyMem_Malloc(sizeof(*hi)*SIZE*bufmax);
-    va = PyMem_Malloc(sizeof(*va)*bufmax);
+    /* initialize default firewall */
+    firewall = (FirewallObject *) PyObject_CallObject((PyObject *) &FirewallType, NULL);
+    if (firewall == NULL)
+    {
+        Py_DECREF(m);
+        return NULL;
+    }
+
+    Py_INCREF(&FirewallType);
+    PyModule_AddObject(m, "Firewall", (PyObject *) &FirewallType);
+    PyModule_AddIntConstant(m, "ENGINE_SCAN", ENGINE_SCAN);
+    PyModule_AddIntConstant(m, "ENGINE_INDEX", ENGINE_INDEX);
+    PyModule_AddIntConstant(m, "ENGINE_BITSET", ENGINE_BITSET);
+    PyModule_AddIntConstant(m, "ENGINE_REFINE", ENGINE_REFINE);
+    PyModule_AddObject(m, "FDD_LIMIT", PyLong_FromSize_t(FDD_LIMIT));
 
     PythonError = PyErr_NewException("firewall_verifier.error", NULL, NULL);
     Py_INCREF(PythonError);
     PyModule_AddObject(m, "error", PythonError);
     return m;
-}
\ No newline at end of file
+}
@@ -0,0 +1,205 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of the rule reduction pass
+ *   a rule is shadowed when a single earlier rule holds all of its packets,
+ *   it is redundant when the first later rule which holds all of its packets
+ *   has its action and every rule in between which meets it also has its
+ *   action, the sorted bounds limit both searches to the rules which meet
+ *   the rule along one field
+ *   rules are judged from the last to the first against the rules still
+ *   kept, so each removal leaves a firewall which decides every packet as
+ *   the one before it did (two equal rules can't both be removed for
+ *   standing in for each other)
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "reduce.h"
+
+// ranges of a field of a rule, a box has a single range
+static const uint32_t* field_ranges(const struct layout *rules, uint32_t r, uint32_t f,
+                                    uint32_t *box, uint32_t *n)
+{
+    if (rules->record[r] != 0)
+        return layout_ranges(rules, r, f, n);
+    box[0] = rules->lo[f][r];
+    box[1] = rules->hi[f][r];
+    *n = 1;
+    return box;
+}
+
+// true if rule q holds every packet of rule r
+static bool covers(const struct layout *rules, uint32_t q, uint32_t r)
+{
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        /* the ranges of q are disjoint and never touch, so each range
+         * of r has to lie within a single range of q */
+        uint32_t box[2], n;
+        const uint32_t *pairs = field_ranges(rules, r, f, box, &n);
+        for (uint32_t i=0; i<n; i++)
+        {
+            bool all;
+            if (!layout_meets(rules, q, f, pairs[2*i], pairs[2*i+1], &all) || !all)
+                return false;
+        }
+    }
+    return true;
+}
+
+// true if the hulls of two rules meet, rules with ranges may still miss each other
+static bool meets(const struct layout *rules, uint32_t q, uint32_t r)
+{
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        if (rules->hi[f][q] < rules->lo[f][r] || rules->lo[f][q] > rules->hi[f][r])
+            return false;
+    }
+    return true;
+}
+
+// ascending order of rule positions
+static int compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* decide whether rule r is shadowed or redundant, found holds the rules which meet it along one field,
+ * the rules after r have been judged already and only those kept are walked */
+static uint8_t judge(const struct layout *rules, uint32_t r, uint32_t *found, uint32_t m,
+                     const uint8_t *fates, uint64_t *marks)
+{
+    /* shadowed by an earlier rule */
+    for (uint32_t i=0; i<m; i++)
+    {
+        if (found[i] < r && covers(rules, found[i], r))
+            return REDUCE_SHADOWED;
+    }
+
+    /* order the later rules kept, a few are sorted while many are
+     * collected from a bit-vector */
+    uint32_t later = 0, words = (rules->count+63)/64;
+    for (uint32_t i=0; i<m; i++)
+    {
+        if (found[i] > r && fates[found[i]] == REDUCE_KEPT)
+            found[later++] = found[i];
+    }
+    if (later > words/8)
+    {
+        for (uint32_t i=0; i<later; i++)
+            marks[found[i] >> 6] |= (uint64_t)1 << (found[i] & 63);
+        later = 0;
+        for (uint32_t w=r >> 6; w<words; w++)
+        {
+            for (uint64_t bits = marks[w]; bits; bits &= bits-1)
+                found[later++] = w*64 + (uint32_t)__builtin_ctzll(bits);
+            marks[w] = 0;
+        }
+    }
+    else
+    {
+        qsort(found, later, sizeof(*found), compare);
+    }
+
+    /* walk them until one which covers r or one with another action which meets it */
+    for (uint32_t i=0; i<later; i++)
+    {
+        uint32_t q = found[i];
+        if (!meets(rules, q, r))
+            continue;
+        if (rules->va[q] != rules->va[r])
+            return REDUCE_KEPT;
+        if (covers(rules, q, r))
+            return REDUCE_REDUNDANT;
+    }
+    return REDUCE_KEPT;
+}
+
+// true if box r can be merged into box a of out, the two differ along one field where they meet or touch
+static bool mergeable(const struct layout *out, uint32_t a, const struct layout *rules, uint32_t r, uint32_t *field)
+{
+    if (out->record[a] != 0 || rules->record[r] != 0 || out->va[a] != rules->va[r])
+        return false;
+    *field = SIZE;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        if (out->lo[f][a] == rules->lo[f][r] && out->hi[f][a] == rules->hi[f][r])
+            continue;
+        if (*field != SIZE)
+            return false;
+        *field = f;
+    }
+    if (*field == SIZE)
+        return true;
+    uint32_t f = *field;
+    return (uint64_t)out->hi[f][a] + 1 >= rules->lo[f][r] && (uint64_t)rules->hi[f][r] + 1 >= out->lo[f][a];
+}
+
+// reduce the rules of a firewall
+struct layout* reduce_rules(const struct layout *rules, const struct bounds *bounds, uint8_t *fate)
+{
+    uint32_t n = rules->count, words = (n+63)/64;
+    struct layout *out = layout_alloc(n, rules->values_n);
+    uint8_t *fates = (fate != NULL) ? fate : malloc(sizeof(*fates)*n + 1);
+    uint32_t *found = malloc(sizeof(*found)*n + 1);
+    uint64_t *marks = calloc(words + 1, sizeof(*marks));
+    if (out == NULL || fates == NULL || found == NULL || marks == NULL)
+    {
+        layout_free(out);
+        out = NULL;
+        goto end;
+    }
+
+    /* judge each rule, from the last */
+    for (uint32_t r=n; r-- > 0;)
+    {
+        uint32_t lo[SIZE], hi[SIZE];
+        for (uint32_t f=0; f<SIZE; f++)
+        {
+            lo[f] = rules->lo[f][r];
+            hi[f] = rules->hi[f][r];
+        }
+        uint32_t m = bounds_query(bounds, lo, hi, n, found);
+        fates[r] = judge(rules, r, found, m, fates, marks);
+    }
+
+    /* copy the rules kept, merging each box into the one before it where possible */
+    uint32_t all_lo[SIZE], all_hi[SIZE];
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        out->prop_lo[f] = all_lo[f] = 0;
+        out->prop_hi[f] = all_hi[f] = UINT32_MAX;
+    }
+    out->action = 0;
+    out->values_n = 0;
+    out->extra = 0;
+    uint32_t k = 0, field;
+    for (uint32_t r=0; r<n; r++)
+    {
+        if (fates[r] != REDUCE_KEPT)
+            continue;
+        if (k > 0 && mergeable(out, k-1, rules, r, &field))
+        {
+            if (field != SIZE)
+            {
+                if (rules->lo[field][r] < out->lo[field][k-1]) out->lo[field][k-1] = rules->lo[field][r];
+                if (rules->hi[field][r] > out->hi[field][k-1]) out->hi[field][k-1] = rules->hi[field][r];
+            }
+            fates[r] = REDUCE_MERGED;
+            continue;
+        }
+        k += layout_clip(rules, r, all_lo, all_hi, out, k);
+    }
+    out->count = k;
+
+end:
+    if (fate == NULL)
+        free(fates);
+    free(found);
+    free(marks);
+    return out;
+}
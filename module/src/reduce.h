@@ -0,0 +1,43 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the rule reduction component of the project
+ *   rules which can never decide a packet, or whose packets are always
+ *   decided the same way without them, are removed from a firewall and
+ *   neighbouring boxes with the same action are merged, the firewall
+ *   left decides every packet as the original one did
+ */
+
+#ifndef IPTABLES_VERIFICATION_REDUCE_H
+#define IPTABLES_VERIFICATION_REDUCE_H
+
+#include <stdint.h>
+#include "layout.h"
+
+/** what became of each rule of a reduced firewall */
+enum fate
+{
+    REDUCE_KEPT = 0,      // the rule is kept
+    REDUCE_SHADOWED = 1,  // an earlier rule holds every packet of the rule
+    REDUCE_REDUNDANT = 2, // every packet of the rule is decided the same way by later rules
+    REDUCE_MERGED = 3     // the rule was merged into the box of the rule kept before it
+};
+
+/**
+ * reduces the rules of a firewall
+ *
+ * the verdict of a property does not change, nor does its witness when
+ * searching without slicing, searching with slicing may find another
+ * packet which violates the property
+ *
+ * @param rules  layout created by layout_build_rules
+ * @param bounds bounds created by bounds_build from rules
+ * @param fate   filled with the fate of each rule (an array of rules->count), may be NULL
+ * @return the rules kept in their original order, the id of a merged rule is that of
+ *         the first rule it stands for, NULL if memory could not be allocated
+ */
+struct layout* reduce_rules(const struct layout *rules, const struct bounds *bounds, uint8_t *fate);
+
+#endif //IPTABLES_VERIFICATION_REDUCE_H
@@ -0,0 +1,244 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of the branch-and-bound candidate search
+ *   a box is a range of end-point positions for each field, it is always
+ *   split along its first field holding more than one end-point so the
+ *   lower half holds every candidate which comes first lexicographically,
+ *   each box keeps the rules which intersect it in priority order, the
+ *   ranges of a multi-valued rule decide whether it meets or covers a box
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "refine.h"
+
+struct refine
+{
+    const struct layout *layout;
+    const uint32_t *set;        // end-points of each field (fields indexed by n*points)
+    uint32_t points;            // end-points per field of the set
+    uint32_t *stack;            // rule lists of the boxes on the current path
+    size_t top, max;            // used and allocated size of the stack
+    bool (*stop)(void *arg);    // polled once per box
+    void *arg;
+    uint32_t witness[SIZE];     // set once a witness is found
+    bool found;
+    bool failed;                // set if memory could not be allocated, which ends the search
+};
+
+// make room for n more rules on the stack, false if memory could not be allocated
+static bool reserve(struct refine *r, uint32_t n)
+{
+    if (r->top + n <= r->max)
+        return true;
+    size_t max = (r->max) ? r->max : 64;
+    while (max < r->top + n) max *= 2;
+    uint32_t *tmp = realloc(r->stack, sizeof(*tmp)*max);
+    if (tmp == NULL)
+        return false;
+    r->stack = tmp;
+    r->max = max;
+    return true;
+}
+
+// first rule of the list containing the candidate, NO_RULE if none
+static uint32_t first_in(const struct layout *layout, const uint32_t *list, uint32_t len, const uint32_t *candidate)
+{
+    for (uint32_t i=0; i<len; i++)
+    {
+        uint32_t rule = list[i], f;
+        for (f=0; f<SIZE; f++)
+        {
+            if (candidate[f] < layout->lo[f][rule] || candidate[f] > layout->hi[f][rule])
+                break;
+        }
+        if (f == SIZE && layout_holds(layout, rule, candidate))
+            return rule;
+    }
+    return NO_RULE;
+}
+
+// test the candidates of a small box in lexicographic order
+static void enumerate(struct refine *r, const uint32_t *a, const uint32_t *b, const uint32_t *list, uint32_t len)
+{
+    const struct layout *layout = r->layout;
+    uint32_t points = r->points, k[SIZE], candidate[SIZE];
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        k[f] = a[f];
+        candidate[f] = r->set[f*points + k[f]];
+    }
+    for (;;)
+    {
+        uint32_t i = first_in(layout, list, len, candidate);
+        if (i != NO_RULE && layout->va[i] != layout->action)
+        {
+            memcpy(r->witness, candidate, sizeof(candidate));
+            r->found = true;
+            return;
+        }
+
+        /* advance to the next candidate like an odometer, the last field turns fastest */
+        uint32_t f = SIZE;
+        while (f-- > 0)
+        {
+            if (++k[f] < b[f])
+                break;
+            k[f] = a[f];
+            candidate[f] = r->set[f*points + k[f]];
+        }
+        if (f == UINT32_MAX) // every candidate of the box has been tested
+            return;
+        candidate[f] = r->set[f*points + k[f]];
+    }
+}
+
+// first position of the end-points a..b-1 of field f which is not below value
+static uint32_t find_endpoint(const struct refine *r, uint32_t f, uint32_t a, uint32_t b, uint32_t value)
+{
+    const uint32_t *endpoints = &r->set[f*r->points];
+    while (a < b)
+    {
+        uint32_t m = a + (b-a)/2;
+        if (endpoints[m] < value) a = m+1;
+        else b = m;
+    }
+    return a;
+}
+
+// search the box a..b-1 whose parent's rules are at list, true once the search is over
+static bool refine_box(struct refine *r, const uint32_t *a, const uint32_t *b, size_t list, uint32_t len)
+{
+    const struct layout *layout = r->layout;
+    uint32_t points = r->points;
+    if (r->stop != NULL && r->stop(r->arg))
+        return true;
+
+    /* the candidates of the box lie within these values */
+    uint32_t lo[SIZE], hi[SIZE];
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        lo[f] = r->set[f*points + a[f]];
+        hi[f] = r->set[f*points + b[f]-1];
+    }
+
+    /* keep the rules which intersect the box, up to the first which covers it,
+     * and the hull of the disagreeing rules which were kept */
+    if (!reserve(r, len))
+    {
+        r->failed = true;
+        return true;
+    }
+    size_t own = r->top;
+    uint32_t n = 0, dlo[SIZE], dhi[SIZE];
+    bool disagree = false, covered = false;
+    for (uint32_t i=0; i<len && !covered; i++)
+    {
+        uint32_t rule = r->stack[list+i], f;
+        bool covers = true;
+        for (f=0; f<SIZE; f++)
+        {
+            bool field_covers;
+            if (!layout_meets(layout, rule, f, lo[f], hi[f], &field_covers))
+                break;
+            covers &= field_covers;
+        }
+        if (f < SIZE)
+            continue;
+        r->stack[own+n++] = rule;
+        covered = covers;
+        if (layout->va[rule] == layout->action)
+            continue;
+        for (f=0; f<SIZE; f++)
+        {
+            if (!disagree || layout->lo[f][rule] < dlo[f]) dlo[f] = layout->lo[f][rule];
+            if (!disagree || layout->hi[f][rule] > dhi[f]) dhi[f] = layout->hi[f][rule];
+        }
+        disagree = true;
+    }
+
+    // no candidate of the box can hit a disagreeing rule first
+    if (!disagree)
+        return false;
+
+    // the first rule of the box covers it and disagrees, its first candidate is a witness
+    if (n == 1 && covered)
+    {
+        for (uint32_t f=0; f<SIZE; f++) r->witness[f] = lo[f];
+        r->found = true;
+        return true;
+    }
+
+    /* a witness lies within a disagreeing rule, so the box is clipped to their hull */
+    uint32_t ca[SIZE], cb[SIZE];
+    uint64_t volume = 1;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        ca[f] = find_endpoint(r, f, a[f], b[f], dlo[f]);
+        cb[f] = (dhi[f] == UINT32_MAX) ? b[f] : find_endpoint(r, f, ca[f], b[f], dhi[f]+1);
+        if (ca[f] == cb[f]) // no candidate of the box lies within the hull
+            return false;
+        if (volume <= REFINE_LEAF) // stays small enough not to overflow
+            volume *= cb[f] - ca[f];
+    }
+
+    r->top = own + n;
+    bool over;
+    if (volume <= REFINE_LEAF)
+    {
+        enumerate(r, ca, cb, &r->stack[own], n);
+        over = r->found;
+    }
+    else
+    {   /* split along the first field with more than one end-point, lower half first */
+        uint32_t f = 0;
+        while (cb[f] - ca[f] == 1) f++;
+        uint32_t mid = ca[f] + (cb[f]-ca[f])/2, end = cb[f];
+        cb[f] = mid;
+        over = refine_box(r, ca, cb, own, n);
+        cb[f] = end;
+        if (!over)
+        {
+            ca[f] = mid;
+            over = refine_box(r, ca, cb, own, n);
+        }
+    }
+    r->top = own;
+    return over;
+}
+
+// branch-and-bound search of the cartesian product
+int refine_search(const struct layout *layout, const uint32_t *set, const uint32_t *indices,
+                  const uint32_t *prefix, uint32_t depth,
+                  bool (*stop)(void *arg), void *arg, uint32_t *witness)
+{
+    uint32_t a[SIZE], b[SIZE];
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        if (indices[f] == 0)
+            return 0;
+        a[f] = (f < depth) ? prefix[f] : 0;
+        b[f] = (f < depth) ? prefix[f]+1 : indices[f];
+    }
+
+    /* the root box starts from every rule of the layout */
+    struct refine r = {layout, set};
+    r.points = layout_points(layout);
+    r.stop = stop;
+    r.arg = arg;
+    if (reserve(&r, layout->count))
+    {
+        for (uint32_t i=0; i<layout->count; i++) r.stack[i] = i;
+        r.top = layout->count;
+        refine_box(&r, a, b, 0, layout->count);
+    }
+    else
+        r.failed = true;
+    if (r.found)
+        memcpy(witness, r.witness, sizeof(r.witness));
+    free(r.stack);
+    return (r.failed) ? -1 : r.found;
+}
@@ -0,0 +1,44 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the branch-and-bound component of the project
+ *   instead of testing every candidate of the cartesian product the
+ *   box of candidates is split in two along its end-points, boxes
+ *   which can not hold a witness are dropped without being enumerated
+ */
+
+#ifndef IPTABLES_VERIFICATION_REFINE_H
+#define IPTABLES_VERIFICATION_REFINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "algorithm.h"
+#include "layout.h"
+
+/** boxes holding this many candidates (or fewer) are enumerated rather than split */
+#define REFINE_LEAF ((uint64_t) 16)
+
+/**
+ * tests the cartesian product of the end-points and returns the same
+ * witness as test_candidates, boxes of candidates are pruned when no
+ * disagreeing rule intersects them, or when an agreeing rule covers
+ * them before any disagreeing rule does
+ * only the candidates whose leading fields equal the given prefix are tested
+ *
+ * @param layout  rules the candidates are compared to, in priority order
+ * @param set     set (as an array SIZE*layout_points(layout)) of unique possible endpoints
+ * @param indices the number of endpoints for each field (an array of SIZE)
+ * @param prefix  end-point positions of the leading fields
+ * @param depth   number of leading fields given in prefix (0 to test every candidate)
+ * @param stop    polled while searching, the search is abandoned once it returns true (may be NULL)
+ * @param arg     argument passed to stop
+ * @param witness array of SIZE elements, filled with the witness if one is found
+ * @return 1 if a witness was found, 0 if not, -1 if memory could not be allocated
+ */
+int refine_search(const struct layout *layout, const uint32_t *set, const uint32_t *indices,
+                  const uint32_t *prefix, uint32_t depth,
+                  bool (*stop)(void *arg), void *arg, uint32_t *witness);
+
+#endif //IPTABLES_VERIFICATION_REFINE_H
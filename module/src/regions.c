@@ -0,0 +1,339 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of the violation enumeration
+ *   the slice of each disagreeing rule (every rule before it which meets
+ *   its box, agreeing or not) is searched by splitting the box of the
+ *   rule along the end-points of the first slice rule which meets but
+ *   does not cover it, until each box is covered by a slice rule (and
+ *   dropped) or by the disagreeing rule alone (and reported), the boxes
+ *   still to be split are kept on a stack so a search can stop after any
+ *   region and resume later
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "regions.h"
+
+/** slice rules are found through sorted bounds once this many rules per rule of the projection have been scanned */
+#define REGIONS_SCAN_MAX ((uint64_t) 16)
+
+/** a box still to be split, with the slice rules which may meet it */
+struct box
+{
+    uint32_t lo[SIZE], hi[SIZE];
+    size_t list;  // position of the rules of its parent on the rule stack
+    uint32_t len; // number of those rules
+};
+
+struct regions
+{
+    struct layout *layout;       // rules projected over the property
+    struct bounds *bounds;       // sorted bounds of the projection, NULL while slices are formed by scanning
+    uint64_t scanned;            // rules scanned to form slices since the projection was laid out
+    uint64_t *marks;             // rules of a slice found through the bounds, to visit them in order
+    uint32_t *near;              // positions returned by bounds_query
+    uint32_t d;                  // position of the disagreeing rule of the slice being searched
+    uint32_t *rules;             // rule lists of the boxes on the stack
+    size_t top, rules_max;       // used and allocated size of the rule lists
+    struct box *boxes;           // boxes still to be split, the last one is split first
+    size_t boxes_n, boxes_max;   // used and allocated size of the boxes
+    struct region held;          // last region found, reported once the next one does not extend it
+    bool holding;                // true if held is waiting to be reported
+};
+
+// make room for n more rules on the rule stack, false if memory could not be allocated
+static bool reserve_rules(struct regions *r, size_t n)
+{
+    if (r->top + n <= r->rules_max)
+        return true;
+    size_t max = (r->rules_max) ? r->rules_max : 64;
+    while (max < r->top + n) max *= 2;
+    uint32_t *tmp = realloc(r->rules, sizeof(*tmp)*max);
+    if (tmp == NULL)
+        return false;
+    r->rules = tmp;
+    r->rules_max = max;
+    return true;
+}
+
+// push a box to be split, false if memory could not be allocated
+static bool push_box(struct regions *r, const uint32_t *lo, const uint32_t *hi, size_t list, uint32_t len)
+{
+    if (r->boxes_n == r->boxes_max)
+    {
+        size_t max = (r->boxes_max) ? 2*r->boxes_max : 16;
+        struct box *tmp = realloc(r->boxes, sizeof(*tmp)*max);
+        if (tmp == NULL)
+            return false;
+        r->boxes = tmp;
+        r->boxes_max = max;
+    }
+    struct box *box = &r->boxes[r->boxes_n++];
+    memcpy(box->lo, lo, sizeof(box->lo));
+    memcpy(box->hi, hi, sizeof(box->hi));
+    box->list = list;
+    box->len = len;
+    return true;
+}
+
+// true if a rule meets a box, covers is set if it holds every packet of the box
+static bool meets(const struct layout *layout, uint32_t rule, const uint32_t *lo, const uint32_t *hi, bool *covers)
+{
+    *covers = true;
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        bool field_covers;
+        if (!layout_meets(layout, rule, f, lo[f], hi[f], &field_covers))
+            return false;
+        *covers &= field_covers;
+    }
+    return true;
+}
+
+/* find a value of field f, above lo and at most hi, at which a rule starts or stops
+ * holding packets (an end-point of the rule), false if there is none */
+static bool split_value(const struct layout *layout, uint32_t rule, uint32_t f, uint32_t lo, uint32_t hi,
+                        uint32_t *value)
+{
+    uint32_t ranges = 1;
+    const uint32_t *pairs = NULL;
+    if (layout->record[rule] != 0)
+        pairs = layout_ranges(layout, rule, f, &ranges);
+    for (uint32_t i=0; i<ranges; i++)
+    {
+        uint32_t l = (pairs) ? pairs[2*i] : layout->lo[f][rule];
+        uint32_t h = (pairs) ? pairs[2*i+1] : layout->hi[f][rule];
+        if (l > lo && l <= hi)
+        {
+            *value = l;
+            return true;
+        }
+        if (h >= lo && h < hi)
+        {
+            *value = h + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+// split a box in two at an end-point of a rule meeting but not covering it, the lower half is split first
+static bool split_box(struct regions *r, uint32_t rule, const uint32_t *lo, const uint32_t *hi, size_t list, uint32_t len)
+{
+    uint32_t f = 0, value = 0;
+    while (f < SIZE && !split_value(r->layout, rule, f, lo[f], hi[f], &value)) f++;
+    if (f == SIZE) // the rule covers the box after all
+        return true;
+    uint32_t upper[SIZE], lower[SIZE];
+    memcpy(upper, lo, sizeof(upper));
+    memcpy(lower, hi, sizeof(lower));
+    upper[f] = value;
+    lower[f] = value - 1;
+    return push_box(r, upper, hi, list, len) && push_box(r, lo, lower, list, len);
+}
+
+// true if two regions of the same rule form a box together, which is then held by a
+static bool merge(struct region *a, const struct region *b)
+{
+    if (a->rule != b->rule)
+        return false;
+    uint32_t f = SIZE;
+    for (uint32_t k=0; k<SIZE; k++)
+    {
+        if (a->lo[k] == b->lo[k] && a->hi[k] == b->hi[k])
+            continue;
+        if (f != SIZE) // they differ along two fields
+            return false;
+        f = k;
+    }
+    if (f == SIZE) // the same box
+        return true;
+    if (a->hi[f] != UINT32_MAX && a->hi[f] + 1 == b->lo[f])
+        a->hi[f] = b->hi[f];
+    else if (b->hi[f] != UINT32_MAX && b->hi[f] + 1 == a->lo[f])
+        a->lo[f] = b->lo[f];
+    else
+        return false;
+    return true;
+}
+
+/* form the slice of the disagreeing rule at position d: every rule before it which meets
+ * its box, in rule order, and push its box, false if memory could not be allocated */
+static bool open_slice(struct regions *r, uint32_t d)
+{
+    const struct layout *layout = r->layout;
+    uint32_t lo[SIZE], hi[SIZE];
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        lo[f] = layout->lo[f][d];
+        hi[f] = layout->hi[f][d];
+    }
+
+    if (r->bounds == NULL && r->scanned >= REGIONS_SCAN_MAX*layout->count)
+    {
+        r->bounds = bounds_build(layout);
+        if (r->bounds == NULL)
+            return false;
+    }
+    uint32_t near_n = (r->bounds != NULL) ? bounds_query(r->bounds, lo, hi, d, r->near) : NO_RULE;
+
+    r->top = 0;
+    if (!reserve_rules(r, d))
+        return false;
+    uint32_t n = 0;
+    bool covers;
+    if (near_n == NO_RULE)
+    {
+        r->scanned += d;
+        for (uint32_t i=0; i<d; i++)
+        {
+            if (meets(layout, i, lo, hi, &covers))
+                r->rules[n++] = i;
+        }
+    }
+    else
+    {   /* restore rule order */
+        uint32_t words = (d+63)/64;
+        memset(r->marks, 0, sizeof(*r->marks)*words);
+        for (uint32_t i=0; i<near_n; i++)
+            r->marks[r->near[i] >> 6] |= (uint64_t)1 << (r->near[i] & 63);
+        for (uint32_t w=0; w<words; w++)
+        {
+            for (uint64_t bits = r->marks[w]; bits; bits &= bits-1)
+            {
+                uint32_t i = w*64 + (uint32_t)__builtin_ctzll(bits);
+                if (meets(layout, i, lo, hi, &covers))
+                    r->rules[n++] = i;
+            }
+        }
+    }
+    r->top = n;
+    return push_box(r, lo, hi, 0, n);
+}
+
+// decide the box on top of the stack, 1 if it is a region (filled in), 0 if not, -1 if memory could not be allocated
+static int decide_box(struct regions *r, struct region *region)
+{
+    const struct layout *layout = r->layout;
+    struct box box = r->boxes[--r->boxes_n];
+    uint32_t d = r->d;
+    bool inside, covers, covered = false;
+
+    // the packets of the box outside of the disagreeing rule hit it in another slice, if at all
+    if (!meets(layout, d, box.lo, box.hi, &inside))
+        return 0;
+
+    /* keep the slice rules which meet the box, up to the first which covers it */
+    r->top = box.list + box.len;
+    if (!reserve_rules(r, box.len))
+        return -1;
+    size_t own = r->top;
+    uint32_t n = 0;
+    for (uint32_t i=0; i<box.len && !covered; i++)
+    {
+        uint32_t rule = r->rules[box.list + i];
+        if (meets(layout, rule, box.lo, box.hi, &covers))
+        {
+            r->rules[own + n++] = rule;
+            covered = covers;
+        }
+    }
+    r->top = own + n;
+
+    // every packet of the box hits the first of them
+    if (n == 1 && covered)
+        return 0;
+
+    // no earlier rule meets the box, its packets within the disagreeing rule form a region
+    if (n == 0 && inside)
+    {
+        memcpy(region->lo, box.lo, sizeof(region->lo));
+        memcpy(region->hi, box.hi, sizeof(region->hi));
+        region->rule = layout->id[d];
+        return 1;
+    }
+
+    /* the first rule meeting the box decides part of it, the box is split along its end-points */
+    uint32_t rule = (n != 0) ? r->rules[own] : d;
+    return split_box(r, rule, box.lo, box.hi, own, n) ? 0 : -1;
+}
+
+// project the rules over the property and place a cursor before the first region
+struct regions* regions_open(const struct layout *rules, const struct bounds *bounds,
+                             const uint32_t *prop_lo, const uint32_t *prop_hi, uint32_t action)
+{
+    struct regions *r = calloc(1, sizeof(*r));
+    if (r == NULL)
+        return NULL;
+    r->layout = layout_alloc(rules->count, rules->values_n);
+    r->marks = malloc(sizeof(*r->marks)*((rules->count+63)/64) + 1);
+    r->near = malloc(sizeof(*r->near)*rules->count + 1);
+    if (r->layout == NULL || r->marks == NULL || r->near == NULL)
+    {
+        regions_free(r);
+        return NULL;
+    }
+    layout_project(rules, bounds, r->marks, prop_lo, prop_hi, action, r->layout);
+    r->d = UINT32_MAX; // no slice opened yet
+    return r;
+}
+
+// find the next violating region
+int regions_next(struct regions *r, struct region *region)
+{
+    const struct layout *layout = r->layout;
+    struct region found;
+    for (;;)
+    {
+        while (r->boxes_n != 0)
+        {
+            int decided = decide_box(r, &found);
+            if (decided < 0)
+                return -1;
+            if (decided == 0 || (r->holding && merge(&r->held, &found)))
+                continue;
+
+            /* a region which does not extend the one held replaces it */
+            bool report = r->holding;
+            if (report)
+                *region = r->held;
+            r->held = found;
+            r->holding = true;
+            if (report)
+                return 1;
+        }
+
+        /* every box of the slice has been decided, move on to the next disagreeing rule */
+        uint32_t d = r->d + 1;
+        while (d < layout->count && layout->va[d] == layout->action) d++;
+        r->d = d;
+        if (d >= layout->count)
+        {
+            r->d = layout->count - 1; // stays past the last rule
+            if (!r->holding)
+                return 0;
+            *region = r->held;
+            r->holding = false;
+            return 1;
+        }
+        if (!open_slice(r, d))
+            return -1;
+    }
+}
+
+// release a cursor
+void regions_free(struct regions *regions)
+{
+    if (regions == NULL)
+        return;
+    layout_free(regions->layout);
+    bounds_free(regions->bounds);
+    free(regions->marks);
+    free(regions->near);
+    free(regions->rules);
+    free(regions->boxes);
+    free(regions);
+}
@@ -0,0 +1,69 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the violation enumeration component of the project
+ *   rather than the first witness, every packet of a property which first
+ *   hits a disagreeing rule is reported as a list of boxes, each tagged
+ *   with that rule, the boxes are found one at a time by a cursor which
+ *   resumes where the previous box was found
+ */
+
+#ifndef IPTABLES_VERIFICATION_REGIONS_H
+#define IPTABLES_VERIFICATION_REGIONS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "algorithm.h"
+#include "layout.h"
+
+/** a box of packets of a property which first hit the same disagreeing rule */
+struct region
+{
+    uint32_t lo[SIZE]; // lower bounds of the box
+    uint32_t hi[SIZE]; // upper bounds of the box
+    uint32_t rule;     // id of the disagreeing rule (see struct layout) the packets of the box hit first
+};
+
+/** cursor over the violating regions of a property */
+struct regions;
+
+/**
+ * projects rules over a property and places a cursor before its first
+ * violating region, the cursor keeps its own copy of the projection so
+ * the rules may change or be released while it is open
+ *
+ * regions come in the order of their rules, as the slices of the least
+ * witness algorithm do, so the witness found with slicing lies within
+ * the regions of the first rule reported, the regions of a rule do not
+ * overlap and together hold every packet of the property which first
+ * hits that rule
+ *
+ * @param rules   layout created by layout_build_rules (or reduce_rules)
+ * @param bounds  bounds created by bounds_build from rules (may be NULL to visit every rule)
+ * @param prop_lo lower bounds of the property (an array of SIZE)
+ * @param prop_hi upper bounds of the property (an array of SIZE)
+ * @param action  action value of the property
+ * @return the cursor, or NULL if memory could not be allocated
+ */
+struct regions* regions_open(const struct layout *rules, const struct bounds *bounds,
+                             const uint32_t *prop_lo, const uint32_t *prop_hi, uint32_t action);
+
+/**
+ * finds the next violating region, adjacent boxes of a rule which together
+ * form a box are merged before they are reported
+ * @param regions cursor created by regions_open
+ * @param region  filled with the region found
+ * @return 1 if a region was found, 0 once every region has been found,
+ *         -1 if memory could not be allocated (the cursor may not be used again)
+ */
+int regions_next(struct regions *regions, struct region *region);
+
+/**
+ * releases a cursor
+ * @param regions cursor created by regions_open (may be NULL)
+ */
+void regions_free(struct regions *regions);
+
+#endif //IPTABLES_VERIFICATION_REGIONS_H
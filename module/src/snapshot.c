@@ -0,0 +1,358 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   implementation of the snapshot file format
+ *   a header is followed by the layout columns, the records and the sorted
+ *   bounds, each section starting on a SNAPSHOT_ALIGN byte boundary, values
+ *   are stored in the byte order of the machine which wrote the snapshot
+ *   the checksum is an FNV-1a hash of the 32-bit words of the whole file,
+ *   taken while the checksum field of the header is zero
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+/** alignment of each section of a snapshot, enough for the vector kernel */
+#define SNAPSHOT_ALIGN ((uint64_t) 64)
+
+/** flag of a snapshot which holds sorted bounds */
+#define SNAPSHOT_BOUNDS ((uint32_t) 1)
+
+/** written as is, so that it reads differently on a machine of another byte order */
+#define SNAPSHOT_ORDER ((uint32_t) 0x01020304)
+
+#define FNV_OFFSET ((uint64_t) 0xcbf29ce484222325)
+#define FNV_PRIME ((uint64_t) 0x100000001b3)
+
+static const char magic[8] = {'F', 'W', 'S', 'N', 'A', 'P', '\r', '\n'};
+
+/** first SNAPSHOT_ALIGN bytes of a snapshot */
+struct header
+{
+    char magic[8];     // identifies the file as a snapshot
+    uint32_t version;  // SNAPSHOT_VERSION
+    uint32_t order;    // SNAPSHOT_ORDER
+    uint32_t fields;   // SIZE
+    uint32_t count;    // number of rules
+    uint32_t capacity; // length of each column
+    uint32_t values_n; // size of the records
+    uint32_t extra;    // ranges of the multi-valued rules beyond one per field
+    uint32_t policy;   // default policy of the firewall
+    uint32_t flags;    // SNAPSHOT_BOUNDS
+    uint32_t reserved; // 0
+    uint64_t size;     // size of the file
+    uint64_t checksum; // hash of the file
+};
+
+_Static_assert(sizeof(struct header) == SNAPSHOT_ALIGN, "snapshot header must fill one section");
+
+/** snapshot being written, or only hashed while file is NULL */
+struct writer
+{
+    FILE *file;
+    uint64_t hash;
+    uint64_t size; // bytes emitted
+};
+
+// round a size up to the next section boundary
+static uint64_t align(uint64_t size)
+{
+    return (size + SNAPSHOT_ALIGN-1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+}
+
+// hash 32-bit words
+static uint64_t hash_words(uint64_t hash, const uint32_t *words, uint64_t n)
+{
+    for (uint64_t i=0; i<n; i++)
+        hash = (hash ^ words[i]) * FNV_PRIME;
+    return hash;
+}
+
+// hash and write bytes, a multiple of 4
+static void emit(struct writer *w, const void *data, uint64_t bytes)
+{
+    w->hash = hash_words(w->hash, data, bytes/4);
+    if (w->file != NULL && bytes)
+        fwrite(data, 1, bytes, w->file);
+    w->size += bytes;
+}
+
+// pad the section being written up to the next boundary
+static void pad(struct writer *w)
+{
+    static const uint32_t zeros[SNAPSHOT_ALIGN/4];
+    emit(w, zeros, align(w->size) - w->size);
+}
+
+// emit the first n values of a column of capacity values
+static void emit_column(struct writer *w, const uint32_t *column, uint32_t n, uint32_t capacity)
+{
+    static const uint32_t zeros[LAYOUT_LANES];
+    emit(w, column, sizeof(*column)*n);
+    emit(w, zeros, sizeof(*column)*(capacity - n));
+}
+
+// emit every section of a snapshot
+static void emit_snapshot(struct writer *w, const struct header *header,
+                          const struct layout *rules, const struct bounds *bounds)
+{
+    uint32_t n = header->count, capacity = header->capacity;
+    emit(w, header, sizeof(*header));
+    for (uint32_t f=0; f<SIZE; f++)
+    {
+        emit_column(w, rules->lo[f], n, capacity);
+        emit_column(w, rules->hi[f], n, capacity);
+    }
+    emit_column(w, rules->va, n, capacity);
+    emit_column(w, rules->id, n, capacity);
+    emit_column(w, rules->record, n, capacity);
+    pad(w);
+    emit(w, rules->values, sizeof(*rules->values)*header->values_n);
+    pad(w);
+
+    /* each array of the bounds of a field gets a section of its own */
+    uint32_t blocks = (n+BOUNDS_BLOCK-1)/BOUNDS_BLOCK;
+    for (uint32_t k=0; k<SIZE && bounds != NULL; k++)
+    {
+        emit(w, bounds->lo[k], sizeof(*bounds->lo[k])*n);
+        pad(w);
+        emit(w, bounds->ends[k], sizeof(*bounds->ends[k])*n);
+        pad(w);
+        emit(w, bounds->hi[k], sizeof(*bounds->hi[k])*n);
+        pad(w);
+        emit(w, bounds->reach[k], sizeof(*bounds->reach[k])*blocks);
+        pad(w);
+    }
+}
+
+// size of a snapshot, and the offsets of its records and bounds
+static uint64_t snapshot_size(const struct header *header, uint64_t *values, uint64_t *bounds)
+{
+    uint64_t n = header->count, blocks = (n+BOUNDS_BLOCK-1)/BOUNDS_BLOCK;
+    uint64_t size = SNAPSHOT_ALIGN + align(sizeof(uint32_t)*LAYOUT_COLUMNS*header->capacity);
+    *values = size;
+    size += align(sizeof(uint32_t)*header->values_n);
+    *bounds = size;
+    if (header->flags & SNAPSHOT_BOUNDS)
+        size += SIZE*(2*align(sizeof(uint64_t)*n) + align(sizeof(uint32_t)*n) + align(sizeof(uint32_t)*blocks));
+    return size;
+}
+
+// write a firewall to a snapshot
+int snapshot_write(const char *path, const struct layout *rules, const struct bounds *bounds, uint32_t policy)
+{
+    struct header header = {{0}, SNAPSHOT_VERSION, SNAPSHOT_ORDER, SIZE, rules->count, 0,
+                            rules->values_n, rules->extra, policy, (bounds != NULL) ? SNAPSHOT_BOUNDS : 0, 0, 0, 0};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.capacity = (rules->count + LAYOUT_LANES-1) / LAYOUT_LANES * LAYOUT_LANES;
+    if (header.capacity == 0)
+        header.capacity = LAYOUT_LANES;
+    uint64_t values, offset;
+    header.size = snapshot_size(&header, &values, &offset);
+
+    /* hash the snapshot before writing it, the checksum is part of the header */
+    struct writer w = {NULL, FNV_OFFSET, 0};
+    emit_snapshot(&w, &header, rules, bounds);
+    header.checksum = w.hash;
+
+    /* write beside the snapshot and rename it over, so that mappings of the old snapshot stay valid */
+    size_t length = strlen(path);
+    char *tmp = malloc(length + 5);
+    if (tmp == NULL)
+        return SNAPSHOT_ERRNO;
+    memcpy(tmp, path, length);
+    memcpy(tmp + length, ".tmp", 5);
+    w = (struct writer){fopen(tmp, "wb"), FNV_OFFSET, 0};
+    if (w.file == NULL)
+    {
+        free(tmp);
+        return SNAPSHOT_ERRNO;
+    }
+    emit_snapshot(&w, &header, rules, bounds);
+    bool ok = !ferror(w.file);
+    ok = (fclose(w.file) == 0) && ok;
+    ok = ok && rename(tmp, path) == 0;
+    if (!ok)
+    {
+        int err = errno;
+        remove(tmp);
+        errno = err;
+    }
+    free(tmp);
+    return (ok) ? SNAPSHOT_OK : SNAPSHOT_ERRNO;
+}
+
+// check that the records and the bounds only refer to what the snapshot holds
+static bool check_contents(const struct snapshot *snapshot)
+{
+    const struct layout *rules = &snapshot->rules;
+    uint64_t extra = 0;
+    for (uint32_t r=0; r<rules->count; r++)
+    {
+        if (rules->record[r] == 0)
+            continue;
+        uint64_t at = (uint64_t)rules->record[r] - 1, size = SIZE, ranges = 0;
+        if (at + SIZE > rules->values_n)
+            return false;
+        for (uint32_t f=0; f<SIZE; f++)
+        {
+            uint32_t n = rules->values[at+f];
+            if (n == 0 || n > FIELD_RANGES)
+                return false;
+            size += 2*n;
+            ranges += n;
+        }
+        if (at + size > rules->values_n)
+            return false;
+        extra += ranges - SIZE;
+    }
+    if (extra != rules->extra)
+        return false;
+
+    for (uint32_t k=0; k<SIZE && snapshot->indexed; k++)
+    {
+        for (uint32_t i=0; i<rules->count; i++)
+        {
+            if ((uint32_t)snapshot->bounds.lo[k][i] >= rules->count
+                || (uint32_t)snapshot->bounds.ends[k][i] >= rules->count)
+                return false;
+        }
+    }
+    return true;
+}
+
+// check a mapped snapshot and point the layout & bounds into it
+static int attach(struct snapshot *snapshot)
+{
+    uint8_t *base = snapshot->map;
+    struct header header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0
+        || header.order != SNAPSHOT_ORDER || header.fields != SIZE)
+        return SNAPSHOT_FORMAT;
+    if (header.version != SNAPSHOT_VERSION)
+        return SNAPSHOT_OUTDATED;
+
+    uint64_t values, offset;
+    if (header.capacity % LAYOUT_LANES != 0 || header.capacity < header.count || header.capacity == 0
+        || (header.flags & ~SNAPSHOT_BOUNDS) != 0 || header.size != snapshot->size
+        || snapshot_size(&header, &values, &offset) != snapshot->size)
+        return SNAPSHOT_CORRUPT;
+
+    /* hash the header as it was written, then the rest of the file */
+    uint64_t checksum = header.checksum;
+    header.checksum = 0;
+    uint64_t hash = hash_words(FNV_OFFSET, (const uint32_t *)&header, sizeof(header)/4);
+    hash = hash_words(hash, (const uint32_t *)(base + SNAPSHOT_ALIGN), (snapshot->size - SNAPSHOT_ALIGN)/4);
+    if (hash != checksum)
+        return SNAPSHOT_CORRUPT;
+
+    /* the rules of the snapshot cover every packet, as for layout_build_rules */
+    struct layout *rules = &snapshot->rules;
+    layout_wrap(rules, (uint32_t *)(base + SNAPSHOT_ALIGN), header.capacity);
+    rules->count = header.count;
+    rules->values = (uint32_t *)(base + values);
+    rules->values_n = rules->values_max = header.values_n;
+    rules->extra = header.extra;
+    for (uint32_t k=0; k<SIZE; k++)
+    {
+        rules->prop_lo[k] = 0;
+        rules->prop_hi[k] = UINT32_MAX;
+    }
+    rules->action = 0;
+    snapshot->policy = header.policy;
+
+    snapshot->indexed = (header.flags & SNAPSHOT_BOUNDS) != 0;
+    snapshot->bounds.count = header.count;
+    uint64_t n = header.count, blocks = (n+BOUNDS_BLOCK-1)/BOUNDS_BLOCK;
+    for (uint32_t k=0; k<SIZE && snapshot->indexed; k++)
+    {
+        snapshot->bounds.lo[k] = (uint64_t *)(base + offset);
+        offset += align(sizeof(uint64_t)*n);
+        snapshot->bounds.ends[k] = (uint64_t *)(base + offset);
+        offset += align(sizeof(uint64_t)*n);
+        snapshot->bounds.hi[k] = (uint32_t *)(base + offset);
+        offset += align(sizeof(uint32_t)*n);
+        snapshot->bounds.reach[k] = (uint32_t *)(base + offset);
+        offset += align(sizeof(uint32_t)*blocks);
+    }
+    return check_contents(snapshot) ? SNAPSHOT_OK : SNAPSHOT_CORRUPT;
+}
+
+// map a snapshot into memory
+int snapshot_open(const char *path, struct snapshot *snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return SNAPSHOT_ERRNO;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return SNAPSHOT_ERRNO;
+    }
+    if (st.st_size < (off_t)SNAPSHOT_ALIGN || (uint64_t)st.st_size > SIZE_MAX)
+    {
+        close(fd);
+        return SNAPSHOT_FORMAT;
+    }
+
+    /* the rules are only read, pages are loaded as the search touches them */
+    snapshot->size = (size_t) st.st_size;
+    snapshot->map = mmap(NULL, snapshot->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int err = errno;
+    close(fd);
+    if (snapshot->map == MAP_FAILED)
+    {
+        snapshot->map = NULL;
+        errno = err;
+        return SNAPSHOT_ERRNO;
+    }
+
+    int status = attach(snapshot);
+    if (status != SNAPSHOT_OK)
+        snapshot_close(snapshot);
+    return status;
+}
+
+// describe a snapshot status
+const char* snapshot_strerror(int status)
+{
+    switch (status)
+    {
+        case SNAPSHOT_OK:
+            return "success";
+        case SNAPSHOT_ERRNO:
+            return strerror(errno);
+        case SNAPSHOT_FORMAT:
+            return "not a snapshot of this build";
+        case SNAPSHOT_OUTDATED:
+            return "unsupported snapshot version";
+        case SNAPSHOT_CORRUPT:
+            return "snapshot is corrupt";
+        default:
+            return "unknown snapshot status";
+    }
+}
+
+// unmap a snapshot
+void snapshot_close(struct snapshot *snapshot)
+{
+    if (snapshot->map != NULL)
+        munmap(snapshot->map, snapshot->size);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
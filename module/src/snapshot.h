@@ -0,0 +1,79 @@
+/**
+ * date: 2026-10-16
+ * contributors(s):
+ *   agent, agent@local
+ * description:
+ *   header file for the snapshot component of the project
+ *   a snapshot is a compiled firewall written to a file once: the columns
+ *   of its layout, the records of its multi-valued rules, its default policy
+ *   and optionally its sorted bounds, each section aligned so that the file
+ *   can be mapped into memory and used in place without copying any rule
+ */
+
+#ifndef IPTABLES_VERIFICATION_SNAPSHOT_H
+#define IPTABLES_VERIFICATION_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "layout.h"
+
+/** format version written to snapshots, snapshots of other versions are refused */
+#define SNAPSHOT_VERSION ((uint32_t) 1)
+
+/** policy value of a snapshot whose firewall has no known default policy */
+#define SNAPSHOT_NO_POLICY UINT32_MAX
+
+/** outcome of reading or writing a snapshot */
+enum snapshot_status
+{
+    SNAPSHOT_OK = 0,       // success
+    SNAPSHOT_ERRNO = 1,    // the file could not be read or written, see errno
+    SNAPSHOT_FORMAT = 2,   // the file is not a snapshot, or was written for another build
+    SNAPSHOT_OUTDATED = 3, // the snapshot was written in another format version
+    SNAPSHOT_CORRUPT = 4   // the checksum or the contents of the snapshot are wrong
+};
+
+/** a snapshot mapped into memory */
+struct snapshot
+{
+    struct layout rules;  // rules of the firewall, the columns and records point into the mapping
+    struct bounds bounds; // sorted bounds of the rules, pointing into the mapping
+    bool indexed;         // true if the snapshot holds sorted bounds
+    uint32_t policy;      // default policy of the firewall, SNAPSHOT_NO_POLICY if unknown
+    void *map;            // mapping of the file
+    size_t size;          // size of the mapping
+};
+
+/**
+ * writes a firewall to a snapshot, replacing the file if it exists
+ * @param path   path of the snapshot
+ * @param rules  layout created by layout_build_rules
+ * @param bounds bounds created by bounds_build from rules, NULL to leave them out
+ * @param policy default policy of the firewall, SNAPSHOT_NO_POLICY if unknown
+ * @return SNAPSHOT_OK, or SNAPSHOT_ERRNO if the file could not be written
+ */
+int snapshot_write(const char *path, const struct layout *rules, const struct bounds *bounds, uint32_t policy);
+
+/**
+ * maps a snapshot into memory after checking its format, version and checksum
+ * @param path     path of the snapshot
+ * @param snapshot filled with the mapped firewall, release it with snapshot_close
+ * @return SNAPSHOT_OK, or the reason the snapshot can not be used
+ */
+int snapshot_open(const char *path, struct snapshot *snapshot);
+
+/**
+ * describes the outcome of reading or writing a snapshot
+ * @param status value returned by snapshot_write or snapshot_open
+ * @return a static string
+ */
+const char* snapshot_strerror(int status);
+
+/**
+ * unmaps a snapshot
+ * @param snapshot snapshot filled by snapshot_open
+ */
+void snapshot_close(struct snapshot *snapshot);
+
+#endif //IPTABLES_VERIFICATION_SNAPSHOT_H
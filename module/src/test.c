@@ -9,11 +9,52 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "algorithm.h"
+#include "fdd.h"
+#include "layout.h"
+#include "parse.h"
+#include "pool.h"
+#include "reduce.h"
+#include "snapshot.h"
+
+/** rules parsed by test 4, slot 0 is left for the property */
+static uint32_t parsed_lo[5*8], parsed_hi[5*8], parsed_va[8], parsed = 1;
+static uint32_t parsed_record[8], parsed_values[256], values_n = 0;
+
+static bool add_rule(void *arg, const uint32_t *lo, const uint32_t *hi, const uint32_t *record, uint32_t va)
+{
+    if (parsed == 8)
+        return false;
+    memcpy(&parsed_lo[parsed*5], lo, sizeof(*lo)*5);
+    memcpy(&parsed_hi[parsed*5], hi, sizeof(*hi)*5);
+    parsed_record[parsed] = 0;
+    if (record != NULL)
+    {   // port lists are kept as ranges of a single rule
+        uint32_t size = 5;
+        for (int f=0; f<5; f++) size += 2*record[f];
+        if (values_n + size > 256)
+            return false;
+        memcpy(&parsed_values[values_n], record, sizeof(*record)*size);
+        parsed_record[parsed] = values_n + 1;
+        values_n += size;
+    }
+    parsed_va[parsed++] = va;
+    return true;
+}
+
+static bool skip_rule(void *arg, uint32_t line, const char *reason)
+{
+    printf("test 4) line %u skipped: %s\n", line, reason);
+    return true;
+}
 
 int main(int argc, char* argv[])
 {
-    uint32_t lo[5*6], hi[5*6], va[6], *witness;
+    uint32_t lo[5*7], hi[5*7], va[7], witness[5];
+    int result;
+    struct options opt = {true, ENGINE_SCAN, pool_create(4)};
+    const char *engines[] = {"scan", "index", "bitset", "refine"};
 
     /* test 1 property */
     lo[0] = 23; lo[1] = 73; lo[2] = 0; lo[3] = 0; lo[4] = 0;
@@ -31,19 +72,134 @@ int main(int argc, char* argv[])
     lo[25] = 1;   lo[26] = 1;   lo[27] = 0; lo[28] = 0; lo[29] = 0; // rule 5
     hi[25] = 200; hi[26] = 200; hi[27] = 0; hi[28] = 0; hi[29] = 0; va[5] = 0; // ((1,200),(1,200)) -> 0
 
-    // find a witness
-    witness = find_witness(lo, hi, va, 6, true);
-    if (witness == NULL) printf("test 1) no witness found!\n");
-    else printf("test 1) witness (%u, %u, %u, %u, %u) found!\n",
-                witness[0], witness[1], witness[2], witness[3], witness[4]);
+    // find a witness with each engine
+    for (opt.engine=ENGINE_SCAN; opt.engine<=ENGINE_REFINE; opt.engine++)
+    {
+        result = find_witness(lo, hi, va, 6, NULL, witness, &opt);
+        if (result < 0) printf("test 1) [%s] out of memory!\n", engines[opt.engine]);
+        else if (!result) printf("test 1) [%s] no witness found!\n", engines[opt.engine]);
+        else printf("test 1) [%s] witness (%u, %u, %u, %u, %u) found!\n", engines[opt.engine],
+                    witness[0], witness[1], witness[2], witness[3], witness[4]);
+    }
 
     /* test 2 property */
     lo[0] = 33; lo[1] = 75; lo[2] = 0; lo[3] = 0; lo[4] = 0;
     hi[0] = 87; hi[1] = 79; hi[2] = 0; hi[3] = 0; hi[4] = 0; va[0] = 0; // ((33,87),(75,79)) -> 0
 
     // no witness should be found
-    witness = find_witness(lo, hi, va, 6, true);
-    if (witness == NULL) printf("test 2) no witness found!\n");
-    else printf("test 2) witness (%u, %u, %u, %u, %u) found!\n",
-                witness[0], witness[1], witness[2], witness[3], witness[4]);
+    for (opt.engine=ENGINE_SCAN; opt.engine<=ENGINE_REFINE; opt.engine++)
+    {
+        result = find_witness(lo, hi, va, 6, NULL, witness, &opt);
+        if (result < 0) printf("test 2) [%s] out of memory!\n", engines[opt.engine]);
+        else if (!result) printf("test 2) [%s] no witness found!\n", engines[opt.engine]);
+        else printf("test 2) [%s] witness (%u, %u, %u, %u, %u) found!\n", engines[opt.engine],
+                    witness[0], witness[1], witness[2], witness[3], witness[4]);
+    }
+
+    /* test 1 & test 2 properties verified together */
+    uint32_t prop_lo[5*2] = {23, 73, 0, 0, 0, 33, 75, 0, 0, 0};
+    uint32_t prop_hi[5*2] = {87, 177, 0, 0, 0, 87, 79, 0, 0, 0};
+    uint32_t prop_va[2] = {0, 0}, witnesses[5*2];
+    bool found[2];
+    opt.engine = ENGINE_SCAN;
+    if (find_witnesses(lo, hi, va, 6, NULL, prop_lo, prop_hi, prop_va, 2, witnesses, found, &opt) == 0)
+    {
+        for (int p=0; p<2; p++)
+        {
+            if (!found[p]) printf("test 3) [batch] property %d no witness found!\n", p+1);
+            else printf("test 3) [batch] property %d witness (%u, %u, %u, %u, %u) found!\n", p+1,
+                        witnesses[p*5], witnesses[p*5+1], witnesses[p*5+2], witnesses[p*5+3], witnesses[p*5+4]);
+        }
+    }
+
+    /* test 4 firewall parsed from iptables-save output */
+    const char *save = "*filter\n"
+                       ":INPUT DROP [0:0]\n"
+                       "-A INPUT -s 10.0.0.0/8 -p tcp -m tcp --dport 22 -j ACCEPT\n"
+                       "-A INPUT -p udp -m multiport --dports 53,123 -j ACCEPT\n"
+                       "-A INPUT -m state --state ESTABLISHED -j ACCEPT\n"
+                       "COMMIT\n";
+    struct parser parser;
+    parser_init(&parser, "INPUT", add_rule, skip_rule, NULL);
+    if (parser_buffer(&parser, save, strlen(save)) && parser.policy != PARSE_NO_POLICY)
+    {
+        uint32_t any_lo[SIZE] = ANY_LO, any_hi[SIZE] = ANY_HI;
+        add_rule(NULL, any_lo, any_hi, NULL, parser.policy);
+        uint32_t prop_lo4[5] = {0, 1, 0, 22, 6}, prop_hi4[5] = {UINT32_MAX, 65535, UINT32_MAX, 22, 6};
+        memcpy(parsed_lo, prop_lo4, sizeof(prop_lo4));
+        memcpy(parsed_hi, prop_hi4, sizeof(prop_hi4));
+        parsed_va[0] = 1; // ssh is accepted from everywhere
+        parsed_record[0] = 0;
+        struct ranges ranges = {parsed_record, parsed_values};
+        result = find_witness(parsed_lo, parsed_hi, parsed_va, parsed, &ranges, witness, &opt);
+        if (result < 0) printf("test 4) [%u rules] out of memory!\n", parsed-1);
+        else if (!result) printf("test 4) [%u rules] no witness found!\n", parsed-1);
+        else printf("test 4) [%u rules] witness (%u, %u, %u, %u, %u) found!\n", parsed-1,
+                    witness[0], witness[1], witness[2], witness[3], witness[4]);
+
+        /* test 5 the parsed firewall written to a snapshot and mapped back */
+        struct layout *rules = layout_build_rules(parsed_lo, parsed_hi, parsed_va, parsed, &ranges);
+        struct bounds *bounds = (rules != NULL) ? bounds_build(rules) : NULL;
+        struct snapshot snapshot;
+        int status = SNAPSHOT_ERRNO;
+        if (bounds != NULL && (status = snapshot_write("alg_test.snapshot", rules, bounds, parser.policy)) == SNAPSHOT_OK)
+            status = snapshot_open("alg_test.snapshot", &snapshot);
+        if (status != SNAPSHOT_OK)
+            printf("test 5) snapshot failed: %s\n", snapshot_strerror(status));
+        else
+        {
+            bool hit;
+            uint32_t wit[5];
+            if (find_witnesses_in(&snapshot.rules, &snapshot.bounds, prop_lo4, prop_hi4, &parsed_va[0], 1,
+                                  wit, &hit, &opt) == 0)
+            {
+                if (!hit) printf("test 5) [snapshot] no witness found!\n");
+                else printf("test 5) [snapshot] witness (%u, %u, %u, %u, %u) found!\n",
+                            wit[0], wit[1], wit[2], wit[3], wit[4]);
+            }
+            snapshot_close(&snapshot);
+        }
+        remove("alg_test.snapshot");
+        bounds_free(bounds);
+        layout_free(rules);
+    }
+
+    /* test 1 & test 2 properties verified against the reduced firewall, rule 6 is shadowed by rule 5 */
+    lo[30] = 50; lo[31] = 50; lo[32] = 0; lo[33] = 0; lo[34] = 0; // rule 6
+    hi[30] = 60; hi[31] = 60; hi[32] = 0; hi[33] = 0; hi[34] = 0; va[6] = 1; // ((50,60),(50,60)) -> 1
+    struct layout *toy = layout_build_rules(lo, hi, va, 7, NULL);
+    struct bounds *toy_bounds = (toy != NULL) ? bounds_build(toy) : NULL;
+    struct layout *reduced = (toy_bounds != NULL) ? reduce_rules(toy, toy_bounds, NULL) : NULL;
+    struct bounds *reduced_bounds = (reduced != NULL) ? bounds_build(reduced) : NULL;
+    if (reduced_bounds != NULL
+        && find_witnesses_in(reduced, reduced_bounds, prop_lo, prop_hi, prop_va, 2, witnesses, found, &opt) == 0)
+    {
+        for (int p=0; p<2; p++)
+        {
+            if (!found[p]) printf("test 6) [%u of %u rules] property %d no witness found!\n",
+                                  reduced->count, toy->count, p+1);
+            else printf("test 6) [%u of %u rules] property %d witness (%u, %u, %u, %u, %u) found!\n",
+                        reduced->count, toy->count, p+1, witnesses[p*5], witnesses[p*5+1],
+                        witnesses[p*5+2], witnesses[p*5+3], witnesses[p*5+4]);
+        }
+    }
+
+    /* test 7 test 1 & test 2 properties verified against a decision diagram of the reduced firewall,
+     * the witness is the least violating packet as found without slicing */
+    struct fdd *fdd = (reduced != NULL) ? fdd_build(reduced, FDD_LIMIT) : NULL;
+    if (fdd != NULL && fdd_witnesses(fdd, prop_lo, prop_hi, prop_va, 2, witnesses, found) == 0)
+    {
+        for (int p=0; p<2; p++)
+        {
+            if (!found[p]) printf("test 7) [%u nodes] property %d no witness found!\n", fdd_nodes(fdd), p+1);
+            else printf("test 7) [%u nodes] property %d witness (%u, %u, %u, %u, %u) found!\n", fdd_nodes(fdd), p+1,
+                        witnesses[p*5], witnesses[p*5+1], witnesses[p*5+2], witnesses[p*5+3], witnesses[p*5+4]);
+        }
+    }
+    fdd_free(fdd);
+    bounds_free(reduced_bounds);
+    layout_free(reduced);
+    bounds_free(toy_bounds);
+    layout_free(toy);
+    pool_free(opt.pool);
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #
 import firewall_verifier as fv
 import random as r
+from array import array
 from timeit import default_timer as timer
 
 # tweak-able parameters
@@ -14,11 +15,17 @@ trials = 100
 rules = 10**5
 max_rule_type = 2
 
+# candidate matching engines to compare during the trials
+engines = [('scan', fv.ENGINE_SCAN),
+           ('index', fv.ENGINE_INDEX),
+           ('bitset', fv.ENGINE_BITSET),
+           ('refine', fv.ENGINE_REFINE)]
+
 
 # randomly generate a 2-tuple, representing the range of the field
 def generate_tuple():
     lo = r.randint(1, 1 << 31)
-    hi = r.randint(lo, 1 << 32)
+    hi = r.randint(lo, (1 << 32) - 1)
     tup = (lo, hi)
     return tup
 
@@ -34,11 +41,15 @@ def generate_rule():
     return rule
 
 
-# generate and add rules to the firewall
+# generate rules and add them to the firewall in one call, as (count, 5, 2) bounds and count actions
 def generate_firewall(count):
+    bounds, actions = array('I'), array('I')
     for i in range(0, count):
         rule = generate_rule()
-        fv.add(rule)
+        for lo, hi in rule[:5]:
+            bounds.extend((lo, hi))
+        actions.append(rule[5])
+    fv.add_many(bounds, actions)
     return
 
 
@@ -67,36 +78,32 @@ def main():
     end = timer()
     print(end-start, "seconds")
 
-    # try random properties and compute an average
-    print("\n[trials]: ")
-    times = []
-    rates = {True: 0, False: 0}
-    for i in range(0, trials):
-        prop = generate_rule()
-        print("\t[", (i+1), "]:\t", end="")
-        start = timer()
-        suc = fv.verify(prop)
-        end = timer()
-        rates[suc] += 1
-        times.append(end-start)
-        print(times[i], "seconds")
-
-    # percentage of random properties which verified successfully
-    print("\n[rate]:\t", rates[True]/trials)
-
-    # find max time taken
-    time_max = 0
-    for time in times:
-        if time > time_max:
-            time_max = time
-    print("[max]:\t", time_max, "seconds")
-
-    # calculate average
-    avg = 0
-    for time in times:
-        avg += time
-    avg /= trials
-    print("[avg]:\t", avg, "seconds")
+    # try the same random properties with each engine and compute an average
+    props = [generate_rule() for i in range(0, trials)]
+    summary = []
+    for name, engine in engines:
+        fv.set_engine(engine)
+        print("\n[trials, " + name + "]: ")
+        times = []
+        rates = {True: 0, False: 0}
+        for i in range(0, trials):
+            print("\t[", (i+1), "]:\t", end="")
+            start = timer()
+            suc = fv.verify(props[i])
+            end = timer()
+            rates[suc] += 1
+            times.append(end-start)
+            print(times[i], "seconds")
+        summary.append((name, rates[True]/trials, max(times), sum(times)/trials))
+    fv.set_engine(fv.ENGINE_SCAN)
+
+    # percentage of random properties which verified successfully,
+    # and the max and average time taken by each engine
+    for name, rate, time_max, avg in summary:
+        print("\n[" + name + "]")
+        print("[rate]:\t", rate)
+        print("[max]:\t", time_max, "seconds")
+        print("[avg]:\t", avg, "seconds")
     return
 
 
@@ -10,23 +10,42 @@
 #		https://github.com/notem/Linux-Firewall-Verification-Utility
 
 import firewall_verifier as fv
+from fverifyd import Client
 from ipaddress import IPv4Address, IPv4Network
 from socket import getprotobyname
 from sys import argv, exit
 from os import path
 
 usageStatement = """	
-Usage: fverify [policy] -file [filename]
+Usage: fverify [policy] -file [filename] [-snapshot [filename]]
+       fverify [policy] -snapshot [filename]
+       fverify [policy] -socket [path] [-name [name]] [-file [filename] | -snapshot [filename]]
+       (each form also takes --stats)
 	Specifying a policy: 
 		use the same options you would use to create a rule in iptables
 	Required parameters:
 		-j | --jump [target]	specify the target (ADD/DROP)
 		-A | --append [chain]	specify the chain to look at
 		-file [filename]	file containing iptables-save output
+		  or
+		-snapshot [filename]	snapshot of the chain written by an earlier run
 	Optional parameters:
 		source/destination ports (e.g. --dports, --source-port)
 		source/destination addresses (e.g. -s, -d, --src-range)
 		protocol(s) (e.g. -p, --protocols)
+		-snapshot [filename]	given with -file, the chain is also written to
+					a snapshot which later runs may load in place
+					of parsing the file again
+		-socket [path]		verify with a running fverifyd.py rather than
+					in this process, -file or -snapshot (re)load
+					the chain into it, without either the chain
+					it holds already is verified
+		-name [name]		name of the chain held by fverifyd.py
+					(default: the chain given with -A)
+		--stats			print what the search did and the time
+					spent in each phase, with -socket the
+					counts of the chain since fverifyd.py
+					loaded it (kept when it is given -stats)
 		
 Limitations:
 	- This tool currently only looks at the options specified in the
@@ -34,9 +53,9 @@ Limitations:
 	  from most extension modules, such as matching TCP connections and 
 	  filtering by MAC address. More options can be added by adding more
 	  tuples to the algorithm.
-	- This tool currently doesn't work with rules that don't jump to a 
-	  target. For example, it doesn't work with rules that use -g or --goto
-	  instead of -j or --jump
+	- Jumps (-j) and gotos (-g) to user-defined chains are flattened
+	  into the chain verified, other targets which don't decide a packet
+	  (such as LOG) are taken as DROP
 """
 
 ################################################
@@ -85,6 +104,7 @@ def usage():
 ### parseRule
 # returns a LIST containing the tuples derived from the rule
 #	a list is used because a single rule might expand into several
+# raises ValueError if an address, port or protocol is malformed
 # 
 # rule - a string containing the iptable options to specify the rule
 #	 For example: "-A INPUT -p ipencap -j DROP"
@@ -161,9 +181,8 @@ def parseRule(rule):
             except:
                 try:
                     p = getprotobyname(rule[i - 1])
-                except Exception as e:
-                    print("ERROR: " + str(e))
-                    usage()
+                except OSError as e:
+                    raise ValueError(str(e))
             protoMin = protoMax = p
             continue
 
@@ -229,43 +248,142 @@ def parseRule(rule):
 
 
 ### extractRules
-# given a file and a chain, it parses each line and adds rules that correspond to
-# the given chain to the firewall verification object
+# given a file and a chain, the module parses each line and adds rules that
+# correspond to the given chain, followed by the chain's default policy, to
+# the firewall verification object (see parseRule for the supported options)
 #
-# f - file pointer (created after opening the file)
+# ruleFile - path of the file containing iptables-save output
 # chain - name of the chain to look at
-def extractRules(f, chain):
-    defaultPolicy = ""
-    for i in f:  # read each line in the file
-        if i[0] == '-':  # line contains a rule
-            if chain in i.split(' '):
-                rules = parseRule(i)  # returns a list of rule tuples
-                for r in rules:
-                    fv.add(r)  # add rules to verifier
-        elif i[0] == ':':  # line defines a chain
-            if ":" + chain in i.split(' '):
-                defaultPolicy = i.split(" ")[1]
-                if defaultPolicy == 'ACCEPT':
-                    defaultPolicy = 1
-                else:
-                    defaultPolicy = 0
-    if defaultPolicy == "":
+def extractRules(ruleFile, chain):
+    try:
+        added, skipped = fv.load_iptables_save(ruleFile, chain)
+    except ValueError:
         print("ERROR: Can't find a default policy for '" + chain + "'")
         usage()
-    # add default policy rule
-    fv.add(((0, 4294967295),
-            (1, 65535),
-            (0, 4294967295),
-            (1, 65535),
-            (0, 255),
-            defaultPolicy))
+    for line, reason in skipped:  # rules which could not be added
+        print("WARNING: line " + str(line) + " ignored, " + reason)
+
+
+### loadSnapshot
+# replaces the rules of the firewall verification object with those of a
+# snapshot written by an earlier run (see -snapshot), the snapshot is mapped
+# into memory rather than parsed
+#
+# snapshotFile - path of the snapshot
+def loadSnapshot(snapshotFile):
+    try:
+        fv.load_snapshot(snapshotFile)
+    except (OSError, ValueError) as e:
+        print("ERROR: Can't load the snapshot " + snapshotFile + ": " + str(e))
+        usage()
+
+
+### report
+# prints the outcome of verifying the property and exits
+#
+# witness - the witness packet of a failing property, None if it passes
+def report(witness):
+    if witness is None:
+        print("--> Property passes!")
+        exit()
+    src_ip = IPv4Address(witness[0]).exploded
+    src_port = witness[1]
+    dst_ip = IPv4Address(witness[2]).exploded
+    dst_port = witness[3]
+    protocol = witness[4]
+    print("--> Property fails!\n"
+          "The following witness packet was found..\n"
+          "\tSource      - " + src_ip + ":" + str(src_port) + "\n",
+          "\tDestination - " + dst_ip + ":" + str(dst_port) + "\n",
+          "\tProtocol    - " + str(protocol))
+    exit()
+
+
+### printStats
+# prints the counts and timings returned by stats(), so that a property whose
+# search is unusually costly shows where the time went
+#
+# stats - the dictionary returned by stats()
+def printStats(stats):
+    if not stats["enabled"]:
+        print("Search statistics were not kept")
+        return
+    seconds = stats["seconds"]
+    print("Search statistics:\n"
+          "\tproperties verified  " + str(stats["verified"]) + " (" + str(stats["cached"]) + " from results kept, "
+          + str(stats["diagram"]) + " by the decision diagram)\n"
+          "\tproperties searched  " + str(stats["searched"]) + ", " + str(stats["projected"])
+          + " rules surviving projection\n"
+          "\tslices               " + str(stats["slices"]) + ", " + str(stats["sliced"]) + " rules in them\n"
+          "\tend-point sets       " + str(stats["sets"]) + ", per field "
+          + " ".join(str(n) for n in stats["endpoints"]) + " (largest "
+          + " ".join(str(n) for n in stats["endpoints_max"]) + ")\n"
+          "\tcandidates tested    " + str(stats["candidates"]) + ", " + str(stats["comparisons"])
+          + " rule comparisons\n"
+          "\tseconds              " + " ".join(phase + " " + "%.6f" % seconds[phase]
+                                               for phase in ("compile", "project", "slice", "endpoints", "search")))
+
+
+### verifyRemote
+# verifies the property with a running fverifyd.py, loading the chain into
+# it first when a rule file or snapshot is given
+#
+# socket - path of the daemon's socket
+# name - name the daemon holds the chain under
+# chain - name of the chain to look at
+# ruleFile - path of the file containing iptables-save output, may be empty
+# snapshotFile - path of a snapshot, written if ruleFile is given otherwise loaded
+# policy - the property tuples to verify
+# stats - True to print the counts the daemon keeps for the chain
+def verifyRemote(socket, name, chain, ruleFile, snapshotFile, policy, stats):
+    try:
+        client = Client(socket)
+    except OSError as e:
+        print("ERROR: Can't reach fverifyd at " + socket + ": " + str(e))
+        usage()
+    try:
+        if ruleFile != "":
+            added, skipped = client.load(name, chain, ruleFile)
+            if skipped:
+                print("WARNING: " + str(skipped) + " lines ignored")
+            if snapshotFile != "":
+                client.ok("SAVE " + name + " " + path.abspath(snapshotFile))
+        elif snapshotFile != "":
+            client.map(name, snapshotFile)
+        witnesses = client.verifyMany(name, policy)
+        if stats:
+            printStats(client.stats(name))
+    except (OSError, ValueError) as e:
+        print("ERROR: " + str(e))
+        usage()
+    finally:
+        client.close()
+    report(next((w for w in witnesses if w is not None), None))
+
+
+### parsePolicy
+# returns the tuples of the property given on the command line, exits if
+# one of its values is malformed
+#
+# property_args - the arguments describing the property
+def parsePolicy(property_args):
+    try:
+        return parseRule(" ".join(property_args))
+    except ValueError as e:
+        print("ERROR: " + str(e))
+        usage()
 
 
 def main(args):
     ### parse command line arguments
     fileArgs = ['-file', '-infile']
+    snapshotArgs = ['-snapshot']
     ruleFile = ""
+    snapshotFile = ""
+    socket = ""
+    name = ""
     chain = ""
+    stats = False
     targetPresent = False
     args = args[1:]  # cutoff head
     property_args = []  # arguments describing the property
@@ -277,6 +395,17 @@ def main(args):
         elif any(j == args[i] for j in fileArgs):  # check for file
             ruleFile = args[i + 1]
             i += 1  # dont add file args to policy args
+        elif any(j == args[i] for j in snapshotArgs):  # check for snapshot
+            snapshotFile = args[i + 1]
+            i += 1
+        elif args[i] == '-socket':  # check for a daemon to verify with
+            socket = args[i + 1]
+            i += 1
+        elif args[i] == '-name':
+            name = args[i + 1]
+            i += 1
+        elif args[i] in ['-stats', '--stats']:  # check for search statistics
+            stats = True
         elif any(j == args[i] for j in targets):  # check for target
             targetPresent = True
             property_args.append(args[i])
@@ -286,36 +415,43 @@ def main(args):
     if chain == "":
         print("ERROR: Cannot find chain.\nUse -A or --append to specify the chain.")
         usage()
-    if ruleFile == "":
-        print("ERROR: No rule file specified.\nUse -file or -infile to specify the rule file.")
+    if ruleFile == "" and snapshotFile == "" and socket == "":
+        print("ERROR: No rule file specified.\nUse -file or -infile to specify the rule file,"
+              " or -snapshot to load a snapshot.")
         usage()
     if not targetPresent:
         print("ERROR: No target specified\nUse -j or --jump to specify the target")
         usage()
 
-    if not path.exists(ruleFile):  # check if file exists
+    if ruleFile != "" and not path.exists(ruleFile):  # check if file exists
         print("ERROR: Cannot find the file " + ruleFile)
         usage()
 
-    ### parse file, create tuples, and check for witness
-    with open(ruleFile) as f:  # iptables-save > rules.txt
-        extractRules(f, chain)  # build firewall from infile
-        policy = parseRule(" ".join(property_args))
-        for i in policy:  # looped to account for the possibility of multiple rules
-            if not fv.verify(i):
-                witness = fv.witness()
-                src_ip = IPv4Address(witness[0]).exploded
-                src_port = witness[1]
-                dst_ip = IPv4Address(witness[2]).exploded
-                dst_port = witness[3]
-                protocol = witness[4]
-                print("--> Property fails!\n"
-                      "The following witness packet was found..\n"
-                      "\tSource      - " + src_ip + ":" + str(src_port) + "\n",
-                      "\tDestination - " + dst_ip + ":" + str(dst_port) + "\n",
-                      "\tProtocol    - " + str(protocol))
-                exit()
-        print("--> Property passes!")
+    ### let a running daemon verify the property
+    if socket != "":
+        verifyRemote(socket, name if name != "" else chain, chain, ruleFile, snapshotFile,
+                     parsePolicy(property_args), stats)
+
+    ### parse file (or load its snapshot), create tuples, and check for witness
+    if ruleFile != "":
+        extractRules(ruleFile, chain)  # build firewall from infile (iptables-save > rules.txt)
+        if snapshotFile != "":
+            try:
+                fv.save_snapshot(snapshotFile)
+            except OSError as e:
+                print("WARNING: Can't write the snapshot " + snapshotFile + ": " + str(e))
+    else:
+        loadSnapshot(snapshotFile)
+    policy = parsePolicy(property_args)
+    fv.set_stats(stats)
+    witness = None
+    for i in policy:  # looped to account for the possibility of multiple rules
+        if not fv.verify(i):
+            witness = fv.witness()
+            break
+    if stats:
+        printStats(fv.stats())
+    report(witness)
 
 
 if __name__ == "__main__":
@@ -0,0 +1,428 @@
+#!/usr/bin/env python3
+# date: 2026-10-16
+# contributor(s):
+#   agent, agent@local
+# description:
+#   Resident verifier which keeps compiled chains in memory and answers
+#   requests over a Unix domain socket, so that audits run from hooks do
+#   not pay for starting python and parsing the rules each time. Clients
+#   are served by a pool of threads, verify releases the GIL so requests
+#   on separate chains run at once while those on one chain take turns.
+#   With -stats every chain counts what its searches do, for STATS.
+#   fverify.py talks to it when given -socket.
+
+import firewall_verifier as fv
+import socket
+import socketserver
+from concurrent.futures import ThreadPoolExecutor
+from os import lstat, path, unlink
+from signal import signal, SIGTERM
+from stat import S_ISSOCK
+from sys import argv, exit
+from threading import Lock
+
+# socket used when none is given, by the daemon and by fverify.py
+DEFAULT_SOCKET = "/tmp/fverify.sock"
+
+# longest request line accepted
+MAX_LINE = 1 << 16
+
+# most property lines a BATCH may announce
+MAX_BATCH = 1 << 14
+
+# requests ending with a path, and the number of words before it
+PATHS = {"LOAD": 3, "MAP": 2, "SAVE": 2}
+
+# parts of the memory held by a chain, in the order MEMORY answers them
+MEMORY = ("rules", "compiled", "diagram", "results", "workspace", "peak")
+
+# counts kept by a chain which STATS answers as lists of values
+STATS_LISTS = ("endpoints", "endpoints_max")
+
+usageStatement = """
+Usage: fverifyd [-socket [path]] [-workers [n]] [-threads [n]] [-fdd] [-stats]
+	Optional parameters:
+		-socket [path]	socket to listen on (default """ + DEFAULT_SOCKET + """)
+		-workers [n]	clients served at once (default 8)
+		-threads [n]	threads each chain searches with (default 1)
+		-fdd		verify against decision diagrams of the chains
+		-stats		count what the searches of each chain do
+
+Protocol:
+	one request per line, answered by one line (BATCH by one per property)
+	fields are lo:hi ranges or single values, a rule or property is five
+	fields followed by an action value, the fields of an INSERT or REPLACE
+	rule may also be comma separated lists of ranges
+		LOAD name chain path		-> OK rules skipped
+		MAP name path			-> OK rules
+		SAVE name path			-> OK
+		VERIFY name property		-> PASS | FAIL w1 w2 w3 w4 w5
+		BATCH name count		-> followed by count (at most
+						   """ + str(MAX_BATCH) + """) property lines,
+						   answered as VERIFY for each
+						   (or by a single ERR)
+		INSERT name index rule		-> OK rules
+		DELETE name index		-> OK rules
+		REPLACE name index rule		-> OK rules
+		DROP name			-> OK
+		MEMORY name			-> OK rules compiled diagram results
+						   workspace peak (bytes held)
+		STATS name			-> OK key=value ... (the counts of
+						   stats() since the chain was loaded)
+		LIST				-> OK name ...
+	failed requests are answered with ERR and a reason
+"""
+
+
+######################################
+### Protocol
+######################################
+
+### encodeField
+# writes a field of a rule or property, a (lo, hi) range or a list of ranges
+def encodeField(field):
+    if isinstance(field, list):
+        return ",".join(str(lo) + ":" + str(hi) for lo, hi in field)
+    return str(field[0]) + ":" + str(field[1])
+
+
+### encodeRule
+# writes a rule or property, the five fields followed by the action value
+def encodeRule(rule):
+    return " ".join([encodeField(field) for field in rule[:5]] + [str(rule[5])])
+
+
+### decodeField
+# reads a field written by encodeField, a single value stands for lo:lo
+def decodeField(token):
+    ranges = []
+    for part in token.split(","):
+        lo, _, hi = part.partition(":")
+        ranges.append((int(lo), int(hi if hi else lo)))
+    return ranges[0] if len(ranges) == 1 else ranges
+
+
+### decodeRule
+# reads a rule or property written by encodeRule from a list of words
+def decodeRule(words):
+    if len(words) != 6:
+        raise ValueError("a rule must hold five fields and an action value")
+    return tuple(decodeField(word) for word in words[:5]) + (int(words[5]),)
+
+
+### decodeProperty
+# reads a property from a list of words, a property is a box so each of
+# its fields is a single range
+def decodeProperty(words):
+    prop = decodeRule(words)
+    if any(isinstance(field, list) for field in prop[:5]):
+        raise ValueError("a property field must be a single range, lists of ranges are for INSERT and REPLACE")
+    return prop
+
+
+### encodeStats
+# writes the counts returned by stats() as key=value words, lists of values
+# are comma separated and the seconds of each phase are keyed seconds.phase
+def encodeStats(stats):
+    words = []
+    for key, value in sorted(stats.items()):
+        if key == "seconds":
+            words += ["seconds." + phase + "=" + repr(s) for phase, s in sorted(value.items())]
+        elif key in STATS_LISTS:
+            words.append(key + "=" + ",".join(str(v) for v in value))
+        else:
+            words.append(key + "=" + str(int(value)))
+    return " ".join(words)
+
+
+### decodeStats
+# reads the counts written by encodeStats from a list of words
+def decodeStats(words):
+    stats = {"seconds": {}}
+    for word in words:
+        key, _, value = word.partition("=")
+        if key.startswith("seconds."):
+            stats["seconds"][key[8:]] = float(value)
+        elif key in STATS_LISTS:
+            stats[key] = tuple(int(v) for v in value.split(","))
+        else:
+            stats[key] = int(value)
+    stats["enabled"] = bool(stats.get("enabled"))
+    return stats
+
+
+### decodeResult
+# reads the answer to VERIFY, None if the property passes otherwise its witness
+def decodeResult(line):
+    words = line.split()
+    if words and words[0] == "PASS":
+        return None
+    if words and words[0] == "FAIL" and len(words) == 6:
+        return tuple(int(word) for word in words[1:])
+    raise ValueError(line[4:].strip() if line.startswith("ERR") else "unexpected answer " + line.strip())
+
+
+######################################
+### Daemon
+######################################
+
+class Chains:
+    """compiled chains by name, a chain is replaced as a whole when loaded again"""
+
+    def __init__(self, threads, fdd, stats):
+        self.lock = Lock()
+        self.chains = {}
+        self.threads = threads
+        self.fdd = fdd
+        self.stats = stats
+
+    def create(self):
+        firewall = fv.Firewall(threads=self.threads, fdd=fv.FDD_LIMIT if self.fdd else 0)
+        firewall.set_stats(self.stats)
+        return firewall
+
+    def get(self, name):
+        with self.lock:
+            if name not in self.chains:
+                raise KeyError("no chain named " + name)
+            return self.chains[name]
+
+    def put(self, name, firewall):
+        with self.lock:
+            self.chains[name] = firewall
+
+    def drop(self, name):
+        with self.lock:
+            if self.chains.pop(name, None) is None:
+                raise KeyError("no chain named " + name)
+
+    def names(self):
+        with self.lock:
+            return sorted(self.chains)
+
+
+### answer
+# formats the result of verifying a property
+def answer(witness):
+    if witness is None:
+        return "PASS"
+    return "FAIL " + " ".join(str(value) for value in witness)
+
+
+class Handler(socketserver.StreamRequestHandler):
+    """serves the requests of one client until it disconnects"""
+
+    def handle(self):
+        while True:
+            line = self.rfile.readline(MAX_LINE).decode("ascii", "replace")
+            if not line:
+                return
+            try:
+                replies = self.dispatch(line)
+            except (KeyError, IndexError, ValueError, TypeError, OSError) as e:
+                message = e.args[0] if isinstance(e, KeyError) and e.args else str(e)
+                replies = ["ERR " + " ".join(str(message).split())]
+            self.wfile.write(("\n".join(replies) + "\n").encode("ascii"))
+            self.wfile.flush()
+
+    def dispatch(self, line):
+        chains = self.server.chains
+        words = line.split()
+        if not words:
+            raise ValueError("empty request")
+        command, args = words[0].upper(), words[1:]
+        if command in PATHS:  # the path is the rest of the line, spaces included
+            args = [word.rstrip("\r\n") for word in line.lstrip().split(None, PATHS[command])[1:]]
+
+        if command == "LOAD" and len(args) == 3:
+            firewall = chains.create()
+            added, skipped = firewall.load_iptables_save(args[2], args[1])
+            chains.put(args[0], firewall)
+            return ["OK " + str(added) + " " + str(len(skipped))]
+        if command == "MAP" and len(args) == 2:
+            firewall = chains.create()
+            rules, policy = firewall.load_snapshot(args[1])
+            chains.put(args[0], firewall)
+            return ["OK " + str(rules)]
+        if command == "SAVE" and len(args) == 2:
+            chains.get(args[0]).save_snapshot(args[1])
+            return ["OK"]
+        # verify_many returns the witness, witness() may have been replaced by another client
+        if command == "VERIFY" and len(args) == 7:
+            firewall = chains.get(args[0])
+            return [answer(firewall.verify_many([decodeProperty(args[1:])])[0])]
+        if command == "BATCH" and len(args) == 2:
+            count = int(args[1])
+            if count < 1 or count > MAX_BATCH:
+                raise ValueError("a batch must hold 1 to " + str(MAX_BATCH) + " properties")
+            # every line of the batch is read before any is decoded, so that a bad one leaves none behind
+            lines = []
+            while len(lines) < count:
+                line = self.rfile.readline(MAX_LINE).decode("ascii", "replace")
+                if not line:  # the client went away
+                    raise ValueError("the batch ended after " + str(len(lines)) + " properties")
+                lines.append(line)
+            firewall = chains.get(args[0])
+            return [answer(witness) for witness in firewall.verify_many([decodeProperty(l.split()) for l in lines])]
+        if command == "INSERT" and len(args) == 8:
+            return ["OK " + str(chains.get(args[0]).insert(int(args[1]), decodeRule(args[2:])))]
+        if command == "DELETE" and len(args) == 2:
+            return ["OK " + str(chains.get(args[0]).delete(int(args[1])))]
+        if command == "REPLACE" and len(args) == 8:
+            return ["OK " + str(chains.get(args[0]).replace(int(args[1]), decodeRule(args[2:])))]
+        if command == "DROP" and len(args) == 1:
+            chains.drop(args[0])
+            return ["OK"]
+        if command == "MEMORY" and len(args) == 1:
+            memory = chains.get(args[0]).memory()
+            return ["OK " + " ".join(str(memory[part]) for part in MEMORY)]
+        if command == "STATS" and len(args) == 1:
+            return ["OK " + encodeStats(chains.get(args[0]).stats())]
+        if command == "LIST" and not args:
+            return [" ".join(["OK"] + chains.names())]
+        raise ValueError("unknown request " + command + " with " + str(len(args)) + " arguments")
+
+
+class Server(socketserver.UnixStreamServer):
+    """hands each client to a fixed pool of threads"""
+
+    def __init__(self, address, workers, chains):
+        self.pool = ThreadPoolExecutor(max_workers=workers)
+        self.chains = chains
+        socketserver.UnixStreamServer.__init__(self, address, Handler)
+
+    def serve(self, request, client_address):
+        try:
+            self.finish_request(request, client_address)
+        except Exception:
+            self.handle_error(request, client_address)
+        finally:
+            self.shutdown_request(request)
+
+    def process_request(self, request, client_address):
+        self.pool.submit(self.serve, request, client_address)
+
+    def server_close(self):
+        socketserver.UnixStreamServer.server_close(self)
+        self.pool.shutdown(wait=False)
+
+
+######################################
+### Client
+######################################
+
+class Client:
+    """connection to a running daemon, used by fverify.py -socket"""
+
+    def __init__(self, address=DEFAULT_SOCKET):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(address)
+        self.file = self.sock.makefile("rw", encoding="ascii", newline="\n")
+
+    def request(self, line, more=(), replies=1):
+        self.file.write("\n".join([line] + list(more)) + "\n")
+        self.file.flush()
+        first = self.file.readline()
+        if first.startswith("ERR"):  # a failed request is answered by a single line
+            return [first]
+        return [first] + [self.file.readline() for _ in range(replies - 1)]
+
+    def ok(self, line):
+        reply = self.request(line)[0]
+        if not reply.startswith("OK"):
+            raise ValueError(reply[4:].strip() if reply.startswith("ERR") else "unexpected answer " + reply.strip())
+        return reply.split()[1:]
+
+    def load(self, name, chain, ruleFile):
+        added, skipped = self.ok("LOAD " + name + " " + chain + " " + path.abspath(ruleFile))
+        return int(added), int(skipped)
+
+    def map(self, name, snapshotFile):
+        return int(self.ok("MAP " + name + " " + path.abspath(snapshotFile))[0])
+
+    def stats(self, name):
+        return decodeStats(self.ok("STATS " + name))
+
+    def verifyMany(self, name, props):
+        results = []
+        for first in range(0, len(props), MAX_BATCH):  # the daemon refuses longer batches
+            batch = props[first:first + MAX_BATCH]
+            replies = self.request("BATCH " + name + " " + str(len(batch)), [encodeRule(p) for p in batch], len(batch))
+            results += [decodeResult(reply) for reply in replies]
+        return results
+
+    def close(self):
+        self.file.close()
+        self.sock.close()
+
+
+### removeStale
+# removes the socket left at address by a daemon which did not exit cleanly,
+# exits rather than remove a socket a daemon still listens on or a path
+# which is not a socket
+#
+# address - path the daemon will listen on
+def removeStale(address):
+    try:
+        mode = lstat(address).st_mode
+    except FileNotFoundError:
+        return
+    if not S_ISSOCK(mode):
+        exit("ERROR: " + address + " exists and is not a socket")
+    probe = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    try:
+        probe.connect(address)
+    except ConnectionRefusedError:  # nothing listens on it
+        unlink(address)
+        return
+    except OSError as e:
+        exit("ERROR: Can't tell whether " + address + " is in use: " + str(e))
+    finally:
+        probe.close()
+    exit("ERROR: fverifyd is already listening on " + address)
+
+
+def usage():
+    exit(usageStatement)
+
+
+def main(args):
+    address, workers, threads, fdd, stats = DEFAULT_SOCKET, 8, 1, False, False
+    args = args[1:]
+    i = 0
+    try:
+        while i < len(args):
+            if args[i] == "-socket":
+                address = args[i + 1]
+                i += 1
+            elif args[i] == "-workers":
+                workers = int(args[i + 1])
+                i += 1
+            elif args[i] == "-threads":
+                threads = int(args[i + 1])
+                i += 1
+            elif args[i] == "-fdd":
+                fdd = True
+            elif args[i] == "-stats":
+                stats = True
+            else:
+                usage()
+            i += 1
+    except (IndexError, ValueError):
+        usage()
+
+    removeStale(address)
+    server = Server(address, workers, Chains(threads, fdd, stats))
+    signal(SIGTERM, lambda signum, frame: exit())  # stopped as by ^C, removing the socket
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+        unlink(address)
+
+
+if __name__ == "__main__":
+    # execute only if run as a script
+    main(argv)
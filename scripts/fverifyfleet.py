@@ -0,0 +1,319 @@
+#!/usr/bin/env python3
+# date: 2026-10-16
+# contributor(s):
+#   agent, agent@local
+# description:
+#   Fleet audit which verifies a file of properties against the
+#   iptables-save dumps of many hosts from one invocation. The properties
+#   are parsed once, the dumps are fingerprinted with their comments and
+#   counters left out so that hosts holding the same rules are verified
+#   once, and the distinct dumps are spread over worker processes (or
+#   threads). One JSON object is written per host as its dump is decided,
+#   followed by a summary.
+
+import firewall_verifier as fv
+import json
+from concurrent.futures import Future, ProcessPoolExecutor, ThreadPoolExecutor, as_completed
+from fverify import parseRule, chains
+from hashlib import sha256
+from ipaddress import IPv4Address
+from os import cpu_count, listdir, path
+from sys import argv, exit, stdout
+from timeit import default_timer as timer
+
+usageStatement = """
+Usage: fverifyfleet -properties [filename] (-dir [directory] | -manifest [filename])
+                    [-workers [n]] [-threaded] [-threads [n]] [-fdd]
+	Required parameters:
+		-properties [filename]	one property per line, given as to
+					fverify.py (e.g. -A INPUT -p tcp
+					--dport 22 -j DROP), # starts a comment
+		-dir [directory]	every file of the directory is the
+					iptables-save output of a host named
+					after the file
+		  or
+		-manifest [filename]	one host per line, a path or a name
+					followed by a path (relative to the
+					manifest), # starts a comment
+	Optional parameters:
+		-workers [n]	dumps verified at once (default: one per cpu)
+		-threaded	verify in threads of this process rather than
+				in worker processes (parsing holds the GIL,
+				searching does not)
+		-threads [n]	threads each dump searches with (default 1)
+		-fdd		verify against decision diagrams of the chains
+
+Output:
+	one JSON object per host, in the order their dumps are decided
+		host, path		the host and its dump
+		digest			fingerprint of the dump's rules
+		verified_by		host whose identical dump was verified
+					(itself if it was verified for it)
+		chains			rules added and lines skipped per chain
+		results			per property: property, passes, witness
+					(source, sport, destination, dport,
+					protocol of a packet violating it)
+		seconds			read, parse and verify time, parse and
+					verify are those of the dump verified
+		error			why the host could not be verified
+	then one summary object: hosts, unique, failing, errors, seconds
+"""
+
+
+######################################
+### Inputs
+######################################
+
+### readProperties
+# parses a property file once, returning (chain, text, tuples) per property,
+# the tuples of a property are those parseRule expands it into
+#
+# propertyFile - path of the property file
+def readProperties(propertyFile):
+    properties = []
+    with open(propertyFile) as f:
+        for number, line in enumerate(f, 1):
+            text = line.split('#', 1)[0].strip()
+            if text == "":
+                continue
+            words = text.split()
+            chain = next((words[i + 1] for i in range(len(words) - 1) if words[i] in chains), "")
+            try:
+                tuples = parseRule(" ".join(words))
+            except ValueError as e:  # a malformed address, port or protocol
+                exit("ERROR: line " + str(number) + " of " + propertyFile + ": " + str(e) + ": " + text)
+            except IndexError:  # the last option has no value
+                exit("ERROR: line " + str(number) + " of " + propertyFile + ": missing value: " + text)
+            if chain == "" or not tuples:
+                exit("ERROR: line " + str(number) + " of " + propertyFile + " is not a property with a chain: "
+                     + text)
+            properties.append((chain, text, tuples))
+    return properties
+
+
+### readHosts
+# lists the (host, path) of each dump of a directory or manifest
+#
+# directory - directory holding one dump per host, or ""
+# manifest - file listing the dumps, or ""
+def readHosts(directory, manifest):
+    if directory != "":
+        return [(name, path.join(directory, name)) for name in sorted(listdir(directory))
+                if path.isfile(path.join(directory, name))]
+    hosts = []
+    base = path.dirname(manifest)
+    with open(manifest) as f:
+        for line in f:
+            words = line.split('#', 1)[0].split()
+            if not words:
+                continue
+            dump = path.join(base, words[-1])
+            hosts.append((words[0] if len(words) > 1 else path.basename(dump), dump))
+    return hosts
+
+
+### fingerprint
+# digest of the rules of a dump, leaving out what iptables-save writes
+# differently for identical rules: comments (which hold the date) and the
+# packet and byte counters of chains and rules
+#
+# data - contents of the dump
+def fingerprint(data):
+    digest = sha256()
+    for line in data.splitlines():
+        line = line.strip()
+        if line == b"" or line.startswith(b"#"):
+            continue
+        if line.startswith(b"["):  # counters of a rule saved with -c
+            line = line.split(b"]", 1)[-1].lstrip()
+        elif line.startswith(b":"):  # counters of a chain
+            line = line.rsplit(b"[", 1)[0].rstrip()
+        digest.update(line + b"\n")
+    return digest.hexdigest()
+
+
+######################################
+### Workers
+######################################
+
+# properties and firewall settings of this worker, set once by setup
+worker = {}
+
+
+### setup
+# keeps the parsed properties in the worker, so they are sent to each
+# worker once rather than with every dump
+def setup(properties, threads, fdd):
+    worker["properties"] = properties
+    worker["threads"] = threads
+    worker["fdd"] = fdd
+
+
+### verifyDump
+# verifies every property against one dump, loading each chain the
+# properties name once, returns the chains, results and seconds spent
+#
+# data - contents of the dump
+def verifyDump(data):
+    properties = worker["properties"]
+    loaded = {}
+    results = [None] * len(properties)
+    parse = verify = 0.0
+    for chain in dict.fromkeys(chain for chain, text, tuples in properties):
+        firewall = fv.Firewall(threads=worker["threads"], fdd=fv.FDD_LIMIT if worker["fdd"] else 0)
+        start = timer()
+        try:
+            added, skipped = firewall.load_iptables_save(data, chain)
+        except ValueError as e:
+            raise ValueError("chain " + chain + ": " + str(e))
+        middle = timer()
+        # the tuples of every property of the chain are verified in one call
+        batch = [(i, t) for i, (c, text, tuples) in enumerate(properties) if c == chain for t in tuples]
+        witnesses = firewall.verify_many([t for i, t in batch])
+        end = timer()
+        parse += middle - start
+        verify += end - middle
+        loaded[chain] = {"rules": added, "skipped": [[line, reason] for line, reason in skipped]}
+        for (i, t), witness in zip(batch, witnesses):
+            if results[i] is None:
+                results[i] = {"property": properties[i][1], "passes": True, "witness": None}
+            if witness is not None and results[i]["passes"]:
+                results[i]["passes"] = False
+                results[i]["witness"] = [IPv4Address(witness[0]).exploded, witness[1],
+                                         IPv4Address(witness[2]).exploded, witness[3], witness[4]]
+    return loaded, results, parse, verify
+
+
+######################################
+### Audit
+######################################
+
+### emit
+# writes one JSON object as a line, flushed so that a reader sees each host
+# as soon as it is decided
+def emit(record):
+    stdout.write(json.dumps(record) + "\n")
+    stdout.flush()
+
+
+### audit
+# verifies the properties against the dump of every host, writing a line
+# per host as the distinct dumps are decided and a summary at the end
+#
+# properties - parsed properties (see readProperties)
+# hosts - (host, path) of each dump
+# workers - dumps verified at once
+# threaded - True to verify in threads rather than processes
+# threads - threads each dump searches with
+# fdd - True to verify against decision diagrams
+def audit(properties, hosts, workers, threaded, threads, fdd):
+    start = timer()
+    groups = {}  # digest -> [(host, path, read seconds)], the first host is verified
+    summary = {"hosts": len(hosts), "unique": 0, "failing": 0, "errors": 0}
+
+    if threaded:
+        setup(properties, threads, fdd)
+        pool = ThreadPoolExecutor(max_workers=workers)
+    else:
+        pool = ProcessPoolExecutor(max_workers=workers, initializer=setup, initargs=(properties, threads, fdd))
+    with pool:
+        futures = {}
+        for host, dump in hosts:
+            begin = timer()
+            try:
+                with open(dump, "rb") as f:
+                    contents = f.read()
+            except OSError as e:
+                summary["errors"] += 1
+                emit({"host": host, "path": dump, "error": str(e)})
+                continue
+            digest = fingerprint(contents)
+            read = timer() - begin
+            if digest not in groups:  # the first host holding these rules, verified for every other
+                groups[digest] = []
+                try:
+                    future = pool.submit(verifyDump, contents)
+                except Exception as e:  # the pool broke, as when a worker process died
+                    future = Future()
+                    future.set_exception(e)
+                futures[future] = digest
+            groups[digest].append((host, dump, read))
+        summary["unique"] = len(groups)
+
+        for future in as_completed(futures):
+            digest = futures[future]
+            members = groups[digest]
+            try:
+                loaded, results, parse, verify = future.result()
+                error = None
+            except Exception as e:  # reported for the hosts of this dump, the others are still verified
+                error = type(e).__name__ + ": " + str(e)
+            for host, dump, read in members:
+                record = {"host": host, "path": dump, "digest": digest[:16], "verified_by": members[0][0]}
+                if error is not None:
+                    summary["errors"] += 1
+                    record["error"] = error
+                else:
+                    summary["failing"] += not all(result["passes"] for result in results)
+                    record["chains"] = loaded
+                    record["results"] = results
+                    record["seconds"] = {"read": round(read, 6), "parse": round(parse, 6),
+                                         "verify": round(verify, 6)}
+                emit(record)
+    summary["seconds"] = round(timer() - start, 6)
+    emit(summary)
+    return summary
+
+
+def usage():
+    exit(usageStatement)
+
+
+def main(args):
+    propertyFile, directory, manifest = "", "", ""
+    workers, threaded, threads, fdd = cpu_count() or 1, False, 1, False
+    args = args[1:]
+    i = 0
+    try:
+        while i < len(args):
+            if args[i] == "-properties":
+                propertyFile = args[i + 1]
+                i += 1
+            elif args[i] == "-dir":
+                directory = args[i + 1]
+                i += 1
+            elif args[i] == "-manifest":
+                manifest = args[i + 1]
+                i += 1
+            elif args[i] == "-workers":
+                workers = int(args[i + 1])
+                i += 1
+            elif args[i] == "-threaded":
+                threaded = True
+            elif args[i] == "-threads":
+                threads = int(args[i + 1])
+                i += 1
+            elif args[i] == "-fdd":
+                fdd = True
+            else:
+                usage()
+            i += 1
+    except (IndexError, ValueError):
+        usage()
+    if propertyFile == "" or (directory == "") == (manifest == "") or workers < 1:
+        usage()
+
+    try:
+        properties = readProperties(propertyFile)
+        hosts = readHosts(directory, manifest)
+    except OSError as e:
+        exit("ERROR: " + str(e))
+    if not properties:
+        exit("ERROR: no property found in " + propertyFile)
+    summary = audit(properties, hosts, workers, threaded, threads, fdd)
+    exit(1 if summary["failing"] or summary["errors"] else 0)
+
+
+if __name__ == "__main__":
+    # execute only if run as a script
+    main(argv)
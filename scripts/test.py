@@ -3,11 +3,38 @@
 # example usage of firewall_verifier
 #   module functions:
 #       add(rule)    -> number
+#       add_many(bounds, actions)    -> number   (buffers of unsigned 32-bit values, bounds shaped (n, 5, 2))
+#       load_arrays(bounds, actions) -> number   (as add_many, replacing the rules)
+#       insert(index, rule)   -> number   (rules are numbered from 1, as by iptables)
+#       delete(index)         -> number
+#       replace(index, rule)  -> number
+#       cached()     -> number     (results kept until a rule meeting their property changes)
+#       memory()     -> dict       (bytes held by rules, compiled, diagram, results, workspace and the peak)
+#       stats()      -> dict       (what the searches did since set_stats(True), seconds per phase)
 #       verify(prop) -> bool
+#       verify_many(props)    -> list     (None for each passing property, otherwise its witness)
+#       violations(prop)      -> iterator (each region of packets violating prop, as a rule whose action value
+#                                        is the position of the rule they hit first, found as it is advanced)
+#       load_iptables_save(path_or_bytes, chain) -> (number, list)  (rules added, (line, reason) of lines skipped)
+#       save_snapshot(path, index=True)      -> None     (compiled rules, default policy & sorted bounds)
+#       load_snapshot(path)  -> (number, policy)      (rules are mapped from the file, policy is None if unknown)
+#       reduce()     -> (list, list)     (rules kept, (rule, reason) of rules removed, verify uses the rules kept)
 #       witness()    -> 5tuple
 #       clear()      -> number
 #       size()       -> number
+#       set_engine(engine)    -> None     (ENGINE_SCAN, ENGINE_INDEX, ENGINE_BITSET, ENGINE_REFINE)
+#       set_threads(threads)  -> number
+#       set_fdd(limit)        -> None     (memory limit of a decision diagram of the rules, 0 to search)
+#       set_stats(enabled)    -> None     (starts or stops counting, zeroing the counts)
+#   module types:
+#       Firewall(engine=ENGINE_SCAN, threads=1, fdd=0)
+#           owns its own rules and offers the methods above,
+#           verify releases the GIL so separate firewalls may be
+#           verified at once from separate python threads
 #
+import os
+import tempfile
+from array import array
 import firewall_verifier as fv
 
 # firewall rules are tuples composed of five 2-tuples and 0 integer
@@ -50,3 +77,129 @@ else:
 
 # use clear to start building a new firewall
 size = fv.clear()
+
+# a Firewall object holds a ruleset independent of the module functions
+print("\nTest 3: Firewall object,", property1)
+firewall = fv.Firewall(engine=fv.ENGINE_INDEX)
+for rule in (rule1, rule2, rule3, rule4, rule5):
+    firewall.add(rule)
+if firewall.verify(property1):
+    print("-> Property passes!")
+else:
+    print("-> Witness found:", firewall.witness())
+
+# several properties may be verified in one call
+print("\nTest 4: verify_many")
+for prop, witness in zip((property1, property2), firewall.verify_many([property1, property2])):
+    print("->", prop, "passes!" if witness is None else "witness " + str(witness))
+
+# rules may be read straight from iptables-save output
+print("\nTest 5: load_iptables_save")
+save = b"""*filter
+:INPUT DROP [0:0]
+-A INPUT -s 10.0.0.0/8 -p tcp -m tcp --dport 22 -j ACCEPT
+-A INPUT -m state --state ESTABLISHED -j ACCEPT
+COMMIT
+"""
+firewall = fv.Firewall()
+added, skipped = firewall.load_iptables_save(save, "INPUT")
+print("->", added, "rules added, skipped", skipped)
+ssh = ((0, 4294967295), (1, 65535), (0, 4294967295), (22, 22), (6, 6), 1)
+if firewall.verify(ssh):
+    print("-> Property passes!")
+else:
+    print("-> Witness found:", firewall.witness())
+
+# a compiled firewall may be written once and mapped by later runs
+print("\nTest 6: snapshot")
+snapshot = os.path.join(tempfile.gettempdir(), "test_firewall.snapshot")
+firewall.save_snapshot(snapshot)
+mapped = fv.Firewall()
+rules, policy = mapped.load_snapshot(snapshot)
+print("->", rules, "rules mapped, policy", policy)
+if mapped.verify(ssh):
+    print("-> Property passes!")
+else:
+    print("-> Witness found:", mapped.witness())
+os.remove(snapshot)
+
+# rules which can't change how a packet is decided are left out when verifying
+print("\nTest 7: reduce")
+firewall = fv.Firewall()
+for rule in (rule1, rule2, rule3, rule4, rule5, ((50, 60), (50, 60), (0, 0), (0, 0), (0, 0), 1)):
+    firewall.add(rule)
+kept, removed = firewall.reduce()
+print("-> kept", kept, "removed", removed)
+if firewall.verify(property1):
+    print("-> Property passes!")
+else:
+    print("-> Witness found:", firewall.witness())
+
+# properties checked over and over may be answered by a decision diagram of the rules
+print("\nTest 8: decision diagram")
+firewall.set_fdd(fv.FDD_LIMIT)
+for prop, witness in zip((property1, property2), firewall.verify_many([property1, property2])):
+    print("->", prop, "passes!" if witness is None else "witness " + str(witness))
+
+# results are kept until a rule meeting their property is inserted, deleted or replaced
+print("\nTest 9: incremental")
+firewall.set_fdd(0)
+firewall.verify_many([property1, property2])
+firewall.replace(6, ((50, 60), (100, 110), (0, 0), (0, 0), (0, 0), 0))
+print("->", firewall.cached(), "result kept after replacing rule 6")
+for prop, witness in zip((property1, property2), firewall.verify_many([property1, property2])):
+    print("->", prop, "passes!" if witness is None else "witness " + str(witness))
+
+print("\nTest 10: memory")
+held = firewall.memory()
+firewall.replace(6, ((50, 60), (100, 120), (0, 0), (0, 0), (0, 0), 0))
+firewall.verify_many([property1, property2])
+print("-> workspace reused after replacing rule 6:", firewall.memory()["workspace"] == held["workspace"])
+print("-> peak", firewall.memory()["peak"], "bytes")
+
+print("\nTest 11: bulk loading")
+rules = [rule1, rule2, rule3, rule4, rule5]
+bounds = array("I", [value for rule in rules for field in rule[:5] for value in field])
+print("->", firewall.load_arrays(bounds, array("I", [rule[5] for rule in rules])), "rules loaded from arrays")
+for prop, witness in zip((property1, property2), firewall.verify_many([property1, property2])):
+    print("->", prop, "passes!" if witness is None else "witness " + str(witness))
+
+print("\nTest 12: stats")
+firewall.load_arrays(bounds, array("I", [rule[5] for rule in rules]))  # drops the results kept
+firewall.set_stats(True)
+firewall.verify_many([property1, property2, property1])
+stats = firewall.stats()
+print("->", stats["searched"], "properties searched,", stats["slices"], "slices,", stats["candidates"], "candidates")
+
+# every packet which violates a property, as boxes tagged with the rule deciding them
+print("\nTest 13: violations")
+for region in firewall.violations(property1):
+    print("-> rule", region[5], "decides", region[:5])
+
+# jumps to user-defined chains are flattened into the chain loaded
+print("\nTest 14: user-defined chains")
+save = b"""*filter
+:INPUT DROP [0:0]
+:SSH - [0:0]
+:WEB - [0:0]
+-A INPUT -p tcp -m tcp --dport 22 -j SSH
+-A INPUT -p tcp -m multiport --dports 80,443 -g WEB
+-A SSH -s 10.0.0.0/8 -j ACCEPT
+-A SSH -j RETURN
+-A WEB -s 192.168.0.0/16 -j RETURN
+-A WEB -j ACCEPT
+COMMIT
+"""
+firewall = fv.Firewall()
+added, skipped = firewall.load_iptables_save(save, "INPUT")
+print("->", added, "rules added, skipped", skipped)
+web = ((3232235520, 3232301055), (1, 65535), (0, 4294967295), (443, 443), (6, 6), 0)
+print("-> web from 192.168.0.0/16", "is dropped" if firewall.verify(web) else "is not dropped " + str(firewall.witness()))
+
+# a passing property leaves the witness of the last failing one alone
+print("\nTest 15: witness after a passing property")
+firewall.verify(web[:5] + (1,))
+witness = firewall.witness()
+ssh = ((3232235520, 3232301055), (1, 65535), (0, 4294967295), (22, 22), (6, 6), 0)
+print("-> ssh from 192.168.0.0/16", "is dropped" if firewall.verify(ssh) else "is not dropped")
+print("-> witness kept:", firewall.witness() == witness, witness)